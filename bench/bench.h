@@ -0,0 +1,112 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../include/gsg.h"
+
+// Benchmarks for cognity's hot paths, built as the cognity_bench target:
+//
+//   cognity_bench [name...] [options]   run the named benchmarks (default:
+//                                       all)
+//     --json             print every result as one JSON document instead
+//     --files <n>        generated files per language (pipeline)
+//     --functions <n>    functions per generated file (pipeline)
+//     --depth <n>        nesting depth of generated function bodies
+//     --entries <n>      files and directories in the generated tree (walk)
+//
+// Each benchmark prints one line per input size so scaling is visible at a
+// glance; absolute numbers are only comparable on the same machine.
+namespace bench {
+
+using Clock = std::chrono::steady_clock;
+
+struct Settings {
+  bool json = false;
+  unsigned int files = 200;
+  unsigned int functions = 50;
+  unsigned int depth = 4;
+  unsigned int entries = 500000;
+};
+
+// Settings from the command line, shared by all benchmarks.
+const Settings &settings();
+
+// Best wall time of `reps` runs of `fn`, in seconds.
+template <class F>
+double best_of(int reps, F &&fn) {
+  double best = 0;
+  for (int i = 0; i < reps; ++i) {
+    const auto start = Clock::now();
+    fn();
+    const double s =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    if (i == 0 || s < best) best = s;
+  }
+  return best;
+}
+
+// Print "  <label>: <ms> ms, <ns> ns/<unit>" for `n` units done in `seconds`.
+void report(const std::string &label, double seconds, size_t n,
+            const char *unit);
+
+// Print "  <label>: <name> <value>, ..." for named measurements.
+using Fields = std::vector<std::pair<std::string, double>>;
+void report(const std::string &label, const Fields &fields);
+
+// One generated input of a scaling benchmark: its source, and how many of
+// the benchmark's units it holds.
+struct ScalingInput {
+  std::string source;
+  size_t units = 0;
+};
+
+// Parse generate(size) with `language` for each of `sizes` and report the
+// best of `reps` scores by a `lang` builder as
+// "<size> <what> (<n> functions, complexity <c>)", per `unit`. For inputs
+// whose cost should grow linearly: the time per unit should stay flat.
+void score_scaling(const TSLanguage *language, Language lang,
+                   const std::function<ScalingInput(unsigned int)> &generate,
+                   std::initializer_list<unsigned int> sizes, int reps,
+                   const char *unit, const char *what);
+
+// Scoring of synthetic, deeply nested functions, from a built GSG and
+// streamed during the walk.
+void scoring();
+
+// Builder walks over generated files with thousands of top-level
+// functions; the time per function should not grow with the file.
+void builders();
+
+// C++ functions inside deeply nested namespaces and classes; qualifying
+// their names should not cost more with depth.
+void scopes();
+
+// The whole per-file pipeline over a generated corpus (see corpus.h), per
+// language and phase: parse, GSG build, score and output, each with files/s,
+// MB/s, functions/s and peak RSS.
+void pipeline();
+
+// Matching paths against .gitignore files of up to 2000 rules; the time
+// per path should barely grow with the number of rules.
+void gitignore();
+
+// Long generated && / || chains in one C condition; the time per operand
+// should not grow with the chain.
+void bool_chains();
+
+// C++ functions of deeply nested blocks with a lambda at every level; the
+// time per lambda should not grow with the depth.
+void lambdas();
+
+// Both directory walkers (see DirWalker) over a generated tree of
+// --entries files and directories: wall time per entry and, on Linux, the
+// syscalls each makes, counted by tracing a child process that walks.
+void walk();
+
+}  // namespace bench
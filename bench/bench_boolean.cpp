@@ -0,0 +1,28 @@
+#include <string>
+
+#include "../include/cognitive_complexity.h"
+#include "./bench.h"
+
+namespace {
+
+// A C function whose condition is one chain of `terms` operands, switching
+// between && and || every third operator.
+std::string bool_chain(unsigned int terms) {
+  std::string cond = "a0";
+  for (unsigned int i = 1; i < terms; ++i)
+    cond += std::string(i / 3 % 2 ? " || " : " && ") + "a" + std::to_string(i);
+  return "int f(int a) {\n  if (" + cond + ") { return 1; }\n  return 0;\n}\n";
+}
+
+}  // namespace
+
+namespace bench {
+
+void bool_chains() {
+  score_scaling(
+      tree_sitter_c(), Language::C,
+      [](unsigned int terms) { return ScalingInput{bool_chain(terms), terms}; },
+      {100, 200, 400, 800, 1600}, 5, "term", "terms in one condition");
+}
+
+}  // namespace bench
@@ -0,0 +1,72 @@
+#include <string>
+#include <vector>
+
+#include "../include/cognitive_complexity.h"
+#include "./bench.h"
+
+namespace {
+
+struct Flavor {
+  const char *name;
+  const TSLanguage *(*language)();
+  Language lang;
+  // One small top-level function (with a branch, so bodies are walked too).
+  std::string (*function)(unsigned int i);
+};
+
+std::string python_function(unsigned int i) {
+  const std::string n = std::to_string(i);
+  return "def f" + n + "(x):\n    if x and x > " + n +
+         ":\n        return 1\n    return 0\n\n";
+}
+
+std::string js_function(unsigned int i) {
+  const std::string n = std::to_string(i);
+  return "function f" + n + "(x) {\n  if (x && x > " + n +
+         ") { return 1; }\n  return 0;\n}\n";
+}
+
+std::string c_function(unsigned int i) {
+  const std::string n = std::to_string(i);
+  return "int f" + n + "(int x) {\n  if (x && x > " + n +
+         ") { return 1; }\n  return 0;\n}\n";
+}
+
+const Flavor kFlavors[] = {
+    {"python", tree_sitter_python, Language::Python, python_function},
+    {"javascript", tree_sitter_javascript, Language::JavaScript, js_function},
+    {"c", tree_sitter_c, Language::C, c_function},
+};
+
+}  // namespace
+
+namespace bench {
+
+void builders() {
+  TSParser *parser = ts_parser_new();
+  for (const auto &flavor : kFlavors) {
+    ts_parser_set_language(parser, flavor.language());
+    auto builder = make_builder(flavor.lang);
+    for (unsigned int count : {2500u, 5000u, 10000u, 20000u}) {
+      std::string src;
+      for (unsigned int i = 0; i < count; ++i) src += flavor.function(i);
+      TSTree *tree =
+          ts_parser_parse_string(parser, nullptr, src.data(),
+                                 static_cast<uint32_t>(src.size()));
+      const TSNode root = ts_tree_root_node(tree);
+      std::vector<FunctionComplexity> out;
+      const double s = best_of(3, [&] {
+        out.clear();
+        builder->score(root, src, out);
+      });
+      report(std::string(flavor.name) + " " + std::to_string(count) +
+                 " top-level functions (" + std::to_string(out.size()) +
+                 " scored)",
+             s, count, "function");
+      ts_tree_delete(tree);
+    }
+  }
+  ts_parser_delete(parser);
+}
+
+}  // namespace bench
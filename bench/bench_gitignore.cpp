@@ -0,0 +1,89 @@
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "../include/gitignore.h"
+#include "./bench.h"
+
+namespace {
+
+// A .gitignore of `lines` rules in the shapes large real ones have:
+// literal names and paths, extensions, prefixes, dir-only and negated
+// rules, and a share of wildcard globs.
+std::string generate_gitignore(unsigned int lines) {
+  std::string out = "# generated\n";
+  for (unsigned int i = 0; i < lines; ++i) {
+    const std::string n = std::to_string(i);
+    switch (i % 8) {
+      case 0:
+        out += "name" + n + "\n";
+        break;
+      case 1:
+        out += "*.ext" + n + "\n";
+        break;
+      case 2:
+        out += "prefix" + n + "*\n";
+        break;
+      case 3:
+        out += "out" + n + "/\n";
+        break;
+      case 4:
+        out += "dir" + n + "/file" + n + ".txt\n";
+        break;
+      case 5:
+        out += "!keep" + n + ".ext1\n";
+        break;
+      case 6:
+        out += "gen" + n + "_*.c?\n";
+        break;
+      default:
+        out += "**/build" + n + "/*.o\n";
+        break;
+    }
+  }
+  return out;
+}
+
+// Paths as a walk would meet them, mostly not ignored (the common case,
+// where every rule has to be ruled out).
+std::vector<std::string> generate_paths(unsigned int count) {
+  std::vector<std::string> paths;
+  const char *names[] = {"main.py", "util.c", "name42", "x.ext9",
+                         "prefix7abc", "gen6_a.cc", "lib.js", "README.md"};
+  for (unsigned int i = 0; i < count; ++i)
+    paths.push_back("src/module" + std::to_string(i % 97) + "/sub" +
+                    std::to_string(i % 13) + "/" + names[i % 8]);
+  return paths;
+}
+
+}  // namespace
+
+namespace bench {
+
+void gitignore() {
+  namespace fs = std::filesystem;
+  const fs::path dir = fs::temp_directory_path() / "cognity_bench_gitignore";
+  fs::create_directories(dir);
+  const std::vector<std::string> paths = generate_paths(100000);
+  for (unsigned int lines : {20u, 200u, 2000u}) {
+    std::ofstream(dir / ".gitignore") << generate_gitignore(lines);
+    std::vector<ignore::RulesFile> stack(1);
+    const double load = best_of(
+        3, [&] { stack[0] = ignore::load_rules_for_dir(dir); });
+    size_t ignored = 0;
+    const double match = best_of(3, [&] {
+      ignored = 0;
+      for (const auto &p : paths)
+        ignored += ignore::is_ignored(stack, p, false);
+    });
+    const std::string label = std::to_string(lines) + "-line .gitignore";
+    report(label + " load", load, lines, "rule");
+    report(label + ", " + std::to_string(paths.size()) + " paths (" +
+               std::to_string(ignored) + " ignored)",
+           match, paths.size(), "path");
+  }
+  fs::remove_all(dir);
+}
+
+}  // namespace bench
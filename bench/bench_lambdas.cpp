@@ -0,0 +1,35 @@
+#include <string>
+
+#include "../include/cognitive_complexity.h"
+#include "./bench.h"
+
+namespace {
+
+// A C++ function of `depth` nested if blocks, each declaring a lambda that
+// branches and captures the next level's lambda through a generic call.
+std::string nested_lambdas(unsigned int depth) {
+  std::string src = "auto f(int x) {\n";
+  for (unsigned int i = 0; i < depth; ++i) {
+    const std::string n = std::to_string(i);
+    src += "if (x > " + n + ") {\nauto l" + n +
+           " = [&](auto y) { if (y && x) { return y + " + n +
+           "; } return std::max(y, x); };\nx = l" + n + "(x);\n";
+  }
+  for (unsigned int i = 0; i < depth; ++i) src += "}\n";
+  return src + "return x;\n}\n";
+}
+
+}  // namespace
+
+namespace bench {
+
+void lambdas() {
+  score_scaling(
+      tree_sitter_cpp(), Language::Cpp,
+      [](unsigned int depth) {
+        return ScalingInput{nested_lambdas(depth), depth};
+      },
+      {50, 100, 200, 400, 800}, 3, "lambda", "nested lambdas");
+}
+
+}  // namespace bench
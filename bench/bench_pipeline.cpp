@@ -0,0 +1,129 @@
+#include <iostream>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include "../include/cognitive_complexity.h"
+#include "../include/output.h"
+#include "./bench.h"
+#include "./corpus.h"
+#include "./rss.h"
+
+namespace {
+
+struct Flavor {
+  const char *name;
+  const TSLanguage *(*language)();
+  Language lang;
+};
+
+const Flavor kFlavors[] = {
+    {"python", tree_sitter_python, Language::Python},
+    {"javascript", tree_sitter_javascript, Language::JavaScript},
+    {"typescript", tree_sitter_typescript, Language::TypeScript},
+    {"c", tree_sitter_c, Language::C},
+    {"cpp", tree_sitter_cpp, Language::Cpp},
+};
+
+// Swallows the output phase's printing.
+class NullBuffer : public std::streambuf {
+ protected:
+  int overflow(int c) override { return c; }
+  std::streamsize xsputn(const char *, std::streamsize n) override {
+    return n;
+  }
+};
+
+struct Totals {
+  size_t files = 0;
+  size_t bytes = 0;
+  size_t functions = 0;
+};
+
+void report_phase(const Flavor &flavor, const char *phase, double seconds,
+                  const Totals &totals,
+                  double peak_kib = bench::peak_rss_kib()) {
+  const double s = seconds > 0 ? seconds : 1e-12;
+  bench::report(std::string(flavor.name) + " " + phase,
+                {{"ms", seconds * 1e3},
+                 {"files/s", static_cast<double>(totals.files) / s},
+                 {"MB/s", static_cast<double>(totals.bytes) / 1e6 / s},
+                 {"functions/s", static_cast<double>(totals.functions) / s},
+                 {"peak_rss_kib", peak_kib}});
+}
+
+}  // namespace
+
+namespace bench {
+
+void pipeline() {
+  const Settings &cfg = settings();
+  const CorpusSpec spec{cfg.functions, cfg.depth};
+  TSParser *parser = ts_parser_new();
+  for (const auto &flavor : kFlavors) {
+    std::vector<std::string> corpus;
+    Totals totals;
+    for (unsigned int i = 0; i < cfg.files; ++i) {
+      corpus.push_back(generate_file(flavor.lang, spec, i));
+      totals.bytes += corpus.back().size();
+    }
+    totals.files = corpus.size();
+    ts_parser_set_language(parser, flavor.language());
+    auto builder = make_builder(flavor.lang);
+
+    // Parse: every tree stays alive, as the trees of a worker's files
+    // would not, so the peak is an upper bound.
+    reset_peak_rss();
+    std::vector<TSTree *> trees;
+    Clock::time_point t0 = Clock::now();
+    for (const auto &src : corpus)
+      trees.push_back(ts_parser_parse_string(
+          parser, nullptr, src.data(), static_cast<uint32_t>(src.size())));
+    const double parse_s =
+        std::chrono::duration<double>(Clock::now() - t0).count();
+    const double parse_peak = peak_rss_kib();
+    for (size_t i = 0; i < corpus.size(); ++i)
+      totals.functions += builder->build(ts_tree_root_node(trees[i]),
+                                         corpus[i]).functions().size();
+    report_phase(flavor, "parse", parse_s, totals, parse_peak);
+
+    // GSG build alone.
+    reset_peak_rss();
+    t0 = Clock::now();
+    for (size_t i = 0; i < corpus.size(); ++i)
+      builder->build(ts_tree_root_node(trees[i]), corpus[i]);
+    report_phase(flavor, "build",
+                 std::chrono::duration<double>(Clock::now() - t0).count(),
+                 totals);
+
+    // Scoring of each built graph; the (reused) graph is rebuilt untimed.
+    reset_peak_rss();
+    double score_s = 0;
+    std::vector<report::Row> rows;
+    for (size_t i = 0; i < corpus.size(); ++i) {
+      const GSG &gsg = builder->build(ts_tree_root_node(trees[i]), corpus[i]);
+      const std::string file = "gen/file" + std::to_string(i);
+      t0 = Clock::now();
+      for (const auto &fn : gsg.functions())
+        rows.push_back(report::Row{file, function_complexity(gsg, fn)});
+      score_s += std::chrono::duration<double>(Clock::now() - t0).count();
+    }
+    report_phase(flavor, "score", score_s, totals);
+    for (TSTree *tree : trees) ts_tree_delete(tree);
+
+    // Output: the JSON and table printers into a sink.
+    reset_peak_rss();
+    NullBuffer sink;
+    std::streambuf *stdout_buf = std::cout.rdbuf(&sink);
+    t0 = Clock::now();
+    report::print_json(rows, NAME, 15, false, NORMAL);
+    report::print_table(rows, NAME, 0, 15, false, false, NORMAL);
+    const double output_s =
+        std::chrono::duration<double>(Clock::now() - t0).count();
+    std::cout.rdbuf(stdout_buf);
+    report_phase(flavor, "output", output_s, totals);
+  }
+  ts_parser_delete(parser);
+}
+
+}  // namespace bench
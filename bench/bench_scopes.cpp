@@ -0,0 +1,40 @@
+#include <string>
+
+#include "../include/cognitive_complexity.h"
+#include "./bench.h"
+
+namespace {
+
+// A header-only-library shape: `depth` alternating namespaces and classes,
+// each level holding `per_level` small member functions.
+std::string nested_scopes(unsigned int depth, unsigned int per_level) {
+  std::string src;
+  for (unsigned int d = 0; d < depth; ++d) {
+    const std::string n = std::to_string(d);
+    src += d % 2 ? "struct S" + n + " {\n" : "namespace n" + n + " {\n";
+    for (unsigned int i = 0; i < per_level; ++i) {
+      const std::string f = std::to_string(i);
+      src += "int f" + f + "(int x) { if (x > " + f +
+             ") { return 1; } return 0; }\n";
+    }
+  }
+  for (unsigned int d = depth; d-- > 0;) src += d % 2 ? "};\n" : "}\n";
+  return src;
+}
+
+}  // namespace
+
+namespace bench {
+
+void scopes() {
+  score_scaling(
+      tree_sitter_cpp(), Language::Cpp,
+      [](unsigned int depth) {
+        const unsigned int per_level = 4096 / depth;
+        return ScalingInput{nested_scopes(depth, per_level),
+                            depth * per_level};
+      },
+      {8, 32, 128, 512}, 3, "function", "nested scopes");
+}
+
+}  // namespace bench
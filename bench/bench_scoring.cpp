@@ -0,0 +1,76 @@
+#include <string>
+#include <vector>
+
+#include "../include/cognitive_complexity.h"
+#include "./bench.h"
+
+namespace {
+
+// Emits one function whose body is `depth` nested ifs, each preceded by a
+// boolean expression statement, so every level contributes lines.
+class NestedIfBuilder : public IBuilder {
+ public:
+  explicit NestedIfBuilder(unsigned int depth) : depth_(depth) {}
+
+ protected:
+  void build_functions(TSNode, std::string_view) override {
+    std::vector<GSGNode> open(depth_ + 1);
+    open[0].kind = GSGNodeKind::Function;
+    open[0].name = "nested";
+    open_node(open[0]);
+    for (unsigned int i = 1; i <= depth_; ++i) {
+      GSGNode e;
+      e.kind = GSGNodeKind::Expr;
+      e.loc = SourceLoc{i, 0, 10};
+      e.addl_cost = 1;
+      push_node(e);
+      open[i].kind = GSGNodeKind::If;
+      open[i].loc = SourceLoc{i, 2, 12};
+      open_node(open[i]);
+    }
+    for (unsigned int i = depth_; i > 0; --i) {
+      close_node(open[i]);
+      push_node(open[i]);
+    }
+    close_node(open[0]);
+    emit_function(open[0]);
+  }
+
+ private:
+  unsigned int depth_;
+};
+
+}  // namespace
+
+namespace bench {
+
+void scoring() {
+  for (unsigned int depth : {1000u, 2000u, 4000u, 8000u, 16000u}) {
+    NestedIfBuilder builder(depth);
+    const GSG &gsg = builder.build(TSNode{}, {});
+    const GSGNode &fn = gsg.functions().front();
+    const size_t nodes = gsg.node_count();
+    unsigned int complexity = 0;
+    const double s = best_of(5, [&] {
+      complexity = function_complexity(gsg, fn).complexity;
+    });
+    const std::string label = "depth " + std::to_string(depth);
+    report(label + " (complexity " + std::to_string(complexity) + ")", s,
+           nodes, "node");
+
+    // Whole walk: materialize the graph and score it, or score in-stream.
+    const double built = best_of(5, [&] {
+      const GSG &g = builder.build(TSNode{}, {});
+      complexity = function_complexity(g, g.functions().front()).complexity;
+    });
+    report(label + " build + score", built, nodes, "node");
+    std::vector<FunctionComplexity> out;
+    const double streamed = best_of(5, [&] {
+      out.clear();
+      builder.score(TSNode{}, {}, out);
+    });
+    report(label + " streamed", streamed, nodes, "node");
+  }
+}
+
+}  // namespace bench
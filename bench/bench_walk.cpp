@@ -0,0 +1,125 @@
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <signal.h>
+#include <sys/ptrace.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "../include/sourcing.h"
+#include "./bench.h"
+
+namespace {
+
+namespace fs = std::filesystem;
+
+// A tree of about `entries` files and directories: 100 subdirectories per
+// top-level one, 50 files of mixed languages in each, and a .gitignore at
+// the root that excludes a share of them.
+void generate_tree(const fs::path &root, unsigned int entries) {
+  const char *exts[] = {".py", ".c", ".js", ".ts", ".txt", ".md", ".cpp"};
+  fs::create_directories(root);
+  std::ofstream(root / ".gitignore") << "*.md\ngen_*\n";
+  unsigned int made = 1;
+  for (unsigned int top = 0; made < entries; ++top) {
+    const fs::path t = root / ("pkg" + std::to_string(top));
+    fs::create_directory(t);
+    ++made;
+    for (unsigned int sub = 0; sub < 100 && made < entries; ++sub) {
+      const fs::path s = t / ("mod" + std::to_string(sub));
+      fs::create_directory(s);
+      ++made;
+      for (unsigned int f = 0; f < 50 && made < entries; ++f, ++made)
+        std::ofstream(s / ((f % 10 == 9 ? "gen_" : "file") +
+                           std::to_string(f) + exts[f % 7]));
+    }
+  }
+}
+
+size_t walk_once(const fs::path &root, DirWalker walker,
+                 unsigned int threads) {
+  size_t files = 0;
+  collect_source_files(
+      {root.string()}, {}, {}, [&](SourceFile) { ++files; }, nullptr,
+      walker, threads);
+  return files;
+}
+
+#ifdef __linux__
+// Syscalls made by `fn`, counted by ptrace-ing a child process that runs
+// it (as strace -c would); -1 if the child cannot be traced.
+template <class F>
+long count_syscalls(F &&fn) {
+  const pid_t child = fork();
+  if (child < 0) return -1;
+  if (child == 0) {
+    if (ptrace(PTRACE_TRACEME, 0, nullptr, nullptr) != 0) _exit(1);
+    raise(SIGSTOP);
+    fn();
+    _exit(0);
+  }
+  int status = 0;
+  waitpid(child, &status, 0);
+  if (!WIFSTOPPED(status)) return -1;
+  ptrace(PTRACE_SETOPTIONS, child, nullptr,
+         reinterpret_cast<void *>(PTRACE_O_TRACESYSGOOD |
+                                  PTRACE_O_EXITKILL));
+  long stops = 0;
+  for (;;) {
+    if (ptrace(PTRACE_SYSCALL, child, nullptr, nullptr) != 0) break;
+    if (waitpid(child, &status, 0) < 0 || WIFEXITED(status) ||
+        WIFSIGNALED(status))
+      break;
+    if (WIFSTOPPED(status) && WSTOPSIG(status) == (SIGTRAP | 0x80)) ++stops;
+  }
+  // A stop on entry and on exit per call, but none after exit_group.
+  return (stops + 1) / 2;
+}
+#endif
+
+}  // namespace
+
+namespace bench {
+
+void walk() {
+  const unsigned int entries = settings().entries;
+  const fs::path root = fs::temp_directory_path() / "cognity_bench_walk";
+  fs::remove_all(root);
+  generate_tree(root, entries);
+
+  const struct {
+    const char *name;
+    DirWalker walker;
+    unsigned int threads;
+  } walkers[] = {{"filesystem", DirWalker::Filesystem, 1},
+                 {"native", DirWalker::Native, 1},
+                 {"native x4", DirWalker::Native, 4},
+                 {"native x8", DirWalker::Native, 8}};
+  walk_once(root, DirWalker::Filesystem, 1);  // warm the dentry cache
+  for (const auto &w : walkers) {
+    size_t files = 0;
+    const double s =
+        best_of(3, [&] { files = walk_once(root, w.walker, w.threads); });
+    report(std::string(w.name) + " walker (" + std::to_string(files) +
+               " files)",
+           s, entries, "entry");
+#ifdef __linux__
+    // ptrace follows only the thread that was traced.
+    if (w.threads > 1) continue;
+    const long calls =
+        count_syscalls([&] { walk_once(root, w.walker, w.threads); });
+    if (calls >= 0)
+      report(std::string(w.name) + " walker syscalls",
+             {{"syscalls", static_cast<double>(calls)},
+              {"per_entry", static_cast<double>(calls) / entries}});
+#endif
+  }
+  fs::remove_all(root);
+}
+
+}  // namespace bench
@@ -0,0 +1,104 @@
+#include "./corpus.h"
+
+namespace bench {
+
+namespace {
+
+std::string indent(unsigned int level) { return std::string(level * 4, ' '); }
+
+// The body of a Python function, from `level` (1-based) down to depth.
+void python_body(std::string &out, unsigned int level, unsigned int depth,
+                 unsigned int k) {
+  const std::string pad = indent(level);
+  const std::string n = std::to_string(k + level);
+  const std::string i = "i" + std::to_string(level);
+  switch ((k + level) % 3) {
+    case 0:
+      out += pad + "if x > " + n + " and y < " + n + " or not z:\n";
+      break;
+    case 1:
+      out += pad + "for " + i + " in range(x):\n";
+      break;
+    default:
+      out += pad + "while x < " + n + ":\n";
+      break;
+  }
+  if (level < depth)
+    python_body(out, level + 1, depth, k);
+  else
+    out += indent(level + 1) + "total += x if y else z\n";
+  if ((k + level) % 3 == 0)
+    out += pad + "else:\n" + indent(level + 1) + "total -= 1\n";
+  out += indent(level + 1) + "x += 1\n";
+}
+
+// The body of a C-family function (JavaScript, TypeScript, C, C++).
+void c_like_body(std::string &out, Language lang, unsigned int level,
+                 unsigned int depth, unsigned int k) {
+  const std::string pad = indent(level);
+  const std::string n = std::to_string(k + level);
+  const std::string i = "i" + std::to_string(level);
+  const char *decl = lang == Language::JavaScript   ? "let "
+                     : lang == Language::TypeScript ? "let "
+                                                    : "int ";
+  switch ((k + level) % 3) {
+    case 0:
+      out += pad + "if (x > " + n + " && y < " + n + " || !z) {\n";
+      break;
+    case 1:
+      out += pad + "for (" + decl + i + " = 0; " + i + " < x; " + i +
+             "++) {\n";
+      break;
+    default:
+      out += pad + "while (x < " + n + ") {\n";
+      break;
+  }
+  if (level < depth)
+    c_like_body(out, lang, level + 1, depth, k);
+  else
+    out += indent(level + 1) + "total += y ? x : z;\n";
+  out += indent(level + 1) + "x += 1;\n";
+  if ((k + level) % 3 == 0)
+    out += pad + "} else {\n" + indent(level + 1) + "total -= 1;\n";
+  out += pad + "}\n";
+}
+
+}  // namespace
+
+std::string generate_file(Language lang, const CorpusSpec &spec,
+                          unsigned int seed) {
+  std::string out;
+  const bool cpp = lang == Language::Cpp;
+  if (cpp) out += "namespace gen {\nclass Generated" + std::to_string(seed) +
+                  " {\n public:\n";
+  for (unsigned int f = 0; f < spec.functions; ++f) {
+    const unsigned int k = seed * 7 + f;
+    const std::string name = "f" + std::to_string(seed) + "_" +
+                             std::to_string(f);
+    if (lang == Language::Python) {
+      out += "def " + name + "(x, y, z):\n    total = 0\n";
+      if (spec.depth) python_body(out, 1, spec.depth, k);
+      out += "    return total\n\n\n";
+      continue;
+    }
+    switch (lang) {
+      case Language::JavaScript:
+        out += "function " + name + "(x, y, z) {\n    let total = 0;\n";
+        break;
+      case Language::TypeScript:
+        out += "function " + name +
+               "(x: number, y: number, z: number): number {\n"
+               "    let total = 0;\n";
+        break;
+      default:
+        out += "int " + name + "(int x, int y, int z) {\n    int total = 0;\n";
+        break;
+    }
+    if (spec.depth) c_like_body(out, lang, 1, spec.depth, k);
+    out += "    return total;\n}\n\n";
+  }
+  if (cpp) out += "};\n}  // namespace gen\n";
+  return out;
+}
+
+}  // namespace bench
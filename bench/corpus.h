@@ -0,0 +1,22 @@
+#pragma once
+
+#include <string>
+
+#include "../include/gsg.h"
+
+namespace bench {
+
+// Shape of a generated source file.
+struct CorpusSpec {
+  unsigned int functions = 50;  // top-level functions (C++: in a class)
+  unsigned int depth = 4;       // nesting depth of each function body
+};
+
+// A syntactically valid `lang` file of `spec.functions` functions whose
+// bodies nest ifs (with boolean conditions), loops and else branches
+// `spec.depth` levels deep. `seed` varies names and constants, so files of
+// one corpus differ while staying the same size.
+std::string generate_file(Language lang, const CorpusSpec &spec,
+                          unsigned int seed);
+
+}  // namespace bench
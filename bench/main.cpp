@@ -0,0 +1,142 @@
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "./bench.h"
+
+namespace {
+
+struct Benchmark {
+  const char *name;
+  void (*run)();
+};
+
+constexpr Benchmark kBenchmarks[] = {
+    {"scoring", bench::scoring},
+    {"builders", bench::builders},
+    {"scopes", bench::scopes},
+    {"pipeline", bench::pipeline},
+    {"gitignore", bench::gitignore},
+    {"bool_chains", bench::bool_chains},
+    {"lambdas", bench::lambdas},
+    {"walk", bench::walk},
+};
+
+bench::Settings g_settings;
+
+// With --json, results are kept until the end of the run.
+struct Record {
+  std::string benchmark;
+  std::string label;
+  bench::Fields fields;
+};
+std::vector<Record> g_records;
+const char *g_current = "";
+
+void print_json(std::ostream &os) {
+  os << "{\"benchmarks\": [";
+  for (size_t i = 0; i < g_records.size(); ++i) {
+    const Record &r = g_records[i];
+    os << (i ? ",\n" : "\n") << "  {\"benchmark\": \"" << r.benchmark
+       << "\", \"label\": \"" << r.label << '"';
+    for (const auto &[name, value] : r.fields)
+      os << ", \"" << name << "\": " << std::setprecision(9) << value;
+    os << '}';
+  }
+  if (!g_records.empty()) os << '\n';
+  os << "]}\n";
+}
+
+// Parse a non-negative count for `flag`; false if it is missing or invalid.
+bool read_count(int argc, char **argv, int &i, unsigned int &out) {
+  if (++i >= argc) return false;
+  char *end = nullptr;
+  const unsigned long v = std::strtoul(argv[i], &end, 10);
+  if (*argv[i] == '\0' || *end != '\0') return false;
+  out = static_cast<unsigned int>(v);
+  return true;
+}
+
+}  // namespace
+
+namespace bench {
+
+const Settings &settings() { return g_settings; }
+
+void report(const std::string &label, double seconds, size_t n,
+            const char *unit) {
+  const double per_unit =
+      n ? seconds * 1e9 / static_cast<double>(n) : 0.0;
+  if (g_settings.json) {
+    g_records.push_back(Record{g_current, label,
+                               {{"ms", seconds * 1e3},
+                                {std::string("ns_per_") + unit, per_unit}}});
+    return;
+  }
+  std::ios_base::fmtflags flags = std::cout.flags();
+  std::cout << "  " << label << ": " << std::fixed << std::setprecision(3)
+            << seconds * 1e3 << " ms, " << std::setprecision(1) << per_unit
+            << " ns/" << unit << '\n';
+  std::cout.flags(flags);
+}
+
+void report(const std::string &label, const Fields &fields) {
+  if (g_settings.json) {
+    g_records.push_back(Record{g_current, label, fields});
+    return;
+  }
+  std::ios_base::fmtflags flags = std::cout.flags();
+  std::cout << "  " << label << ":" << std::fixed << std::setprecision(3);
+  for (size_t i = 0; i < fields.size(); ++i)
+    std::cout << (i ? ", " : " ") << fields[i].first << ' '
+              << fields[i].second;
+  std::cout << '\n';
+  std::cout.flags(flags);
+}
+
+}  // namespace bench
+
+int main(int argc, char **argv) {
+  std::vector<const char *> names;
+  for (int i = 1; i < argc; ++i) {
+    unsigned int *count = nullptr;
+    if (std::strcmp(argv[i], "--json") == 0)
+      g_settings.json = true;
+    else if (std::strcmp(argv[i], "--files") == 0)
+      count = &g_settings.files;
+    else if (std::strcmp(argv[i], "--functions") == 0)
+      count = &g_settings.functions;
+    else if (std::strcmp(argv[i], "--depth") == 0)
+      count = &g_settings.depth;
+    else if (std::strcmp(argv[i], "--entries") == 0)
+      count = &g_settings.entries;
+    else
+      names.push_back(argv[i]);
+    if (count && !read_count(argc, argv, i, *count)) {
+      std::cerr << "Expected a number after " << argv[i - 1] << '\n';
+      return 1;
+    }
+  }
+
+  bool ran = false;
+  for (const auto &b : kBenchmarks) {
+    bool selected = names.empty();
+    for (const char *name : names) selected |= std::strcmp(name, b.name) == 0;
+    if (!selected) continue;
+    if (!g_settings.json) std::cout << b.name << '\n';
+    g_current = b.name;
+    b.run();
+    ran = true;
+  }
+  if (!ran) {
+    std::cerr << "Unknown benchmark; available:";
+    for (const auto &b : kBenchmarks) std::cerr << ' ' << b.name;
+    std::cerr << '\n';
+    return 1;
+  }
+  if (g_settings.json) print_json(std::cout);
+  return 0;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+
+// Resident set size of this process in KiB (Linux, from /proc/self/status);
+// 0 where unknown. reset_peak_rss() restarts the peak (VmHWM) at the
+// current size, so peak_rss_kib() covers only what ran after it.
+namespace bench {
+
+inline double status_kib(const char *key) {
+#ifdef __linux__
+  std::ifstream status("/proc/self/status");
+  const std::string prefix = key;
+  std::string line;
+  while (std::getline(status, line))
+    if (line.rfind(prefix, 0) == 0)
+      return std::stod(line.substr(prefix.size()));
+#else
+  (void)key;
+#endif
+  return 0;
+}
+
+inline void reset_peak_rss() {
+#ifdef __linux__
+  std::ofstream("/proc/self/clear_refs") << "5";
+#endif
+}
+
+inline double peak_rss_kib() { return status_kib("VmHWM:"); }
+inline double rss_kib() { return status_kib("VmRSS:"); }
+
+}  // namespace bench
@@ -0,0 +1,36 @@
+#include <string>
+#include <vector>
+
+#include "../include/cognitive_complexity.h"
+#include "./bench.h"
+
+namespace bench {
+
+void score_scaling(const TSLanguage *language, Language lang,
+                   const std::function<ScalingInput(unsigned int)> &generate,
+                   std::initializer_list<unsigned int> sizes, int reps,
+                   const char *unit, const char *what) {
+  TSParser *parser = ts_parser_new();
+  ts_parser_set_language(parser, language);
+  auto builder = make_builder(lang);
+  for (unsigned int size : sizes) {
+    const ScalingInput input = generate(size);
+    const std::string &src = input.source;
+    TSTree *tree = ts_parser_parse_string(parser, nullptr, src.data(),
+                                          static_cast<uint32_t>(src.size()));
+    const TSNode root = ts_tree_root_node(tree);
+    std::vector<FunctionComplexity> out;
+    const double s = best_of(reps, [&] {
+      out.clear();
+      builder->score(root, src, out);
+    });
+    report(std::to_string(size) + " " + what + " (" +
+               std::to_string(out.size()) + " functions, complexity " +
+               std::to_string(out.empty() ? 0 : out[0].complexity) + ")",
+           s, input.units, unit);
+    ts_tree_delete(tree);
+  }
+  ts_parser_delete(parser);
+}
+
+}  // namespace bench
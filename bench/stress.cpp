@@ -0,0 +1,206 @@
+// Deep-nesting stress test, built as the cognity_stress target:
+//
+//   cognity_stress [max-depth]   (default 100000)
+//
+// Every case generates one file at max/8, max/4, max/2 and max levels of
+// nesting (blocks, else-if chains, boolean operands, namespaces), parses it
+// and scores it both streamed and through a built GSG. The walks keep their
+// state on the heap, so none of this may overflow the stack, and the time
+// and peak RSS per level must stay about flat as the depth grows. Exits 1
+// when a case grows faster than linearly; a crash means a walk recurses.
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include "../include/cognitive_complexity.h"
+#include "./bench.h"
+#include "./rss.h"
+
+namespace {
+
+struct Case {
+  const char *name;
+  const TSLanguage *(*language)();
+  Language lang;
+  std::function<std::string(unsigned int)> generate;
+};
+
+std::string repeat(const std::string &s, unsigned int n) {
+  std::string out;
+  out.reserve(s.size() * n);
+  for (unsigned int i = 0; i < n; ++i) out += s;
+  return out;
+}
+
+// `depth` operands alternating between && and ||, so every operator
+// starts a new sequence.
+std::string bool_chain(unsigned int depth, const char *a, const char *o) {
+  std::string s = "x0";
+  for (unsigned int i = 1; i < depth; ++i)
+    s += std::string(i % 2 ? a : o) + "x" + std::to_string(i % 10);
+  return s;
+}
+
+const Case kCases[] = {
+    {"c nested ifs", tree_sitter_c, Language::C,
+     [](unsigned int d) {
+       return "int f(int x) {\n" + repeat("if (x) {\n", d) + "x++;\n" +
+              repeat("}\n", d) + "return x;\n}\n";
+     }},
+    {"c else-if chain", tree_sitter_c, Language::C,
+     [](unsigned int d) {
+       return "int f(int x) {\n" +
+              repeat("if (x == 1) {\nx++;\n} else ", d) +
+              "{\nx--;\n}\nreturn x;\n}\n";
+     }},
+    {"c boolean operands", tree_sitter_c, Language::C,
+     [](unsigned int d) {
+       return "int f(int x0, int x1) {\nif (" +
+              bool_chain(d, " && ", " || ") + ") {\nreturn 1;\n}\n" +
+              "return 0;\n}\n";
+     }},
+    // Unnamed, so the qualified names (which grow with every named
+    // scope) stay short.
+    {"cpp nested namespaces", tree_sitter_cpp, Language::Cpp,
+     [](unsigned int d) {
+       return repeat("namespace {\n", d) +
+              "int f(int x) {\nif (x) {\nreturn 1;\n}\nreturn 0;\n}\n" +
+              repeat("}\n", d);
+     }},
+    {"javascript nested ifs", tree_sitter_javascript, Language::JavaScript,
+     [](unsigned int d) {
+       return "function f(x) {\n" + repeat("if (x) {\n", d) + "x++;\n" +
+              repeat("}\n", d) + "return x;\n}\n";
+     }},
+    {"javascript else-if chain", tree_sitter_javascript,
+     Language::JavaScript,
+     [](unsigned int d) {
+       return "function f(x) {\n" +
+              repeat("if (x === 1) {\nx++;\n} else ", d) +
+              "{\nx--;\n}\nreturn x;\n}\n";
+     }},
+    {"javascript boolean operands", tree_sitter_javascript,
+     Language::JavaScript,
+     [](unsigned int d) {
+       return "function f(x0, x1) {\nif (" +
+              bool_chain(d, " && ", " || ") + ") {\nreturn 1;\n}\n" +
+              "return 0;\n}\n";
+     }},
+    // Python blocks nest by indentation, which makes a deep file
+    // quadratic in size; expressions nest without it.
+    {"python boolean operands", tree_sitter_python, Language::Python,
+     [](unsigned int d) {
+       return "def f(x0, x1):\n    if " + bool_chain(d, " and ", " or ") +
+              ":\n        return 1\n    return 0\n";
+     }},
+    {"python nested not", tree_sitter_python, Language::Python,
+     [](unsigned int d) {
+       return "def f(x):\n    if " + repeat("not ", d) +
+              "x:\n        return 1\n    return 0\n";
+     }},
+};
+
+struct Run {
+  unsigned int depth;
+  double seconds;
+  double kib;
+};
+
+// Parse `src`, score it streamed and through a built GSG, and free the
+// tree; returns the complexity of the first function.
+unsigned int run_once(TSParser *parser, IBuilder &builder,
+                      const std::string &src) {
+  TSTree *tree = ts_parser_parse_string(parser, nullptr, src.data(),
+                                        static_cast<uint32_t>(src.size()));
+  const TSNode root = ts_tree_root_node(tree);
+  std::vector<FunctionComplexity> out;
+  builder.score(root, src, out);
+  const GSG &gsg = builder.build(root, src);
+  unsigned int built = 0;
+  for (const auto &fn : gsg.functions())
+    built += function_complexity(gsg, fn).complexity;
+  ts_tree_delete(tree);
+  unsigned int streamed = 0;
+  for (const auto &f : out) streamed += f.complexity;
+  if (streamed != built) {
+    std::cerr << "streamed and built scores differ: " << streamed
+              << " != " << built << '\n';
+    std::exit(1);
+  }
+  return out.empty() ? 0 : out[0].complexity;
+}
+
+// Peak RSS in KiB added by one run, over what the process held before.
+double run_kib(TSParser *parser, IBuilder &builder, const std::string &src) {
+#ifdef __GLIBC__
+  malloc_trim(0);
+#endif
+  const double before = bench::rss_kib();
+  bench::reset_peak_rss();
+  run_once(parser, builder, src);
+  const double peak = bench::peak_rss_kib();
+  return peak > before ? peak - before : 0;
+}
+
+// Whether run `b` costs at most `factor` times what run `a` does per level,
+// give or take `slack` for fixed costs and noise.
+bool linear(const Run &a, const Run &b, double Run::*cost, double factor,
+            double slack) {
+  return b.*cost <= factor * (a.*cost / a.depth) * b.depth + slack;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  unsigned int max_depth = 100000;
+  if (argc > 1) max_depth = static_cast<unsigned int>(std::atoi(argv[1]));
+  if (max_depth < 8) {
+    std::cerr << "usage: cognity_stress [max-depth >= 8]\n";
+    return 2;
+  }
+
+  TSParser *parser = ts_parser_new();
+  bool ok = true;
+  for (const auto &c : kCases) {
+    std::cout << c.name << '\n';
+    ts_parser_set_language(parser, c.language());
+    auto builder = make_builder(c.lang);
+    std::vector<Run> runs;
+    for (unsigned int depth :
+         {max_depth / 8, max_depth / 4, max_depth / 2, max_depth}) {
+      const std::string src = c.generate(depth);
+      unsigned int complexity = 0;
+      const double s = bench::best_of(
+          3, [&] { complexity = run_once(parser, *builder, src); });
+      const double kib = run_kib(parser, *builder, src);
+      runs.push_back(Run{depth, s, kib});
+      std::cout << "  depth " << depth << " (complexity " << complexity
+                << "): " << std::fixed << std::setprecision(3) << s * 1e3
+                << " ms, " << std::setprecision(1) << s * 1e9 / depth
+                << " ns/level, " << kib << " KiB peak, "
+                << std::setprecision(3) << kib / depth << " KiB/level\n";
+    }
+    // Against the smallest depth: 4x the time per level (timing noise,
+    // cache effects) and 2x the memory per level (allocator growth) are
+    // still linear; quadratic growth is 8x at max/8.
+    const Run &a = runs.front();
+    const Run &b = runs.back();
+    if (!linear(a, b, &Run::seconds, 4, 0.05)) {
+      std::cout << "  FAIL: time grows faster than the depth\n";
+      ok = false;
+    }
+    if (!linear(a, b, &Run::kib, 2, 8192)) {
+      std::cout << "  FAIL: peak RSS grows faster than the depth\n";
+      ok = false;
+    }
+  }
+  ts_parser_delete(parser);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "./cli_arguments.h"
+#include "./output.h"
+#include "./result_cache.h"
+#include "./sourcing.h"
+
+namespace analysis {
+
+// Receives each file that was not analysed and why (in input order).
+using SkipSink =
+    std::function<void(const std::string &path, const std::string &reason)>;
+
+// How to analyze each file.
+struct Options {
+  SortType sort = NAME;
+  unsigned int jobs = 1;
+  // Optional persistent result cache, shared by all workers.
+  cache::ResultCache *cache = nullptr;
+  // Called for every directory analyze_sources walks (see DirSink).
+  DirSink on_dir;
+  // Per-file limits; a file over one is skipped and reported through
+  // on_skip. 0 means no limit.
+  std::uintmax_t max_file_bytes = 0;
+  std::uint64_t parse_timeout_ms = 0;  // parses are abandoned after this
+  size_t max_gsg_nodes = 0;            // see IBuilder::set_node_limit
+  SkipSink on_skip;
+  // Map files rather than read them (see SourceBuffer::open); a long-lived
+  // process clears this so a file truncated mid-parse cannot SIGBUS it.
+  bool map_files = true;
+};
+
+// Timing collected during analyze_files / analyze_sources (used by --stats).
+struct RunStats {
+  unsigned int workers = 0;
+  size_t steals = 0;
+  double wall_seconds = 0;
+  // Time spent walking directories, and until the first file was analyzed.
+  double discovery_seconds = 0;
+  double first_result_seconds = 0;
+  // Time spent loading and analyzing each input file, by input position.
+  std::vector<double> file_seconds;
+  // Per worker: total busy time, and when it ran out of work (since start).
+  std::vector<double> worker_busy_seconds;
+  std::vector<double> worker_done_seconds;
+  // Result cache counters (all zero when no cache is used).
+  bool cache_enabled = false;
+  size_t cache_hits = 0;
+  size_t cache_stat_hits = 0;  // hits that skipped reading the file
+  size_t cache_misses = 0;
+  size_t cache_evicted = 0;
+};
+
+// Why a file of `bytes` bytes is not analysed under `max_file_bytes`, or ""
+// if it is within the limit (0 is none).
+std::string over_size_limit(std::uintmax_t bytes,
+                            std::uintmax_t max_file_bytes);
+// Why a file whose parse was abandoned after `timeout_ms` is not analysed.
+std::string parse_timed_out(std::uint64_t timeout_ms);
+
+// Resolve the --jobs value: 0 (or anything below 1) means "one worker per
+// hardware thread".
+unsigned int resolve_jobs(int requested);
+
+// Analyze `files` with up to `opts.jobs` worker threads. Each worker owns its own
+// parsers (a ParserPool) and builders, and work is scheduled largest file
+// first with work stealing. Rows are returned grouped by file in the order of
+// `files`, exactly as a serial run would produce them; skipped files have no
+// rows.
+//
+// Throws std::runtime_error with the message of the first file (in input
+// order) that could not be read. When a cache is given, unchanged files are
+// served from it and the cache is trimmed to its size bound afterwards.
+std::vector<report::Row> analyze_files(const std::vector<SourceFile> &files,
+                                       const Options &opts,
+                                       RunStats *stats = nullptr);
+
+// Streaming variant used by the CLI: discovery (collect_source_files) runs on
+// the calling thread and opts.jobs - 1 more and feeds a bounded queue that
+// the workers consume, so parsing overlaps with the directory walk. `files`
+// receives the discovered files sorted by path; rows follow that order as in
+// analyze_files.
+std::vector<report::Row> analyze_sources(
+    const std::vector<std::string> &inputs, const std::vector<Language> &filter,
+    const std::vector<std::string> &excludes, const Options &opts,
+    std::vector<SourceFile> &files, RunStats *stats = nullptr);
+
+// Human-readable summary for --stats, including per-file tail latency.
+void print_stats(const RunStats &stats, const std::vector<SourceFile> &files,
+                 std::ostream &os);
+
+}  // namespace analysis
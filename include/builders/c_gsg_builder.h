@@ -1,40 +1,139 @@
 #ifndef C_GSG_BUILDER_H
 #define C_GSG_BUILDER_H
 
+#include <string>
+#include <vector>
+
+#include "../../include/builders/symbol_table.h"
 #include "../../include/gsg.h"
 
 // Minimal C/C++ builder (reused for both languages)
 class CLikeGSGBuilder : public IBuilder {
  public:
-  std::vector<GSGNode> build_functions(TSNode root,
-                                       const std::string &source) override;
+  CLikeGSGBuilder();
+
+  // Node types and fields the builder dispatches on (see SymbolTable).
+  enum class Sym : unsigned char {
+    Other,
+    BinaryExpression,
+    CaseStatement,
+    ClassSpecifier,
+    ConditionalExpression,
+    Declaration,
+    DefaultStatement,
+    DoStatement,
+    ExpressionStatement,
+    FieldDeclarationList,
+    FieldIdentifier,
+    ForStatement,
+    FunctionDefinition,
+    Identifier,
+    IfStatement,
+    LambdaExpression,
+    NamespaceDefinition,
+    ReturnStatement,
+    StructSpecifier,
+    SwitchStatement,
+    TemplateDeclaration,
+    UnaryExpression,
+    UnionSpecifier,
+    WhileStatement,
+  };
+  enum class Field : unsigned char {
+    Alternative,
+    Argument,
+    Body,
+    Condition,
+    Consequence,
+    Declarator,
+    Left,
+    Name,
+    Right,
+  };
+
+ protected:
+  void build_functions(TSNode root, std::string_view source) override;
+  void build_statement(TSNode s, std::string_view src, int nesting) override;
 
  private:
+  Sym t(TSNode n) const { return syms_(n); }
+  TSNode field(TSNode n, Field f) const { return syms_.child(n, f); }
+
   static SourceLoc loc(TSNode n);
-  static std::string_view slice(const std::string &src, TSNode n);
-  static std::string function_name_from_declarator(TSNode decl,
-                                                   const std::string &src);
-
-  void collect_functions_in_scope(TSNode n, const std::string &src,
-                                  const std::string &qual,
-                                  std::vector<GSGNode> &out);
-  GSGNode build_function(TSNode n, const std::string &src);
-  GSGNode build_function(TSNode n, const std::string &src,
-                         const std::string &qual);
-  void build_block_children(TSNode n, const std::string &src,
-                            std::vector<GSGNode> &out, int nesting = 0);
-  GSGNode build_if(TSNode n, const std::string &src);
-  GSGNode build_while(TSNode n, const std::string &src);
-  GSGNode build_for(TSNode n, const std::string &src);
-  GSGNode build_do_while(TSNode n, const std::string &src);
-
-  static unsigned int c_count_bool_ops_expr(TSNode n, int nesting,
-                                            const std::string &src);
+  static std::string_view slice(std::string_view src, TSNode n);
+  std::string_view function_name_from_declarator(TSNode decl,
+                                                 std::string_view src) const;
+  // Push `scope`'s name (if it has one) onto scope_; returns the size to
+  // resize scope_ back to when leaving it.
+  size_t enter_scope(TSNode scope, std::string_view src);
+
+  void collect_functions_in_scope(TSNode n, std::string_view src,
+                                  std::string_view qual);
+  void schedule_scope_children(TSNode n, std::string_view src,
+                               std::string_view qual);
+  std::string_view nested_qual(std::string_view qual, std::string_view name);
+  GSGNode build_function(TSNode n, std::string_view src);
+  GSGNode build_function(TSNode n, std::string_view src,
+                         std::string_view qual);
+  GSGNode build_or_stub(TSNode n, std::string_view src, std::string_view qual);
+  std::string_view qualify(std::string_view name, std::string_view qual);
+  void schedule_if(TSNode n, std::string_view src);
+  void schedule_while(TSNode n, std::string_view src);
+  void schedule_for(TSNode n);
+  void schedule_do_while(TSNode n, std::string_view src);
+
+  // Boolean operator cost of expression `n` (see the .cpp).
+  unsigned int c_count_bool_ops_expr(TSNode n, int nesting,
+                                     std::string_view src) const;
+  // Logical operator text of a node inside the expression last indexed:
+  // op is 0 if it holds "&&", else 1 if it holds "||", else -1.
+  struct LogicalText {
+    int op = -1;
+    bool bang = false;
+  };
+  struct LogicalCounts {
+    uint32_t ands = 0, ors = 0, bangs = 0;
+  };
+  void index_logical_text(TSNode n, std::string_view src) const;
+  LogicalText logical_text(TSNode n) const;
 
   // lambdas
-  static void collect_lambdas_in_node(TSNode n, const std::string &src,
-                                      std::vector<GSGNode> &out);
-  static GSGNode build_lambda(TSNode n, const std::string &src);
+  void collect_statement_lambdas(TSNode s);
+  void collect_if_lambdas(TSNode n);
+  void collect_lambdas_in_node(TSNode n);
+  void schedule_lambda(TSNode n);
+
+  SymbolTable<Sym, Field> syms_;
+  // Named class/struct/union/namespace scopes around the current point of
+  // the descent, "::"-joined.
+  std::string scope_;
+  // For expression n indexed by index_logical_text: the operator counts
+  // before each byte of n, from n's first byte (logical_begin_).
+  mutable std::vector<LogicalCounts> logical_before_;
+  mutable uint32_t logical_begin_ = 0;
+  // Work stack of c_count_bool_ops_expr: a node and, for an operand, how
+  // many binary expressions above it share its chain.
+  struct Pending {
+    TSNode node;
+    unsigned int chain;
+  };
+  mutable std::vector<Pending> stack_;
+  // Work stack of collect_functions_in_scope.
+  enum class ScopeOp : unsigned char {
+    Children,          // the named children of `node`, with `qual`
+    Function,          // a function definition
+    TemplateFunction,  // a function definition inside a template
+    Scope,             // enter scope `node`, then its `body`'s children
+    Restore,           // leave a scope: resize scope_ to `mark`
+  };
+  struct ScopeWork {
+    ScopeOp op;
+    TSNode node;
+    TSNode body;
+    std::string_view qual;
+    size_t mark;
+  };
+  std::vector<ScopeWork> scope_work_;
 };
 
 #endif
@@ -1,29 +1,91 @@
 #ifndef JAVASCRIPT_GSG_BUILDER_H
 #define JAVASCRIPT_GSG_BUILDER_H
 
+#include <vector>
+
+#include "../../include/builders/symbol_table.h"
 #include "../../include/gsg.h"
 
 class JavaScriptGSGBuilder : public IBuilder {
  public:
-  std::vector<GSGNode> build_functions(TSNode root,
-                                       const std::string &source) override;
+  JavaScriptGSGBuilder();
+
+  // Node types and fields the builder dispatches on (see SymbolTable).
+  enum class Sym : unsigned char {
+    Other,
+    BinaryExpression,
+    ClassDeclaration,
+    ConditionalExpression,
+    DoStatement,
+    ExpressionStatement,
+    ForStatement,
+    FunctionDeclaration,
+    Identifier,
+    IfStatement,
+    LexicalDeclaration,
+    MethodDefinition,
+    ParenthesizedExpression,
+    PropertyIdentifier,
+    ReturnStatement,
+    SwitchCase,
+    SwitchDefault,
+    SwitchStatement,
+    ThrowStatement,
+    UnaryExpression,
+    VariableDeclaration,
+    WhileStatement,
+  };
+  enum class Field : unsigned char {
+    Alternative,
+    Argument,
+    Body,
+    Condition,
+    Consequence,
+    Consequent,
+    Expression,
+    Left,
+    Name,
+    Right,
+  };
+  enum class BoolOp { And, Or, Not, Unknown };
+
+ protected:
+  void build_functions(TSNode root, std::string_view source) override;
+  void build_statement(TSNode s, std::string_view src, int nesting) override;
 
  private:
+  Sym t(TSNode n) const { return syms_(n); }
+  TSNode field(TSNode n, Field f) const { return syms_.child(n, f); }
+
   static SourceLoc loc(TSNode n);
-  static std::string_view slice(const std::string &src, TSNode n);
-  static std::string_view name_of(TSNode n, const std::string &src);
+  static std::string_view slice(std::string_view src, TSNode n);
+  std::string_view name_of(TSNode n, std::string_view src) const;
 
-  GSGNode build_function(TSNode n, const std::string &src);
-  void build_block_children(TSNode n, const std::string &src,
-                            std::vector<GSGNode> &out, int nesting);
-  GSGNode build_if(TSNode n, const std::string &src);
-  GSGNode build_while(TSNode n, const std::string &src);
-  GSGNode build_for(TSNode n, const std::string &src);
-  GSGNode build_do_while(TSNode n, const std::string &src);
+  GSGNode build_or_stub(TSNode n, std::string_view src);
+  GSGNode build_function(TSNode n, std::string_view src);
+  GSGNode function_node(TSNode n, std::string_view src) const;
+  void schedule_if(TSNode n, std::string_view src);
+  void schedule_while(TSNode n, std::string_view src);
+  void schedule_for(TSNode n);
+  void schedule_do_while(TSNode n, std::string_view src);
 
   // expression costs
-  static unsigned int js_count_bool_ops_expr(TSNode n, int nesting,
-                                             const std::string &src);
+  unsigned int js_count_bool_ops_expr(TSNode n, int nesting,
+                                      std::string_view src) const;
+  unsigned int js_count_bool_alternations(TSNode n,
+                                          std::string_view src) const;
+  unsigned int js_local_alternations(TSNode n, std::string_view src) const;
+  BoolOp js_get_bool_op(TSNode n, std::string_view src) const;
+  TSNode js_unwrap_parens(TSNode n) const;
+
+  SymbolTable<Sym, Field> syms_;
+  // Work stack of the expression walks: a node and, for an operand, how
+  // many binary expressions above it share its chain.
+  struct Pending {
+    TSNode node;
+    unsigned int chain;
+  };
+  mutable std::vector<Pending> stack_;
 };
 
 #endif
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <tree_sitter/api.h>
+
+#include <cstddef>
+#include <deque>
+
+// Named children of a node, in order, walked with a TSTreeCursor:
+//
+//   for (TSNode ch : NamedChildren(n)) ...
+//
+// ts_node_named_child(n, i) rescans n's children from the first one, so an
+// indexed loop over a wide node (thousands of top-level functions, a long
+// switch) is quadratic; the cursor steps to the next sibling in constant
+// time. Cursors are kept per thread, one per loop active at a time, so a
+// warm walk does not allocate. Loops must nest (the range is not movable).
+// A null node has no children.
+class NamedChildren {
+ public:
+  class iterator {
+   public:
+    TSNode operator*() const { return ts_tree_cursor_current_node(cursor_); }
+    iterator &operator++() {
+      if (!next(cursor_)) cursor_ = nullptr;
+      return *this;
+    }
+    bool operator==(const iterator &o) const { return cursor_ == o.cursor_; }
+
+   private:
+    friend class NamedChildren;
+    explicit iterator(TSTreeCursor *cursor) : cursor_(cursor) {}
+    TSTreeCursor *cursor_;
+  };
+
+  explicit NamedChildren(TSNode parent) : pool_(pool()) {
+    if (ts_node_is_null(parent)) return;
+    if (pool_.active == pool_.cursors.size())
+      pool_.cursors.push_back(ts_tree_cursor_new(parent));
+    else
+      ts_tree_cursor_reset(&pool_.cursors[pool_.active], parent);
+    cursor_ = &pool_.cursors[pool_.active++];
+  }
+  ~NamedChildren() {
+    if (cursor_) --pool_.active;
+  }
+  NamedChildren(const NamedChildren &) = delete;
+  NamedChildren &operator=(const NamedChildren &) = delete;
+
+  iterator begin() {
+    if (!cursor_ || !ts_tree_cursor_goto_first_child(cursor_)) return end();
+    if (!ts_node_is_named(ts_tree_cursor_current_node(cursor_)) &&
+        !next(cursor_))
+      return end();
+    return iterator(cursor_);
+  }
+  iterator end() { return iterator(nullptr); }
+
+ private:
+  struct Pool {
+    std::deque<TSTreeCursor> cursors;  // stable addresses as it grows
+    size_t active = 0;
+    ~Pool() {
+      for (auto &c : cursors) ts_tree_cursor_delete(&c);
+    }
+  };
+  static Pool &pool() {
+    static thread_local Pool p;
+    return p;
+  }
+  // Step to the next named sibling; false at the end.
+  static bool next(TSTreeCursor *c) {
+    while (ts_tree_cursor_goto_next_sibling(c))
+      if (ts_node_is_named(ts_tree_cursor_current_node(c))) return true;
+    return false;
+  }
+
+  Pool &pool_;
+  TSTreeCursor *cursor_ = nullptr;
+};
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <tree_sitter/api.h>
+
+#include <cstddef>
+#include <deque>
+
+// Visit `root` and its named descendants in preorder with one TSTreeCursor
+// instead of recursion, so an expression nested thousands deep (a long
+// `a && b && ...` chain) cannot exhaust the stack:
+//
+//   preorder(expr, [&](TSNode n) {
+//     ...
+//     return true;  // false: skip n's descendants
+//   });
+//
+// The cursor keeps its path on the heap. Cursors are kept per thread, one
+// per walk active at a time (walks may nest), so a warm walk does not
+// allocate. A null root is not visited.
+namespace preorder_detail {
+
+struct Pool {
+  std::deque<TSTreeCursor> cursors;
+  size_t active = 0;
+  ~Pool() {
+    for (auto &c : cursors) ts_tree_cursor_delete(&c);
+  }
+};
+
+inline Pool &pool() {
+  static thread_local Pool p;
+  return p;
+}
+
+}  // namespace preorder_detail
+
+template <class Visit>
+void preorder(TSNode root, Visit &&visit) {
+  if (ts_node_is_null(root) || !visit(root)) return;
+  auto &pool = preorder_detail::pool();
+  if (pool.active == pool.cursors.size())
+    pool.cursors.push_back(ts_tree_cursor_new(root));
+  else
+    ts_tree_cursor_reset(&pool.cursors[pool.active], root);
+  TSTreeCursor *c = &pool.cursors[pool.active++];
+  struct Release {
+    preorder_detail::Pool &pool;
+    ~Release() { --pool.active; }
+  } release{pool};
+
+  if (!ts_tree_cursor_goto_first_child(c)) return;
+  for (;;) {
+    const TSNode n = ts_tree_cursor_current_node(c);
+    // Anonymous nodes are tokens: nothing below them to visit.
+    if (ts_node_is_named(n) && visit(n) && ts_tree_cursor_goto_first_child(c))
+      continue;
+    while (!ts_tree_cursor_goto_next_sibling(c))
+      if (!ts_tree_cursor_goto_parent(c) ||
+          ts_tree_cursor_current_depth(c) == 0)
+        return;
+  }
+}
@@ -1,33 +1,85 @@
 #ifndef PYTHON_GSG_BUILDER_H
 #define PYTHON_GSG_BUILDER_H
 
+#include <vector>
+
+#include "../../include/builders/symbol_table.h"
 #include "../../include/gsg.h"
 
 class PythonGSGBuilder : public IBuilder {
  public:
-  std::vector<GSGNode> build_functions(TSNode root,
-                                       const std::string &source) override;
+  PythonGSGBuilder();
+
+  // Node types and fields the builder dispatches on (see SymbolTable).
+  enum class Sym : unsigned char {
+    Other,
+    AssertStatement,
+    Assignment,
+    AugmentedAssignment,
+    Block,
+    BooleanOperator,
+    CaseClause,
+    ClassDefinition,
+    ComparisonOperator,
+    ConditionalExpression,
+    DecoratedDefinition,
+    ElifClause,
+    ElseClause,
+    ExceptClause,
+    Expression,
+    ExpressionStatement,
+    FinallyClause,
+    ForStatement,
+    FunctionDefinition,
+    IfStatement,
+    MatchStatement,
+    NotOperator,
+    RaiseStatement,
+    ReturnStatement,
+    SimpleStatement,  // _simple_statement
+    TryStatement,
+    WhileStatement,
+    WithStatement,
+  };
+  enum class Field : unsigned char {
+    Body,
+    Condition,
+    Consequence,
+    Definition,
+    Left,
+    Name,
+    Right,
+  };
+
+ protected:
+  void build_functions(TSNode root, std::string_view source) override;
+  void build_statement(TSNode stmt, std::string_view source,
+                       int nesting) override;
 
  private:
   // node mappers
-  GSGNode build_function(TSNode node, const std::string &source);
-  void build_block_children(TSNode block, const std::string &source,
-                            std::vector<GSGNode> &out, int nesting);
-  GSGNode build_for(TSNode node, const std::string &source, int nesting);
-  GSGNode build_while(TSNode node, const std::string &source, int nesting);
-  GSGNode build_if(TSNode node, const std::string &source, int nesting);
-  void build_try(TSNode node, const std::string &source,
-                 std::vector<GSGNode> &out, int nesting);
+  GSGNode build_or_stub(TSNode node, std::string_view source);
+  GSGNode build_function(TSNode node, std::string_view source);
+  GSGNode function_node(TSNode node, std::string_view source) const;
+  void schedule_body(TSNode node);
+  void schedule_for(TSNode node, int nesting);
+  void schedule_while(TSNode node, std::string_view source, int nesting);
+  void schedule_if(TSNode node, std::string_view source, int nesting);
 
   // helpers
+  Sym node_type(TSNode n) const { return syms_(n); }
+  TSNode field(TSNode n, Field f) const { return syms_.child(n, f); }
+  TSNode clause_block(TSNode clause, TSNode &taken) const;
   static SourceLoc loc_from_node(TSNode node);
-  static std::string_view slice_source(const std::string &source, TSNode node);
-  static std::string_view get_identifier(TSNode node,
-                                         const std::string &source);
-  static unsigned int count_bool_operators(TSNode node,
-                                           const std::string &source);
-  static unsigned int count_bool_ops_expr(TSNode node, int nesting,
-                                          const std::string &source);
+  static std::string_view slice_source(std::string_view source, TSNode node);
+  std::string_view get_identifier(TSNode node, std::string_view source) const;
+  unsigned int count_bool_operators(TSNode node,
+                                    std::string_view source) const;
+  unsigned int count_bool_ops_expr(TSNode node, int nesting,
+                                   std::string_view source) const;
+
+  SymbolTable<Sym, Field> syms_;
+  mutable std::vector<TSNode> stack_;  // count_bool_operators' work stack
 };
 
 #endif
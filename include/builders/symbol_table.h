@@ -0,0 +1,77 @@
+#pragma once
+
+#include <tree_sitter/api.h>
+
+#include <cstddef>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Maps a grammar's node types and field names to a builder's own enums,
+// once per language:
+//
+//   enum class Sym { Other, IfStatement, ... };   // Other (0): anything else
+//   enum class Field { Body, Condition, ... };
+//   syms_.use(ts_node_language(root));
+//   if (syms_(n) == Sym::IfStatement) ... syms_.child(n, Field::Body) ...
+//
+// A type check is then an array lookup on ts_node_grammar_symbol instead of
+// a string compare, and a field lookup skips tree-sitter's search by name.
+// Every symbol whose name (as ts_node_grammar_type reports it) is listed
+// maps to its value, so checks match the string compares exactly.
+template <class Sym, class Field>
+class SymbolTable {
+ public:
+  struct Name {
+    std::string_view name;
+    Sym sym;
+  };
+
+  // `fields[i]` is the grammar name of Field value i. Both spans must
+  // outlive the table.
+  SymbolTable(std::span<const Name> names,
+              std::span<const std::string_view> fields)
+      : names_(names), fields_(fields) {}
+
+  // Select the tables for `lang`, building them on its first use (a
+  // builder can serve several grammars, e.g. C and C++).
+  void use(const TSLanguage *lang) {
+    for (current_ = 0; current_ < tables_.size(); ++current_)
+      if (tables_[current_].lang == lang) return;
+    Tables t{lang, {}, {}};
+    t.syms.resize(ts_language_symbol_count(lang), Sym{});
+    for (TSSymbol s = 0; s < t.syms.size(); ++s) {
+      const std::string_view name = ts_language_symbol_name(lang, s);
+      for (const auto &n : names_)
+        if (n.name == name) t.syms[s] = n.sym;
+    }
+    for (std::string_view f : fields_)
+      t.fields.push_back(ts_language_field_id_for_name(
+          lang, f.data(), static_cast<uint32_t>(f.size())));
+    tables_.push_back(std::move(t));
+  }
+
+  Sym operator()(TSNode n) const {
+    const auto &syms = tables_[current_].syms;
+    const TSSymbol s = ts_node_grammar_symbol(n);
+    return s < syms.size() ? syms[s] : Sym{};
+  }
+
+  TSNode child(TSNode n, Field f) const {
+    return ts_node_child_by_field_id(
+        n, tables_[current_].fields[static_cast<size_t>(f)]);
+  }
+
+ private:
+  struct Tables {
+    const TSLanguage *lang;
+    std::vector<Sym> syms;
+    std::vector<TSFieldId> fields;
+  };
+
+  std::span<const Name> names_;
+  std::span<const std::string_view> fields_;
+  std::vector<Tables> tables_;
+  size_t current_ = 0;
+};
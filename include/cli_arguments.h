@@ -29,6 +29,29 @@ struct CLI_ARGUMENTS {
   bool show_version = false;  // --version
   // Optional filter: if non-empty, only these languages are considered
   std::vector<Language> languages;
+  // Number of analysis worker threads; 0 means hardware concurrency
+  int jobs = 0;  // --jobs -j
+  // Print a scheduling/latency summary to stderr after the run
+  bool stats = false;  // --stats
+  // Persistent result cache directory; empty disables caching
+  std::string cache_dir;  // --cache-dir
+  // Size bound of the result cache in MiB
+  int cache_max_mb = 256;  // --cache-max-mb
+  // Keep running and re-analyze files incrementally as they change
+  bool watch = false;  // --watch
+  // Unix socket used by `cognity serve` and `cognity query`
+  std::string socket = ".cognity.sock";  // --socket
+  // Per-file limits; files over one are reported as not analysed. 0 means
+  // no limit
+  int parse_timeout_ms = 0;  // --parse-timeout-ms
+  int max_file_bytes = 0;    // --max-file-bytes
+  int max_gsg_nodes = 0;     // --max-gsg-nodes
+  // Print per-phase timings, counters and the slowest files to stderr
+  bool profile = false;  // --profile
+  // How many of the slowest files the profile lists
+  int profile_top = 10;  // --profile-top
+  // Write per-thread file and phase spans here (Chrome Trace Event JSON)
+  std::string trace_out = "";  // --trace-out
 };
 
 std::vector<std::string> args_to_string(char**, int);
@@ -49,6 +72,18 @@ struct CLI_PARSE_RESULT {
   bool has_lang = false;
   bool has_help = false;
   bool has_version = false;
+  bool has_jobs = false;
+  bool has_stats = false;
+  bool has_cache_dir = false;
+  bool has_cache_max_mb = false;
+  bool has_watch = false;
+  bool has_socket = false;
+  bool has_parse_timeout_ms = false;
+  bool has_max_file_bytes = false;
+  bool has_max_gsg_nodes = false;
+  bool has_profile = false;
+  bool has_profile_top = false;
+  bool has_trace_out = false;
 };
 
 CLI_PARSE_RESULT parse_arguments_relaxed(std::vector<std::string>&);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <iostream>
+#include <vector>
 
 #include "./cli_arguments.h"
 #include "./config.h"
@@ -11,6 +12,8 @@ namespace cli_helpers {
 inline void print_usage() {
   std::cout
       << "Usage: cognity <paths...> [options]\n"
+         "       cognity serve <paths...> [options]\n"
+         "       cognity query [paths...] [options]\n"
          "\n"
          "Options:\n"
          "  -mx, --max-complexity <int>   Max allowed complexity (default 15)\n"
@@ -26,6 +29,28 @@ inline void print_usage() {
          "exclude\n"
          "  -fw, --max-fn-width <int>     Truncate function names to width "
          "when printing\n"
+         "  -j,  --jobs <int>             Worker threads (default: CPU count)\n"
+         "       --stats                  Print timing/latency summary to "
+         "stderr\n"
+         "       --cache-dir <dir>        Reuse results of unchanged files "
+         "from <dir>\n"
+         "       --cache-max-mb <int>     Result cache size bound (default "
+         "256)\n"
+         "       --watch                  Keep running and re-report files as "
+         "they change\n"
+         "       --socket <path>          Socket for serve/query (default "
+         ".cognity.sock)\n"
+         "       --parse-timeout-ms <int> Skip files that take longer to "
+         "parse (0: no limit)\n"
+         "       --max-file-bytes <int>   Skip larger files (0: no limit)\n"
+         "       --max-gsg-nodes <int>    Skip files needing more graph nodes "
+         "(0: no limit)\n"
+         "       --profile                Print per-phase timings and the "
+         "slowest files to stderr\n"
+         "       --profile-top <int>      Files listed by --profile (default "
+         "10)\n"
+         "       --trace-out <path>       Write a Chrome trace of files and "
+         "phases per thread\n"
          "  -h,  --help                   Show this help and exit\n"
          "       --version                Show version and exit\n"
          "\n"
@@ -73,6 +98,24 @@ inline CLI_ARGUMENTS merge_cli_and_config(const LoadedConfig &file_cfg,
       cli_args.languages = file_cfg.args.languages;
     if (file_cfg.present.paths) cli_args.paths = file_cfg.args.paths;
     if (file_cfg.present.excludes) cli_args.excludes = file_cfg.args.excludes;
+    if (file_cfg.present.jobs) cli_args.jobs = file_cfg.args.jobs;
+    if (file_cfg.present.stats) cli_args.stats = file_cfg.args.stats;
+    if (file_cfg.present.cache_dir)
+      cli_args.cache_dir = file_cfg.args.cache_dir;
+    if (file_cfg.present.cache_max_mb)
+      cli_args.cache_max_mb = file_cfg.args.cache_max_mb;
+    if (file_cfg.present.socket) cli_args.socket = file_cfg.args.socket;
+    if (file_cfg.present.parse_timeout_ms)
+      cli_args.parse_timeout_ms = file_cfg.args.parse_timeout_ms;
+    if (file_cfg.present.max_file_bytes)
+      cli_args.max_file_bytes = file_cfg.args.max_file_bytes;
+    if (file_cfg.present.max_gsg_nodes)
+      cli_args.max_gsg_nodes = file_cfg.args.max_gsg_nodes;
+    if (file_cfg.present.profile) cli_args.profile = file_cfg.args.profile;
+    if (file_cfg.present.profile_top)
+      cli_args.profile_top = file_cfg.args.profile_top;
+    if (file_cfg.present.trace_out)
+      cli_args.trace_out = file_cfg.args.trace_out;
   }
 
   // Apply CLI overrides where present
@@ -90,8 +133,55 @@ inline CLI_ARGUMENTS merge_cli_and_config(const LoadedConfig &file_cfg,
   if (parsed.has_lang) cli_args.languages = parsed.args.languages;
   if (parsed.has_paths) cli_args.paths = parsed.args.paths;
   if (parsed.has_excludes) cli_args.excludes = parsed.args.excludes;
+  if (parsed.has_jobs) cli_args.jobs = parsed.args.jobs;
+  if (parsed.has_stats) cli_args.stats = parsed.args.stats;
+  if (parsed.has_cache_dir) cli_args.cache_dir = parsed.args.cache_dir;
+  if (parsed.has_cache_max_mb)
+    cli_args.cache_max_mb = parsed.args.cache_max_mb;
+  if (parsed.has_watch) cli_args.watch = parsed.args.watch;
+  if (parsed.has_socket) cli_args.socket = parsed.args.socket;
+  if (parsed.has_parse_timeout_ms)
+    cli_args.parse_timeout_ms = parsed.args.parse_timeout_ms;
+  if (parsed.has_max_file_bytes)
+    cli_args.max_file_bytes = parsed.args.max_file_bytes;
+  if (parsed.has_max_gsg_nodes)
+    cli_args.max_gsg_nodes = parsed.args.max_gsg_nodes;
+  if (parsed.has_profile) cli_args.profile = parsed.args.profile;
+  if (parsed.has_profile_top) cli_args.profile_top = parsed.args.profile_top;
+  if (parsed.has_trace_out) cli_args.trace_out = parsed.args.trace_out;
 
   return cli_args;
 }
 
+// Print `rows` and the `skipped` files in the format selected by `cli_args`
+// (table, JSON or CSV; nothing in quiet mode) and return the exit code: 2 if
+// any function exceeds the threshold, else 0.
+inline int print_report(const std::vector<report::Row> &rows,
+                        const CLI_ARGUMENTS &cli_args,
+                        const std::vector<report::Skipped> &skipped = {}) {
+  bool any_exceeds = report::any_exceeds(rows, cli_args.max_complexity_allowed,
+                                         cli_args.ignore_complexity);
+
+  // Quiet mode suppresses all normal output (table/JSON/CSV). Exit code only.
+  if (cli_args.quiet) return any_exceeds ? 2 : 0;
+
+  if (cli_args.output_json) {
+    report::print_json(rows, cli_args.sort, cli_args.max_complexity_allowed,
+                       cli_args.ignore_complexity, cli_args.detail, skipped);
+    return any_exceeds ? 2 : 0;
+  }
+
+  if (cli_args.output_csv) {
+    report::print_csv(rows, cli_args.sort, cli_args.max_complexity_allowed,
+                      cli_args.ignore_complexity, cli_args.detail, skipped);
+    return any_exceeds ? 2 : 0;
+  }
+
+  report::print_table(rows, cli_args.sort, cli_args.max_function_width,
+                      cli_args.max_complexity_allowed,
+                      cli_args.ignore_complexity, cli_args.quiet,
+                      cli_args.detail, skipped);
+  return any_exceeds ? 2 : 0;
+}
+
 }  // namespace cli_helpers
@@ -7,6 +7,8 @@
 
 #include <tree_sitter/api.h>
 
+#include <stdexcept>
+#include <string_view>
 #include <vector>
 
 #include "./gsg.h"
@@ -46,10 +48,27 @@ struct CodeComplexity {
   std::vector<FunctionComplexity> functions;
 };
 
-std::vector<FunctionComplexity> functions_complexity_file(const std::string&,
+// Thrown by functions_complexity_file when the parser gives up on a file
+// because its timeout expired (see ParserPool::set_timeout_micros). The
+// parser has been reset and can be used again.
+class ParseTimeout : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+std::vector<FunctionComplexity> functions_complexity_file(std::string_view,
                                                           TSParser*, Language);
+// Same as above, but reuses a caller-owned builder (e.g. one per worker).
+std::vector<FunctionComplexity> functions_complexity_file(std::string_view,
+                                                          TSParser*, IBuilder&);
+
+// Complexity of `node` at the given nesting level. Per-line contributions
+// are appended to `lines` in source order, one traversal for the whole
+// subtree.
+unsigned int compute_cognitive_complexity_gsg(const GSG&, const GSGNode&, int,
+                                              std::vector<LineComplexity>&);
 
-std::pair<unsigned int, std::vector<LineComplexity>>
-compute_cognitive_complexity_gsg(const GSGNode&, int);
+// Score one function-level node of a graph returned by IBuilder::build.
+FunctionComplexity function_complexity(const GSG&, const GSGNode&);
 
 #endif
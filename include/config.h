@@ -17,6 +17,17 @@ struct ConfigPresence {
   bool output_json = false;
   bool max_fn_width = false;
   bool languages = false;
+  bool jobs = false;
+  bool stats = false;
+  bool cache_dir = false;
+  bool cache_max_mb = false;
+  bool socket = false;
+  bool parse_timeout_ms = false;
+  bool max_file_bytes = false;
+  bool max_gsg_nodes = false;
+  bool profile = false;
+  bool profile_top = false;
+  bool trace_out = false;
 };
 
 struct LoadedConfig {
@@ -34,7 +45,9 @@ struct LoadedConfig {
 // Supported keys (case-insensitive):
 //   paths, max_complexity | max_complexity_allowed, quiet, ignore_complexity,
 //   detail, sort, output_csv, output_json, max_fn_width | max_function_width,
-//   lang | languages, exclude
+//   lang | languages, exclude, jobs, stats, cache_dir, cache_max_mb,
+//   socket, parse_timeout_ms, max_file_bytes, max_gsg_nodes, profile,
+//   profile_top, trace_out
 LoadedConfig load_cognity_toml(const std::string &filepath);
 
 #endif
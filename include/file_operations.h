@@ -1,10 +1,49 @@
 #ifndef FILE_OPERATIONS_H
 #define FILE_OPERATIONS_H
 
-#include <fstream>
-#include <iostream>
-#include <sstream>
+#include <cstddef>
+#include <string>
+#include <string_view>
 
-std::string load_file_content(std::string&);
+// Read-only contents of a source file.
+//
+// Regular files of at least kMapThreshold bytes are memory-mapped, so the
+// parser reads the page cache directly instead of a private copy. Smaller
+// files, pipes and platforms without mmap are read into an owned buffer with
+// a single read loop. view() stays valid for the lifetime of the buffer.
+class SourceBuffer {
+ public:
+  // Below this size a read() is cheaper than setting up a mapping.
+  static constexpr size_t kMapThreshold = 16 * 1024;
+
+  // Throws std::runtime_error("Failed to open file: <path>") on failure.
+  //
+  // A mapping is only as long as the file: if another process truncates the
+  // file while view() is being read (an editor saving in place, a git
+  // checkout), touching the pages past the new end raises SIGBUS. Pass
+  // map = false, or use read_copy, where that would take down a long-lived
+  // process or where the contents are copied anyway.
+  static SourceBuffer open(const std::string &path, bool map = true);
+  // The contents of `path`, read() into a string; throws as open does.
+  static std::string read_copy(const std::string &path);
+
+  SourceBuffer() = default;
+  SourceBuffer(SourceBuffer &&other) noexcept;
+  SourceBuffer &operator=(SourceBuffer &&other) noexcept;
+  SourceBuffer(const SourceBuffer &) = delete;
+  SourceBuffer &operator=(const SourceBuffer &) = delete;
+  ~SourceBuffer();
+
+  std::string_view view() const { return {data_, size_}; }
+  bool mapped() const { return mapped_; }
+
+ private:
+  void release();
+
+  const char *data_ = "";
+  size_t size_ = 0;
+  bool mapped_ = false;
+  std::string owned_;
+};
 
 #endif
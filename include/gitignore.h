@@ -1,8 +1,11 @@
 #ifndef GITIGNORE_H
 #define GITIGNORE_H
 
+#include <cstddef>
 #include <filesystem>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace ignore {
@@ -15,18 +18,48 @@ struct Rule {
   bool anchored = false;   // true if pattern began with '/'
 };
 
+// The rules of one .gitignore compiled for matching: literal names and
+// paths in hash sets, `*.ext` / `name*` style patterns as suffix and prefix
+// sets, and every other glob in one automaton that is run over the path
+// once for all of them. Defined in gitignore.cpp.
+class Matcher;
+
 struct RulesFile {
   std::filesystem::path base;  // directory containing this .gitignore
   std::vector<Rule> rules;     // in order
+  std::shared_ptr<const Matcher> matcher;  // built from `rules`
+  // Length of `base`'s own part of the paths given to is_ignored (with its
+  // trailing '/'), i.e. where paths relative to `base` start. Set by the
+  // directory walk.
+  size_t prefix = 0;
+};
+
+// The .gitignore files above a directory as the walk shares them between
+// threads: each link holds one directory's rules and points to the link of
+// the nearest directory above it that has rules. Links are immutable once
+// made, so a subtree handed to another thread takes its ancestors' rules by
+// reference count instead of copying the stack. Null is the empty stack.
+struct RulesLink;
+using RulesStack = std::shared_ptr<const RulesLink>;
+struct RulesLink {
+  RulesFile rules;
+  RulesStack parent;
 };
 
+// `stack` with `rules` on top.
+RulesStack push(RulesStack stack, RulesFile rules);
+
 // Load rules from <dir>/.gitignore if present. Returns empty rules if none.
 RulesFile load_rules_for_dir(const std::filesystem::path& dir);
 
-// Determine if path is ignored by the cumulative rules on the stack.
+// Determine if an entry is ignored by the cumulative rules on the stack.
 // The stack must be ordered from higher-level directory to the current one.
-bool is_ignored(const std::vector<RulesFile>& stack,
-                const std::filesystem::path& abs_path, bool is_dir);
+// `rel` is the entry's path below the directory the walk started at, with
+// '/' separators; the walk keeps it as it descends, so matching needs no
+// filesystem calls or allocation.
+bool is_ignored(const std::vector<RulesFile>& stack, std::string_view rel,
+                bool is_dir);
+bool is_ignored(const RulesStack& stack, std::string_view rel, bool is_dir);
 
 }  // namespace ignore
 
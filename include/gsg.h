@@ -3,8 +3,15 @@
 
 #include <tree_sitter/api.h>
 
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <initializer_list>
 #include <memory>
+#include <span>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 
 // Supported languages (extensible)
@@ -51,19 +58,262 @@ struct SourceLoc {
   unsigned int end_col{0};
 };
 
+// Nodes live in a GSG (below): children are a contiguous index range into
+// the same array, and names point into the source or the GSG's name arena,
+// so building a function's graph does not allocate per node.
 struct GSGNode {
   GSGNodeKind kind{GSGNodeKind::Unknown};
-  std::string name{};         // for functions/classes/cases
+  std::string_view name{};    // for functions/classes/cases
   SourceLoc loc{};            // for line-complexity mapping
   unsigned int addl_cost{0};  // extra cost (e.g., boolean operator changes)
-  std::vector<GSGNode> children{};
+  std::uint32_t first_child{0};
+  std::uint32_t child_count{0};
+  // Set on the function-level nodes returned by build: where the function
+  // starts in the source, and whether its body was skipped because it lies
+  // outside every changed range (see IBuilder::set_changed_ranges).
+  unsigned int start_byte{0};
+  bool reused{false};
 };
 
+// Flat General Syntax Graph of one file: the function-level nodes and all
+// their descendants in one contiguous array. Builders push a node's
+// children while it is open (open/close) and emit finished top-level
+// functions with add_function; clear() keeps every buffer's capacity, so a
+// GSG reused across files stops allocating once it has seen the largest one.
+class GSG {
+ public:
+  GSG() = default;
+  GSG(const GSG &) = delete;
+  GSG &operator=(const GSG &) = delete;
+
+  void clear();
+
+  std::span<const GSGNode> functions() const {
+    return {nodes_.data() + functions_begin_, functions_count_};
+  }
+  std::span<const GSGNode> children(const GSGNode &n) const {
+    return {nodes_.data() + n.first_child, n.child_count};
+  }
+  size_t node_count() const { return nodes_.size(); }
+
+  // Builder side. Nodes pushed between open(parent) and close(parent)
+  // become the children of `parent`, which is then pushed itself (or
+  // emitted with add_function). Opens must nest.
+  void open(GSGNode &parent) {
+    parent.first_child = static_cast<std::uint32_t>(pending_.size());
+  }
+  void push(const GSGNode &n) { pending_.push_back(n); }
+  void close(GSGNode &parent);
+  void add_function(const GSGNode &fn) { push(fn); }
+  // Move the top-level functions into place once the builder is done.
+  void finish();
+
+  // Copy the concatenation of `parts` into the name arena (for names that
+  // are not a slice of the source); the view stays valid until clear().
+  std::string_view intern(std::initializer_list<std::string_view> parts);
+
+ private:
+  struct Chunk {
+    std::unique_ptr<char[]> data;
+    size_t size = 0;
+  };
+  static constexpr size_t kChunkSize = 4096;
+
+  std::vector<GSGNode> nodes_;
+  // Finished nodes whose parent is still open, innermost last.
+  std::vector<GSGNode> pending_;
+  std::uint32_t functions_begin_ = 0;
+  std::uint32_t functions_count_ = 0;
+
+  std::vector<Chunk> chunks_;
+  size_t chunk_ = 0;  // chunk currently filled
+  size_t used_ = 0;   // bytes used in chunks_[chunk_]
+};
+
+struct FunctionComplexity;
+struct LineComplexity;
+
+// Scores nodes in the order a builder emits them (open/close/push, see GSG)
+// instead of storing them: each function's complexity and line
+// contributions are final when the walk leaves it. A node's kind, loc and
+// addl_cost must be set before it is opened.
+class StreamScorer {
+ public:
+  void begin(std::vector<FunctionComplexity> &out);
+  void open(const GSGNode &n);
+  void close();
+  void push(const GSGNode &n);
+  void add_function(const GSGNode &fn);
+
+ private:
+  struct Frame {
+    GSGNodeKind kind;
+    int nesting;
+    std::uint32_t children = 0;
+    // The wrapper case of the scorer (a function whose body is one inner
+    // function and a zero-cost Expr) is only known once the function is
+    // closed; these describe its first two children so it can be applied
+    // to the lines already scored. `first_wrappers` is the length of the
+    // run of nested wrappers starting at the first child.
+    bool first_is_function = false;
+    std::uint32_t first_wrappers = 0;
+    std::uint32_t first_begin = 0;
+    std::uint32_t first_end = 0;
+    bool second_is_bare_expr = false;
+  };
+  // Count `n` as a child of the innermost open node and score its own
+  // line; returns the level it was scored at.
+  int enter(const GSGNode &n);
+
+  std::vector<FunctionComplexity> *out_ = nullptr;
+  std::vector<LineComplexity> *lines_ = nullptr;
+  // Per line of the current function: whether its cost includes nesting.
+  std::vector<unsigned char> nested_;
+  std::vector<Frame> frames_;
+  bool closed_ = false;  // the next push/add_function is the closed node
+};
+
+// Thrown by IBuilder::build / score when a file needs more nodes than the
+// builder's node limit allows.
+class GSGTooLarge : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
+// The GSGTooLarge message for a file over a limit of `limit` nodes.
+inline std::string too_many_nodes(size_t limit) {
+  return "more than " + std::to_string(limit) + " graph nodes";
+}
+
 struct IBuilder {
-  virtual ~IBuilder() = default;
-  // Build function-level GSG nodes found in the file/module root
-  virtual std::vector<GSGNode> build_functions(TSNode root,
-                                               const std::string &source) = 0;
+  IBuilder() = default;
+  IBuilder(const IBuilder &) = delete;
+  IBuilder &operator=(const IBuilder &) = delete;
+  virtual ~IBuilder();
+  // Build the function-level GSG nodes found in the file/module root. The
+  // graph is owned by the builder and reused by the next call, so it (and
+  // every name in it) is valid until then and while `source` is.
+  const GSG &build(TSNode root, std::string_view source);
+  // Same walk, but score each function as it is built (StreamScorer) and
+  // append the results to `out` without keeping the graph.
+  void score(TSNode root, std::string_view source,
+             std::vector<FunctionComplexity> &out);
+
+  // Incremental rebuilds (watch mode): while set, a function-level node that
+  // misses every range is returned as a stub (kind, name, loc, start_byte,
+  // reused = true) without building its body. Pass nullptr to clear.
+  void set_changed_ranges(const std::vector<TSRange> *ranges) {
+    changed_ranges_ = ranges;
+  }
+
+  // Give up on files that need more than `max` nodes (0: no limit): build
+  // and score throw GSGTooLarge once the walk exceeds it.
+  void set_node_limit(size_t max) { node_limit_ = max; }
+  // Nodes the last build or score walked, as the node limit counts them
+  // (what a file needs, when it was under the limit).
+  size_t nodes_walked() const { return nodes_; }
+
+ protected:
+  // Emit every function-level node with emit_function. The *_node calls
+  // forward to gsg_ or, while scoring, to scorer_.
+  virtual void build_functions(TSNode root, std::string_view source) = 0;
+
+  void open_node(GSGNode &n) {
+    if (streaming_)
+      scorer_.open(n);
+    else
+      gsg_.open(n);
+  }
+  void close_node(GSGNode &n) {
+    if (streaming_)
+      scorer_.close();
+    else
+      gsg_.close(n);
+  }
+  // Every node is pushed or emitted exactly once (open ones after closing),
+  // so that is where the node limit is checked.
+  void push_node(const GSGNode &n) {
+    count_node();
+    if (streaming_)
+      scorer_.push(n);
+    else
+      gsg_.push(n);
+  }
+  void emit_function(const GSGNode &fn) {
+    count_node();
+    if (streaming_)
+      scorer_.add_function(fn);
+    else
+      gsg_.add_function(fn);
+  }
+
+  // Function bodies are walked with a heap-allocated work stack instead of
+  // recursion, so a file nesting blocks many thousands deep cannot run out
+  // of stack. A builder schedules a block with schedule_block and calls
+  // run_blocks; each of the block's named children is then handed to
+  // build_statement, which pushes leaf nodes itself and schedules the rest
+  // in the order it is to happen, e.g. for a loop:
+  //
+  //   schedule_open(loop);
+  //   schedule_block(body, nesting + 1);
+  //   schedule_close();  // closes and pushes `loop`
+  //
+  // The scheduled work runs once build_statement returns, before the next
+  // statement of the block. Opens and closes must balance per statement.
+  virtual void build_statement(TSNode, std::string_view, int) {}
+  void schedule_open(const GSGNode &n) {
+    work_.push_back({Op::Open, 0, {}, n});
+  }
+  void schedule_block(TSNode block, int nesting) {
+    work_.push_back({Op::Block, nesting, block, {}});
+  }
+  void schedule_close() { work_.push_back({Op::Close, 0, {}, {}}); }
+  // Push `n` after the work this statement scheduled so far (right away if
+  // there is none).
+  void schedule_push(const GSGNode &n) {
+    if (work_.size() == statement_mark_)
+      push_node(n);
+    else
+      work_.push_back({Op::Push, 0, {}, n});
+  }
+  // Do the scheduled work, including what it schedules in turn.
+  void run_blocks(std::string_view source);
+
+  void count_node() {
+    if (++nodes_ > node_limit_ && node_limit_)
+      throw GSGTooLarge(too_many_nodes(node_limit_));
+  }
+
+  bool unchanged(TSNode fn) const;
+  static GSGNode function_stub(TSNode fn, std::string_view name);
+
+  const std::vector<TSRange> *changed_ranges_ = nullptr;
+  GSG gsg_;  // only its name arena is used while scoring
+  StreamScorer scorer_;
+  bool streaming_ = false;
+  size_t node_limit_ = 0;
+  size_t nodes_ = 0;  // pushed or emitted by the current walk
+
+ private:
+  enum class Op : unsigned char { Open, Block, Next, Push, Close };
+  struct Work {
+    Op op;
+    int nesting;  // Block, Next
+    TSNode node;  // Block
+    GSGNode g;    // Open, Push
+  };
+  // Hand the statements of the innermost active block, from its cursor's
+  // position on, to build_statement until one schedules work.
+  void step_block(std::string_view source, int nesting);
+  void reset_work();
+
+  std::vector<Work> work_;  // next to do last
+  size_t statement_mark_ = 0;
+  std::vector<GSGNode> opened_;  // scheduled opens not closed yet
+  // One cursor per block with statements left, innermost last; blocks
+  // finish in the reverse order they start, so cursors are reused.
+  std::deque<TSTreeCursor> cursors_;
+  size_t active_cursors_ = 0;
 };
 
 std::unique_ptr<IBuilder> make_builder(Language lang);
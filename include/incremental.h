@@ -0,0 +1,66 @@
+#pragma once
+
+#include <tree_sitter/api.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "./cognitive_complexity.h"
+
+namespace incremental {
+
+// A file kept parsed in memory between edits (used by --watch).
+//
+// update() diffs the new source against the previous one (common prefix and
+// suffix), applies the difference to the old TSTree as a TSInputEdit and
+// reparses with the old tree, so tree-sitter only re-lexes the edited region.
+// Only functions whose byte range intersects the edit or one of
+// ts_tree_get_changed_ranges() are rebuilt and rescored; the others reuse the
+// previous result with their rows shifted.
+class IncrementalFile {
+ public:
+  IncrementalFile() = default;
+  ~IncrementalFile();
+  IncrementalFile(const IncrementalFile &) = delete;
+  IncrementalFile &operator=(const IncrementalFile &) = delete;
+
+  // Analyze `source`. The first call parses from scratch. `parser` must be
+  // set to the file's language and `builder` must match it.
+  //
+  // Throws ParseTimeout if the parser's timeout expires; the file is then
+  // empty again and the next update parses from scratch. After any other
+  // exception (e.g. GSGTooLarge from the builder) the file must be dropped.
+  const std::vector<FunctionComplexity> &update(std::string source,
+                                                TSParser *parser,
+                                                IBuilder &builder);
+
+  const std::vector<FunctionComplexity> &functions() const {
+    return functions_;
+  }
+  // Functions rebuilt / reused by the last update().
+  size_t rebuilt() const { return rebuilt_; }
+  size_t reused() const { return reused_; }
+
+ private:
+  struct Known {
+    std::string name;
+    std::uint32_t start_byte = 0;
+    unsigned int start_col = 0;
+  };
+
+  void rebuild_all(TSNode root, IBuilder &builder);
+  // Reset `parser` and this file after a parse gave up; throws ParseTimeout.
+  [[noreturn]] void abandon(TSParser *parser);
+
+  std::string source_;
+  TSTree *tree_ = nullptr;
+  // Parallel to functions_: identity used to match reused stubs.
+  std::vector<Known> known_;
+  std::vector<FunctionComplexity> functions_;
+  size_t rebuilt_ = 0;
+  size_t reused_ = 0;
+};
+
+}  // namespace incremental
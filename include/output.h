@@ -46,19 +46,29 @@ struct Row {
   FunctionComplexity fn;
 };
 
+// A file that was found but not analysed (e.g. over a per-file limit). The
+// printers list these after the rows: as {"file", "not_analysed"} objects in
+// JSON, as rows with an empty complexity in CSV, and as a marked line in the
+// table.
+struct Skipped {
+  std::string file;
+  std::string reason;
+};
+
 void sort_functions(std::vector<FunctionComplexity> &functions, SortType sort);
 
 void print_json(std::vector<Row> rows, SortType sort,
                 int max_complexity_allowed, bool ignore_complexity,
-                DetailType detail);
+                DetailType detail, const std::vector<Skipped> &skipped = {});
 
 void print_csv(std::vector<Row> rows, SortType sort, int max_complexity_allowed,
-               bool ignore_complexity, DetailType detail);
+               bool ignore_complexity, DetailType detail,
+               const std::vector<Skipped> &skipped = {});
 
 bool any_exceeds(const std::vector<Row> &rows, int max_complexity_allowed,
                  bool ignore_complexity);
 void print_table(std::vector<Row> rows, SortType sort, int max_fn_width,
                  int max_complexity_allowed, bool ignore_complexity, bool quiet,
-                 DetailType detail);
+                 DetailType detail, const std::vector<Skipped> &skipped = {});
 
 }  // namespace report
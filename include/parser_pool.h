@@ -0,0 +1,44 @@
+#pragma once
+
+#include <tree_sitter/api.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include "./gsg.h"
+
+// One TSParser per grammar, each set to its language once. A worker that
+// alternates between languages takes the matching parser instead of
+// reconfiguring a single one with ts_parser_set_language for every file.
+// TypeScript has two grammars (.ts and .tsx), so it gets two parsers.
+//
+// Not thread-safe: keep one pool per thread (analysis keeps one per worker).
+class ParserPool {
+ public:
+  ParserPool() = default;
+  ~ParserPool();
+  ParserPool(const ParserPool &) = delete;
+  ParserPool &operator=(const ParserPool &) = delete;
+
+  // Parser for `path` in `lang`, created on first use; nullptr if `lang` has
+  // no grammar.
+  TSParser *get(Language lang, const std::string &path);
+
+  // Give up on parses that run longer than `micros` (0, the default: no
+  // limit). Applies to every parser of the pool, current and future;
+  // functions_complexity_file then throws ParseTimeout.
+  void set_timeout_micros(std::uint64_t micros);
+
+ private:
+  struct Slot {
+    const TSLanguage *language = nullptr;
+    TSParser *parser = nullptr;
+  };
+  // Python, JavaScript, TypeScript, TSX, C, C++.
+  std::array<Slot, 6> slots_{};
+  std::uint64_t timeout_micros_ = 0;
+};
+
+// The grammar for `path` in `lang`, or nullptr if there is none.
+const TSLanguage *ts_language_for_file(Language lang, const std::string &path);
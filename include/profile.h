@@ -0,0 +1,121 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#include "./gsg.h"
+
+// Phase timers and counters behind --profile and --trace-out.
+//
+// Each thread accumulates exclusive time per phase: a Timer started inside
+// another pauses the outer one, so nested phases (gitignore matching inside
+// the directory walk, sorting inside printing) are not counted twice. With
+// tracing on, every FileScope and (unless told otherwise) every Timer is
+// also kept as a span for write_trace. When profiling is off every hook is a
+// single branch.
+namespace profile {
+
+enum class Phase {
+  Other,      // time inside a file not covered by another phase
+  Walk,       // directory traversal
+  Gitignore,  // loading and matching .gitignore rules
+  Queue,      // the walk waiting for workers to take files
+  Read,       // opening / mapping source files
+  Parse,      // tree-sitter
+  Build,      // GSG construction
+  Score,      // cognitive complexity over the GSG
+  Sort,
+  Print,
+};
+constexpr size_t kPhaseCount = static_cast<size_t>(Phase::Print) + 1;
+
+const char *phase_name(Phase p);
+
+namespace detail {
+inline bool enabled = false;
+inline bool tracing = false;
+}  // namespace detail
+
+// Turn profiling on, and with `trace` also record spans; call before
+// starting any worker thread.
+void enable(bool trace = false);
+inline bool enabled() { return detail::enabled; }
+inline bool tracing() { return detail::tracing; }
+
+// Heap allocations made by the calling thread. Incremented by the operator
+// new replacement in alloc_hooks.cpp (linked into cognity only).
+inline thread_local std::uint64_t t_allocations = 0;
+
+// Name the calling thread's track in the trace (e.g. "worker 2", "walk 1");
+// threads that set none are "main" (the one that called enable) or
+// "thread <n>".
+void set_thread_name(std::string name);
+
+// Adds the time until it is destroyed to `phase` on this thread. With
+// `span` false no trace span is kept, only the time: for timers run per
+// directory entry, whose spans would bury the per-file ones.
+class Timer {
+ public:
+  explicit Timer(Phase phase, bool span = true) : span_(span) {
+    if (enabled()) start(phase);
+  }
+  ~Timer() {
+    if (active_) stop();
+  }
+  Timer(const Timer &) = delete;
+  Timer &operator=(const Timer &) = delete;
+
+ private:
+  void start(Phase phase);
+  void stop();
+
+  bool active_ = false;
+  bool span_ = true;
+  Phase outer_ = Phase::Other;
+  std::chrono::steady_clock::time_point start_;  // for the trace span
+};
+
+// Counters for the calling thread.
+void add_bytes_read(std::uint64_t n);
+void add_nodes(std::uint64_t n);
+
+// Attributes everything this thread does until it is destroyed (phase
+// times, counters, allocations) to one input file.
+class FileScope {
+ public:
+  FileScope(const std::string &path, Language lang);
+  ~FileScope();
+  FileScope(const FileScope &) = delete;
+  FileScope &operator=(const FileScope &) = delete;
+
+ private:
+  struct Snapshot {
+    std::array<double, kPhaseCount> seconds{};
+    std::uint64_t bytes = 0;
+    std::uint64_t nodes = 0;
+    std::uint64_t allocations = 0;
+  };
+
+  bool active_ = false;
+  const std::string *path_ = nullptr;
+  Language lang_ = Language::Unknown;
+  std::chrono::steady_clock::time_point start_;
+  Snapshot before_;
+};
+
+// Print the summary of everything recorded so far: phase totals (summed
+// over threads), counters, the `top` slowest files and a per-language
+// breakdown. Call once the worker threads have finished.
+void print_summary(std::ostream &os, double wall_seconds, size_t top);
+void print_summary_json(std::ostream &os, double wall_seconds, size_t top);
+
+// Write the recorded spans to `path` as Chrome Trace Event JSON (for
+// chrome://tracing or Perfetto): one track per thread, a span per file with
+// its phases nested inside. Throws std::runtime_error if `path` cannot be
+// written.
+void write_trace(const std::string &path);
+
+}  // namespace profile
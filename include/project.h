@@ -0,0 +1,106 @@
+#pragma once
+
+#include <tree_sitter/api.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "./cli_arguments.h"
+#include "./incremental.h"
+#include "./output.h"
+#include "./parser_pool.h"
+#include "./sourcing.h"
+
+namespace project {
+
+// Per-file limits, as in analysis::Options; 0 means no limit. A file over
+// one is kept without results and with the reason it was not analysed.
+struct Limits {
+  std::uintmax_t max_file_bytes = 0;
+  std::uint64_t parse_timeout_ms = 0;
+  size_t max_gsg_nodes = 0;
+};
+
+// The limits set by --max-file-bytes, --parse-timeout-ms and
+// --max-gsg-nodes.
+Limits limits_of(const CLI_ARGUMENTS &cli_args);
+
+// Outcome of the last Model::refresh().
+struct RefreshInfo {
+  double ms = 0;
+  size_t rebuilt = 0;
+  size_t reused = 0;
+};
+
+// In-memory model of an analyzed project, shared by --watch and
+// `cognity serve`: the tracked files with their stat metadata and current
+// results. A file that changes is re-analyzed through an IncrementalFile,
+// which then stays resident so later edits only reparse what changed.
+//
+// Not thread-safe; owned and driven by a single thread.
+class Model {
+ public:
+  explicit Model(SortType sort, const Limits &limits = {});
+  Model(const Model &) = delete;
+  Model &operator=(const Model &) = delete;
+
+  // Replace the tracked set, e.g. after a directory walk. Files that stay
+  // keep their results and metadata; returns the paths that are new.
+  std::vector<std::string> set_files(std::vector<SourceFile> files);
+  // Record results computed elsewhere (e.g. by the initial parallel run).
+  void set_results(const std::string &path,
+                   std::vector<FunctionComplexity> functions);
+  // Record why `path` was not analysed elsewhere.
+  void set_skipped(const std::string &path, std::string reason);
+
+  // Tracked files whose stat metadata no longer matches; updates it.
+  std::vector<std::string> stale_files();
+  // Re-read and re-analyze `path`, refreshing its stat metadata, unless it
+  // is over a limit; then it is left without results (see skipped()).
+  // Returns false if it is not tracked, not a supported language, or cannot
+  // be read.
+  bool refresh(const std::string &path);
+  const RefreshInfo &last_refresh() const { return last_; }
+
+  bool tracks(const std::string &path) const {
+    return files_.count(path) != 0;
+  }
+  size_t size() const { return files_.size(); }
+  // Tracked paths, in order.
+  std::vector<std::string> paths() const;
+  // Rows for the given files (all files if `paths` is empty), sorted by the
+  // model's SortType within each file, files in path order.
+  std::vector<report::Row> rows(const std::vector<std::string> &paths) const;
+  // The files among `paths` (all if empty) that are not analysed and why,
+  // in path order.
+  std::vector<report::Skipped> skipped(
+      const std::vector<std::string> &paths) const;
+
+ private:
+  struct File {
+    SourceFile meta;
+    std::vector<FunctionComplexity> functions;
+    std::string skipped;  // why it has no results, if it is over a limit
+    std::unique_ptr<incremental::IncrementalFile> parsed;
+  };
+
+  IBuilder *builder_for(Language lang);
+  // Drop `f`'s results and parse state, recording `reason`.
+  void skip(File &f, std::string reason);
+
+  SortType sort_;
+  Limits limits_;
+  ParserPool parsers_;
+  std::array<std::unique_ptr<IBuilder>,
+             static_cast<size_t>(Language::Unknown) + 1>
+      builders_{};
+  std::map<std::string, File> files_;
+  RefreshInfo last_;
+};
+
+}  // namespace project
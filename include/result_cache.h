@@ -0,0 +1,112 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "./cognitive_complexity.h"
+#include "./sourcing.h"
+
+namespace cache {
+
+// Fast non-cryptographic 64-bit hash of `data`, used to key cache entries.
+std::uint64_t content_hash(std::string_view data, std::uint64_t seed = 0);
+
+// Grammar, scorer and tool version that produced a result for `path`, e.g.
+// "cognity 0.3.0 scorer 2 core v0.25.9 python v0.23.0". Bumping any pinned
+// TS_*_TAG (or the tool or scorer version) changes the tag and invalidates
+// old entries.
+std::string grammar_tag(Language lang, const std::string &path);
+
+// Persistent per-file result cache.
+//
+// Each entry stores the functions produced by functions_complexity_file for
+// one source text, keyed by content_hash(source) salted with grammar_tag, so
+// a file that did not change is never parsed again. With them it stores the
+// graph nodes scoring took (IBuilder::nodes_walked), so a hit can still be
+// held to a node limit. Entries live in
+// `<dir>/<2 hex>/<16 hex>.bin` and are written to a temporary file first and
+// renamed into place, so concurrent workers (or concurrent cognity runs)
+// never observe a partial entry.
+//
+// In front of the entries sits a stat index, `<dir>/stat-index`, mapping each
+// path to the (inode, size, mtime) it had when it was last analyzed and the
+// entry that holds its results. Like git's index, a file whose metadata still
+// matches is served without being read or hashed; anything else falls back
+// to the content hash.
+//
+// The cache is bounded by `max_bytes`: trim() deletes least recently used
+// entries (by mtime, refreshed on every hit) until it fits.
+//
+// I/O failures are never fatal: an unreadable entry is a miss and a failed
+// write is dropped.
+class ResultCache {
+ public:
+  // Throws std::runtime_error if `dir` cannot be created. Loads the stat
+  // index if there is one.
+  ResultCache(std::string dir, std::uintmax_t max_bytes);
+
+  // Stat fast path: results for `file` if the index shows it unchanged since
+  // it was analyzed with `tag`. A false return is not counted as a miss.
+  bool lookup_unchanged(const SourceFile &file, const std::string &tag,
+                        std::vector<FunctionComplexity> &out, size_t &nodes);
+  // Content path. Hits and stores also (re)index `file`.
+  bool lookup(const SourceFile &file, const std::string &tag,
+              std::string_view source, std::vector<FunctionComplexity> &out,
+              size_t &nodes);
+  void store(const SourceFile &file, const std::string &tag,
+             std::string_view source,
+             const std::vector<FunctionComplexity> &functions, size_t nodes);
+
+  // Evict entries until the cache is within its size bound. Only scans the
+  // directory if something was stored since the last trim.
+  void trim();
+  // Write the stat index back if it changed. Call once workers are done.
+  void save_index();
+
+  size_t hits() const { return hits_.load(std::memory_order_relaxed); }
+  size_t stat_hits() const {
+    return stat_hits_.load(std::memory_order_relaxed);
+  }
+  size_t misses() const { return misses_.load(std::memory_order_relaxed); }
+  size_t evicted() const { return evicted_; }
+
+ private:
+  struct IndexEntry {
+    std::uint64_t inode = 0;
+    std::uint64_t size = 0;
+    std::int64_t mtime_ns = 0;
+    std::uint64_t tag_hash = 0;
+    std::uint64_t key = 0;  // entry holding the results
+  };
+
+  std::string entry_path(std::uint64_t key) const;
+  bool read_entry(std::uint64_t key, const std::string &tag,
+                  std::uintmax_t source_size,
+                  std::vector<FunctionComplexity> &out, size_t &nodes);
+  void remember(const SourceFile &file, std::uint64_t tag_hash,
+                std::uint64_t key);
+  void load_index();
+
+  std::string dir_;
+  std::uintmax_t max_bytes_;
+  std::atomic<size_t> hits_{0};
+  std::atomic<size_t> stat_hits_{0};
+  std::atomic<size_t> misses_{0};
+  std::atomic<size_t> stores_{0};
+  size_t evicted_ = 0;
+
+  // Read-only while workers run; their updates are queued and merged by
+  // save_index().
+  std::unordered_map<std::string, IndexEntry> index_;
+  std::mutex index_mu_;
+  std::vector<std::pair<std::string, IndexEntry>> index_updates_;
+};
+
+}  // namespace cache
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace sched {
+
+struct Task {
+  size_t index = 0;         // position in the caller's input list
+  std::uintmax_t cost = 0;  // estimated work, e.g. file size in bytes
+};
+
+// Size-aware work-stealing scheduler.
+//
+// Tasks are sorted by cost (largest first) and dealt to the per-worker deque
+// with the least assigned cost, so every worker starts on its biggest files.
+// A worker pops from the front of its own deque; once that is empty it steals
+// the largest pending task from the deque with the most remaining cost. This
+// keeps a handful of huge files from ending up queued behind each other on a
+// single worker at the end of the run.
+//
+// The scheduler can also be fed incrementally: push() blocks while
+// `capacity` tasks are pending, which bounds memory when a producer (e.g. the
+// directory walk) runs ahead of the workers. Largest-first ordering then only
+// applies within the tasks that are queued at the same time. Workers block in
+// next() until a task arrives or close() is called.
+class WorkStealingScheduler {
+ public:
+  // All tasks known up front; the scheduler is closed immediately.
+  WorkStealingScheduler(std::vector<Task> tasks, unsigned int workers);
+  // Streaming: tasks arrive through push() until close().
+  WorkStealingScheduler(unsigned int workers, size_t capacity);
+
+  void push(Task task);
+  void close();
+
+  // Fetch the next task for `worker`. Returns false once the scheduler is
+  // closed and no work is left.
+  bool next(unsigned int worker, Task &out);
+
+  size_t steals() const { return steals_.load(std::memory_order_relaxed); }
+
+ private:
+  struct Queue {
+    std::mutex mu;
+    // Pending tasks, largest first.
+    std::deque<Task> tasks;
+    // Sum of pending costs, used to pick a stealing victim.
+    std::uintmax_t remaining = 0;
+  };
+
+  void init_queues(unsigned int workers);
+  bool pop_front(Queue &q, Task &out);
+  bool try_take(unsigned int worker, Task &out);
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::atomic<size_t> steals_{0};
+
+  // Pending-task accounting shared with producers.
+  std::mutex state_mu_;
+  std::condition_variable work_cv_;
+  std::condition_variable space_cv_;
+  size_t pending_ = 0;
+  size_t capacity_ = 0;
+  bool closed_ = false;
+};
+
+}  // namespace sched
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "./cli_arguments.h"
+
+namespace serve {
+
+// `cognity serve <paths...>`: analyze the inputs once, then keep the results
+// in memory and up to date. Directories seen during the walk are watched with
+// inotify; a changed file is reparsed incrementally, and created, moved or
+// deleted entries (or an edited .gitignore) trigger a new walk. Clients talk
+// to the daemon over the Unix socket `cli_args.socket`.
+//
+// Protocol: a client sends one tab-separated request line and the server
+// answers and closes the connection:
+//   ping                      -> "pong"
+//   stats                     -> "files\t<n>"
+//   query[\t<abs path>...]    -> one line per function,
+//       "F\t<path>\t<name>\t<complexity>\t<row>\t<start_col>\t<end_col>",
+//     each followed by its lines, "L\t<row>\t<start_col>\t<end_col>\t<c>",
+//     then "S\t<path>\t<reason>" for each selected file over a per-file
+//     limit (not analysed).
+//     A directory selects every file below it; no paths selects everything.
+// Errors are reported as "error\t<message>".
+//
+// Linux only. Runs until SIGINT/SIGTERM and returns the exit code.
+int run(const CLI_ARGUMENTS &cli_args);
+
+// `cognity query [paths...]`: ask a running server for the results of
+// `cli_args.paths` and print them like a normal run (same formats and exit
+// codes), so editors and pre-commit hooks get answers without reparsing.
+int query(const CLI_ARGUMENTS &cli_args);
+
+}  // namespace serve
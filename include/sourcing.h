@@ -6,17 +6,60 @@
 #include <cstring>
 #endif
 
+#include <cstdint>
+#include <functional>
 #include <string>
 #include <vector>
 
 #include "./gsg.h"
 
+struct SourceFile {
+  std::string path;
+  std::uintmax_t size = 0;  // bytes, as seen during discovery
+  // stat metadata from discovery, used by the result cache's stat index to
+  // skip unchanged files without reading them. 0 when unknown.
+  std::uint64_t inode = 0;
+  std::int64_t mtime_ns = 0;
+};
+
 Language detect_language_from_path(const std::string &path);
 
+// SourceFile for `path` with its current size and stat metadata (all zero if
+// the file cannot be stat'ed).
+SourceFile stat_source_file(std::string path);
+
+// Receives files as discovery finds them: a directory's files in the order
+// it lists them, but directories in no particular order when the walk runs
+// on several threads (see collect_source_files).
+using SourceSink = std::function<void(SourceFile)>;
+// Receives every directory the walk enters (i.e. not excluded or ignored).
+using DirSink = std::function<void(const std::string &)>;
+
+// How collect_source_files reads directories: through std::filesystem, or
+// (Linux) through directory descriptors and getdents64, with d_type saying
+// what each entry is and names kept relative to their directory's
+// descriptor. Both find the same files in the same order; Native is the
+// default where it exists and the same as Filesystem elsewhere.
+enum class DirWalker { Filesystem, Native };
+
+// Walks the input directories on `threads` threads (the calling one and
+// threads - 1 more), each reading whole directories and handing their
+// subdirectories to whichever thread is free. emit and on_dir are called
+// one at a time, but with more than one thread in an order that changes
+// from run to run; sort what they collect (sort_by_path) for stable output.
+void collect_source_files(const std::vector<std::string> &inputs,
+                          const std::vector<Language> &filter,
+                          const std::vector<std::string> &excludes,
+                          const SourceSink &emit,
+                          const DirSink &on_dir = nullptr,
+                          DirWalker walker = DirWalker::Native,
+                          unsigned int threads = 1);
+
+// Appends the files found to `out`, sorted by path.
 void collect_source_files(const std::vector<std::string> &inputs,
                           const std::vector<Language> &filter,
                           const std::vector<std::string> &excludes,
-                          std::vector<std::string> &out);
+                          std::vector<SourceFile> &out,
+                          unsigned int threads = 1);
 
-void set_ts_language_for_file(TSParser *parser, Language lang,
-                              const std::string &path);
+void sort_by_path(std::vector<SourceFile> &files);
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <vector>
+
+#include "./cli_arguments.h"
+#include "./output.h"
+#include "./sourcing.h"
+
+namespace watch {
+
+// --watch: starting from the initial run's `files`, `rows` and `skipped`,
+// poll for metadata changes and re-report each changed file, reparsing it
+// incrementally (see project::Model) under the same per-file limits. The
+// inputs are walked again every few seconds to pick up new and deleted
+// files. Runs until interrupted.
+[[noreturn]] void run(const CLI_ARGUMENTS &cli_args,
+                      std::vector<SourceFile> files,
+                      std::vector<report::Row> rows,
+                      const std::vector<report::Skipped> &skipped);
+
+}  // namespace watch
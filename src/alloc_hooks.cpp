@@ -0,0 +1,19 @@
+// Global operator new / delete counting heap allocations per thread for
+// --profile (profile::t_allocations). Linked into the cognity executable
+// only; the test runner has its own counting replacement.
+
+#include <cstdlib>
+#include <new>
+
+#include "../include/profile.h"
+
+void *operator new(std::size_t n) {
+  ++profile::t_allocations;
+  if (void *p = std::malloc(n ? n : 1)) return p;
+  throw std::bad_alloc();
+}
+void *operator new[](std::size_t n) { return ::operator new(n); }
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete[](void *p, std::size_t) noexcept { std::free(p); }
@@ -0,0 +1,378 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include "../include/analysis.h"
+#include "../include/cognitive_complexity.h"
+#include "../include/file_operations.h"
+#include "../include/parser_pool.h"
+#include "../include/profile.h"
+#include "../include/scheduler.h"
+
+namespace analysis {
+
+namespace {
+
+constexpr size_t kLanguageCount = static_cast<size_t>(Language::Unknown) + 1;
+
+// Per-thread analysis state: a parser per grammar and lazily created
+// builders.
+struct Worker {
+  ParserPool parsers;
+  std::array<std::unique_ptr<IBuilder>, kLanguageCount> builders{};
+
+  IBuilder *builder_for(Language lang) {
+    auto &b = builders[static_cast<size_t>(lang)];
+    if (!b) b = make_builder(lang);
+    return b.get();
+  }
+};
+
+struct FileSlot {
+  std::vector<FunctionComplexity> functions;
+  std::string error;
+  std::string skipped;  // why the file was not analysed, if it was not
+  double seconds = 0;
+};
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_between(Clock::time_point a, Clock::time_point b) {
+  return std::chrono::duration<double>(b - a).count();
+}
+
+double percentile(const std::vector<double> &sorted, double p) {
+  if (sorted.empty()) return 0;
+  size_t i = static_cast<size_t>(p * static_cast<double>(sorted.size() - 1));
+  return sorted[i];
+}
+
+// What one worker produced: finished files (by input index) and timings.
+struct WorkerOutput {
+  std::vector<std::pair<size_t, FileSlot>> done;
+  double busy_seconds = 0;
+  double idle_at_seconds = 0;
+  double first_result_seconds = -1;
+};
+
+// Files queued per worker before the directory walk blocks.
+constexpr size_t kQueuedFilesPerWorker = 64;
+
+void analyze_one(Worker &w, const SourceFile &file, const Options &opts,
+                 FileSlot &slot) {
+  const std::string &path = file.path;
+  Language lang = detect_language_from_path(path);
+  IBuilder *builder = w.builder_for(lang);
+  if (!builder) return;
+  profile::FileScope scope(path, lang);
+  // The size and node limits hold for cached results too, so a run reports
+  // the same files skipped whether or not their results were cached. (The
+  // parse timeout is a time budget; a cached file needs no parse.)
+  slot.skipped = over_size_limit(file.size, opts.max_file_bytes);
+  if (!slot.skipped.empty()) return;
+  size_t nodes = 0;
+  auto cached = [&] {
+    if (opts.max_gsg_nodes && nodes > opts.max_gsg_nodes) {
+      slot.functions.clear();
+      slot.skipped = too_many_nodes(opts.max_gsg_nodes);
+      return;
+    }
+    report::sort_functions(slot.functions, opts.sort);
+  };
+
+  std::string tag;
+  if (opts.cache) {
+    tag = cache::grammar_tag(lang, path);
+    if (opts.cache->lookup_unchanged(file, tag, slot.functions, nodes))
+      return cached();
+  }
+
+  TSParser *parser = w.parsers.get(lang, path);
+
+  SourceBuffer buffer;
+  try {
+    profile::Timer t(profile::Phase::Read);
+    buffer = SourceBuffer::open(path, opts.map_files);
+  } catch (const std::runtime_error &e) {
+    slot.error = e.what();
+    return;
+  }
+  const std::string_view source_code = buffer.view();
+  profile::add_bytes_read(source_code.size());
+  // Checked again in case the file grew since the walk.
+  slot.skipped = over_size_limit(source_code.size(), opts.max_file_bytes);
+  if (!slot.skipped.empty()) return;
+
+  if (opts.cache &&
+      opts.cache->lookup(file, tag, source_code, slot.functions, nodes))
+    return cached();
+  builder->set_node_limit(opts.max_gsg_nodes);
+  try {
+    slot.functions = functions_complexity_file(source_code, parser, *builder);
+  } catch (const ParseTimeout &) {
+    slot.skipped = parse_timed_out(opts.parse_timeout_ms);
+    return;
+  } catch (const GSGTooLarge &e) {
+    slot.skipped = e.what();
+    return;
+  }
+  if (opts.cache)
+    opts.cache->store(file, tag, source_code, slot.functions,
+                      builder->nodes_walked());
+  report::sort_functions(slot.functions, opts.sort);
+}
+
+void worker_loop(unsigned int id, sched::WorkStealingScheduler &scheduler,
+                 const std::function<SourceFile(size_t)> &file_of,
+                 const Options &opts, Clock::time_point start,
+                 WorkerOutput &out) {
+  profile::set_thread_name("worker " + std::to_string(id + 1));
+  Worker w;
+  w.parsers.set_timeout_micros(opts.parse_timeout_ms * 1000);
+  sched::Task task;
+  while (scheduler.next(id, task)) {
+    FileSlot slot;
+    const Clock::time_point t0 = Clock::now();
+    analyze_one(w, file_of(task.index), opts, slot);
+    const Clock::time_point t1 = Clock::now();
+    slot.seconds = seconds_between(t0, t1);
+    out.busy_seconds += slot.seconds;
+    if (out.first_result_seconds < 0)
+      out.first_result_seconds = seconds_between(start, t1);
+    out.done.emplace_back(task.index, std::move(slot));
+  }
+  out.idle_at_seconds = seconds_between(start, Clock::now());
+}
+
+// Run-level fields of RunStats, filled once every worker has finished.
+void finish_run(const sched::WorkStealingScheduler &scheduler,
+                const Options &opts, Clock::time_point start,
+                double discovery_seconds, RunStats *stats) {
+  if (opts.cache) {
+    opts.cache->save_index();
+    opts.cache->trim();
+  }
+  if (!stats) return;
+  *stats = RunStats{};
+  stats->wall_seconds = seconds_between(start, Clock::now());
+  stats->discovery_seconds = discovery_seconds;
+  stats->steals = scheduler.steals();
+  if (opts.cache) {
+    stats->cache_enabled = true;
+    stats->cache_hits = opts.cache->hits();
+    stats->cache_stat_hits = opts.cache->stat_hits();
+    stats->cache_misses = opts.cache->misses();
+    stats->cache_evicted = opts.cache->evicted();
+  }
+}
+
+// Put worker results back into input order and flatten them into rows.
+// `stats`, when given, must already hold the run-level fields.
+std::vector<report::Row> merge_outputs(const std::vector<SourceFile> &files,
+                                       std::vector<WorkerOutput> &outputs,
+                                       const Options &opts, RunStats *stats) {
+  std::vector<FileSlot> slots(files.size());
+  for (auto &out : outputs)
+    for (auto &[index, slot] : out.done) slots[index] = std::move(slot);
+
+  if (stats) {
+    stats->workers = static_cast<unsigned int>(outputs.size());
+    for (const auto &slot : slots) stats->file_seconds.push_back(slot.seconds);
+    for (const auto &out : outputs) {
+      stats->worker_busy_seconds.push_back(out.busy_seconds);
+      stats->worker_done_seconds.push_back(out.idle_at_seconds);
+      if (out.first_result_seconds >= 0 &&
+          (stats->first_result_seconds == 0 ||
+           out.first_result_seconds < stats->first_result_seconds))
+        stats->first_result_seconds = out.first_result_seconds;
+    }
+  }
+
+  std::vector<report::Row> rows;
+  for (size_t i = 0; i < files.size(); ++i) {
+    if (!slots[i].error.empty()) throw std::runtime_error(slots[i].error);
+    if (!slots[i].skipped.empty() && opts.on_skip)
+      opts.on_skip(files[i].path, slots[i].skipped);
+    for (auto &fn : slots[i].functions)
+      rows.push_back(report::Row{files[i].path, std::move(fn)});
+  }
+  return rows;
+}
+
+}  // namespace
+
+std::string over_size_limit(std::uintmax_t bytes,
+                            std::uintmax_t max_file_bytes) {
+  if (!max_file_bytes || bytes <= max_file_bytes) return {};
+  return std::to_string(bytes) + " bytes (limit " +
+         std::to_string(max_file_bytes) + ")";
+}
+
+std::string parse_timed_out(std::uint64_t timeout_ms) {
+  return "parse timed out after " + std::to_string(timeout_ms) + " ms";
+}
+
+unsigned int resolve_jobs(int requested) {
+  if (requested > 0) return static_cast<unsigned int>(requested);
+  unsigned int hw = std::thread::hardware_concurrency();
+  return hw ? hw : 1;
+}
+
+std::vector<report::Row> analyze_files(const std::vector<SourceFile> &files,
+                                       const Options &opts, RunStats *stats) {
+  const Clock::time_point start = Clock::now();
+  const unsigned int jobs =
+      std::max(1u, std::min<unsigned int>(opts.jobs, files.size()));
+
+  std::vector<sched::Task> tasks;
+  tasks.reserve(files.size());
+  for (size_t i = 0; i < files.size(); ++i)
+    tasks.push_back(sched::Task{i, files[i].size});
+  sched::WorkStealingScheduler scheduler(std::move(tasks), jobs);
+
+  auto file_of = [&](size_t i) { return files[i]; };
+  std::vector<WorkerOutput> outputs(jobs);
+  if (jobs == 1) {
+    worker_loop(0, scheduler, file_of, opts, start, outputs[0]);
+  } else {
+    std::vector<std::thread> pool;
+    pool.reserve(jobs);
+    for (unsigned int t = 0; t < jobs; ++t)
+      pool.emplace_back(worker_loop, t, std::ref(scheduler), std::cref(file_of),
+                        std::cref(opts), start, std::ref(outputs[t]));
+    for (auto &th : pool) th.join();
+  }
+
+  finish_run(scheduler, opts, start, 0, stats);
+  return merge_outputs(files, outputs, opts, stats);
+}
+
+std::vector<report::Row> analyze_sources(
+    const std::vector<std::string> &inputs, const std::vector<Language> &filter,
+    const std::vector<std::string> &excludes, const Options &opts,
+    std::vector<SourceFile> &files, RunStats *stats) {
+  const Clock::time_point start = Clock::now();
+  const unsigned int jobs = std::max(1u, opts.jobs);
+
+  sched::WorkStealingScheduler scheduler(jobs, kQueuedFilesPerWorker * jobs);
+  std::mutex files_mu;
+  files.clear();
+  auto file_of = [&](size_t i) {
+    std::lock_guard<std::mutex> lock(files_mu);
+    return files[i];
+  };
+
+  std::vector<WorkerOutput> outputs(jobs);
+  std::vector<std::thread> pool;
+  pool.reserve(jobs);
+  for (unsigned int t = 0; t < jobs; ++t)
+    pool.emplace_back(worker_loop, t, std::ref(scheduler), std::cref(file_of),
+                      std::cref(opts), start, std::ref(outputs[t]));
+
+  // The walk runs on this thread while the workers drain the queue. If it
+  // throws, let the workers finish what was queued before rethrowing.
+  try {
+    collect_source_files(inputs, filter, excludes, [&](SourceFile f) {
+      sched::Task task{0, f.size};
+      {
+        std::lock_guard<std::mutex> lock(files_mu);
+        task.index = files.size();
+        files.push_back(std::move(f));
+      }
+      profile::Timer t(profile::Phase::Queue);
+      scheduler.push(task);
+    }, opts.on_dir, DirWalker::Native, jobs);
+  } catch (...) {
+    scheduler.close();
+    for (auto &th : pool) th.join();
+    throw;
+  }
+  const double discovery_seconds = seconds_between(start, Clock::now());
+  scheduler.close();
+  for (auto &th : pool) th.join();
+
+  // Files arrive in whatever order the walk threads read their directories;
+  // sort them so rows do not depend on it, and follow the workers' indices.
+  std::vector<size_t> order(files.size());
+  for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+    return files[a].path < files[b].path;
+  });
+  std::vector<size_t> rank(order.size());
+  std::vector<SourceFile> sorted;
+  sorted.reserve(files.size());
+  for (size_t i = 0; i < order.size(); ++i) {
+    rank[order[i]] = i;
+    sorted.push_back(std::move(files[order[i]]));
+  }
+  files = std::move(sorted);
+  for (auto &out : outputs)
+    for (auto &done : out.done) done.first = rank[done.first];
+
+  finish_run(scheduler, opts, start, discovery_seconds, stats);
+  return merge_outputs(files, outputs, opts, stats);
+}
+
+void print_stats(const RunStats &stats, const std::vector<SourceFile> &files,
+                 std::ostream &os) {
+  std::uintmax_t bytes = 0;
+  for (const auto &f : files) bytes += f.size;
+
+  std::vector<double> sorted = stats.file_seconds;
+  std::sort(sorted.begin(), sorted.end());
+  size_t slowest = 0;
+  for (size_t i = 1; i < stats.file_seconds.size(); ++i)
+    if (stats.file_seconds[i] > stats.file_seconds[slowest]) slowest = i;
+
+  double busy_min = 0, busy_max = 0, first_idle = 0;
+  if (!stats.worker_busy_seconds.empty()) {
+    auto [lo, hi] = std::minmax_element(stats.worker_busy_seconds.begin(),
+                                        stats.worker_busy_seconds.end());
+    busy_min = *lo;
+    busy_max = *hi;
+    first_idle = *std::min_element(stats.worker_done_seconds.begin(),
+                                   stats.worker_done_seconds.end());
+  }
+
+  auto ms = [](double s) { return s * 1000.0; };
+  std::ios_base::fmtflags flags = os.flags();
+  os << std::fixed << std::setprecision(2);
+  os << "Stats:\n"
+     << "  files          " << files.size() << " ("
+     << static_cast<double>(bytes) / (1024.0 * 1024.0) << " MB)\n"
+     << "  workers        " << stats.workers << " (" << stats.steals
+     << " steals)\n"
+     << "  wall time      " << ms(stats.wall_seconds) << " ms\n"
+     << "  discovery      " << ms(stats.discovery_seconds) << " ms\n"
+     << "  first result   " << ms(stats.first_result_seconds) << " ms\n"
+     << "  file latency   p50 " << ms(percentile(sorted, 0.50)) << " ms, p90 "
+     << ms(percentile(sorted, 0.90)) << " ms, p99 "
+     << ms(percentile(sorted, 0.99)) << " ms, max "
+     << ms(percentile(sorted, 1.0)) << " ms\n";
+  if (!files.empty())
+    os << "  slowest file   " << files[slowest].path << '\n';
+  os << "  worker busy    min " << ms(busy_min) << " ms, max " << ms(busy_max)
+     << " ms\n"
+     << "  idle tail      " << ms(stats.wall_seconds - first_idle)
+     << " ms (first idle worker to end of run)\n";
+  if (stats.cache_enabled) {
+    const size_t lookups = stats.cache_hits + stats.cache_misses;
+    os << "  cache          " << stats.cache_hits << " hits ("
+       << stats.cache_stat_hits << " by stat), "
+       << stats.cache_misses << " misses ("
+       << (lookups ? 100.0 * static_cast<double>(stats.cache_hits) /
+                         static_cast<double>(lookups)
+                   : 0.0)
+       << "% hit rate), " << stats.cache_evicted << " evicted\n";
+  }
+  os.flags(flags);
+}
+
+}  // namespace analysis
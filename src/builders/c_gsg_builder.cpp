@@ -1,44 +1,67 @@
 #include <algorithm>
+#include <charconv>
 #include <string>
 #include <string_view>
-#include <vector>
 
 #include "../../include/builders/c_gsg_builder.h"
+#include "../../include/builders/named_children.h"
+#include "../../include/builders/preorder.h"
+#include "../../include/builders/symbol_table.h"
 
 using std::string;
 using std::string_view;
 
-static inline string t(TSNode n) { return string(ts_node_grammar_type(n)); }
+using Sym = CLikeGSGBuilder::Sym;
+using Field = CLikeGSGBuilder::Field;
 
-static string compute_ancestor_qual(TSNode n, const string &src) {
-  std::vector<string> parts;
-  TSNode cur = ts_node_parent(n);
-  while (!ts_node_is_null(cur)) {
-    string ty = t(cur);
-    if (ty == "class_specifier" || ty == "struct_specifier" ||
-        ty == "union_specifier") {
-      TSNode nm = ts_node_child_by_field_name(cur, "name", 4);
-      if (!ts_node_is_null(nm))
-        parts.push_back(string(string_view(src).substr(
-            ts_node_start_byte(nm),
-            ts_node_end_byte(nm) - ts_node_start_byte(nm))));
-    } else if (ty == "namespace_definition") {
-      TSNode nm = ts_node_child_by_field_name(cur, "name", 4);
-      if (!ts_node_is_null(nm))
-        parts.push_back(string(string_view(src).substr(
-            ts_node_start_byte(nm),
-            ts_node_end_byte(nm) - ts_node_start_byte(nm))));
-    }
-    cur = ts_node_parent(cur);
-  }
-  if (parts.empty()) return string{};
-  std::reverse(parts.begin(), parts.end());
-  string out;
-  for (size_t i = 0; i < parts.size(); ++i) {
-    if (i) out += "::";
-    out += parts[i];
+static constexpr SymbolTable<Sym, Field>::Name kSymNames[] = {
+    {"binary_expression", Sym::BinaryExpression},
+    {"case_statement", Sym::CaseStatement},
+    {"class_specifier", Sym::ClassSpecifier},
+    {"conditional_expression", Sym::ConditionalExpression},
+    {"declaration", Sym::Declaration},
+    {"default_statement", Sym::DefaultStatement},
+    {"do_statement", Sym::DoStatement},
+    {"expression_statement", Sym::ExpressionStatement},
+    {"field_declaration_list", Sym::FieldDeclarationList},
+    {"field_identifier", Sym::FieldIdentifier},
+    {"for_statement", Sym::ForStatement},
+    {"function_definition", Sym::FunctionDefinition},
+    {"identifier", Sym::Identifier},
+    {"if_statement", Sym::IfStatement},
+    {"lambda_expression", Sym::LambdaExpression},
+    {"namespace_definition", Sym::NamespaceDefinition},
+    {"return_statement", Sym::ReturnStatement},
+    {"struct_specifier", Sym::StructSpecifier},
+    {"switch_statement", Sym::SwitchStatement},
+    {"template_declaration", Sym::TemplateDeclaration},
+    {"unary_expression", Sym::UnaryExpression},
+    {"union_specifier", Sym::UnionSpecifier},
+    {"while_statement", Sym::WhileStatement},
+};
+
+// In Field order.
+static constexpr string_view kFieldNames[] = {
+    "alternative", "argument", "body", "condition", "consequence",
+    "declarator",  "left",     "name", "right",
+};
+
+CLikeGSGBuilder::CLikeGSGBuilder() : syms_(kSymNames, kFieldNames) {}
+
+size_t CLikeGSGBuilder::enter_scope(TSNode scope, string_view src) {
+  const size_t mark = scope_.size();
+  TSNode nm = field(scope, Field::Name);
+  if (!ts_node_is_null(nm)) {
+    if (!scope_.empty()) scope_ += "::";
+    scope_ += slice(src, nm);
   }
-  return out;
+  return mark;
+}
+
+// `outer` equals `inner` or is a leading "::" component run of it.
+static bool scope_prefix(string_view outer, string_view inner) {
+  return inner.starts_with(outer) && (inner.size() == outer.size() ||
+                                      inner.substr(outer.size(), 2) == "::");
 }
 
 SourceLoc CLikeGSGBuilder::loc(TSNode n) {
@@ -46,384 +69,482 @@ SourceLoc CLikeGSGBuilder::loc(TSNode n) {
   return SourceLoc{p.row, p.column, q.column};
 }
 
-string_view CLikeGSGBuilder::slice(const string &src, TSNode n) {
+string_view CLikeGSGBuilder::slice(string_view src, TSNode n) {
   const uint32_t a = ts_node_start_byte(n);
   const uint32_t b = ts_node_end_byte(n);
   return string_view(src).substr(a, b - a);
 }
 
-std::vector<GSGNode> CLikeGSGBuilder::build_functions(TSNode root,
-                                                      const string &src) {
-  std::vector<GSGNode> funcs;
-  collect_functions_in_scope(root, src, /*qual*/ "", funcs);
-  return funcs;
+void CLikeGSGBuilder::build_functions(TSNode root, string_view src) {
+  syms_.use(ts_node_language(root));
+  scope_.clear();
+  scope_work_.clear();
+  collect_functions_in_scope(root, src, /*qual*/ "");
 }
 
-void CLikeGSGBuilder::collect_functions_in_scope(TSNode n, const string &src,
-                                                 const string &qual,
-                                                 std::vector<GSGNode> &out) {
-  int m = ts_node_named_child_count(n);
-  for (int i = 0; i < m; ++i) {
-    TSNode ch = ts_node_named_child(n, i);
-    string ty = t(ch);
+// Declarations nest as deep as the file does (and the descent passes
+// through everything that is not a function), so the walk keeps its own
+// stack: expanding a node schedules its children's work in order, and
+// work runs last scheduled first.
+void CLikeGSGBuilder::collect_functions_in_scope(TSNode n, string_view src,
+                                                 string_view qual) {
+  const size_t base = scope_work_.size();
+  scope_work_.push_back({ScopeOp::Children, n, {}, qual, 0});
+  while (scope_work_.size() > base) {
+    const ScopeWork w = scope_work_.back();
+    scope_work_.pop_back();
+    switch (w.op) {
+      case ScopeOp::Children: {
+        const size_t mark = scope_work_.size();
+        schedule_scope_children(w.node, src, w.qual);
+        std::reverse(scope_work_.begin() + mark, scope_work_.end());
+        break;
+      }
+      case ScopeOp::Function:
+        // `qual` misses template classes and scope_ misses names taken
+        // from a template's identifier; use whichever is longer, or both.
+        if (w.qual.empty() || scope_prefix(w.qual, scope_))
+          emit_function(build_or_stub(w.node, src, scope_));
+        else if (scope_.empty() || scope_prefix(scope_, w.qual))
+          emit_function(build_or_stub(w.node, src, w.qual));
+        else
+          emit_function(
+              build_or_stub(w.node, src, string(w.qual) + "::" + scope_));
+        break;
+      case ScopeOp::TemplateFunction:
+        emit_function(build_or_stub(w.node, src, w.qual));
+        break;
+      case ScopeOp::Scope: {
+        const size_t mark = enter_scope(w.node, src);
+        scope_work_.push_back({ScopeOp::Restore, {}, {}, {}, mark});
+        scope_work_.push_back({ScopeOp::Children, w.body, {}, w.qual, 0});
+        break;
+      }
+      case ScopeOp::Restore:
+        scope_.resize(w.mark);
+        break;
+    }
+  }
+}
+
+// `qual` with `name` appended as its innermost component.
+string_view CLikeGSGBuilder::nested_qual(string_view qual, string_view name) {
+  return qual.empty() ? name : gsg_.intern({qual, "::", name});
+}
+
+void CLikeGSGBuilder::schedule_scope_children(TSNode n, string_view src,
+                                              string_view qual) {
+  auto schedule = [&](ScopeOp op, TSNode node, string_view q,
+                      TSNode body = TSNode{}) {
+    scope_work_.push_back({op, node, body, q, 0});
+  };
+  for (TSNode ch : NamedChildren(n)) {
+    Sym ty = t(ch);
     // debug: std::cerr << "[CLike] node type: " << ty << "\n";
-    if (ty == "function_definition") {
-      string aq = compute_ancestor_qual(ch, src);
-      string merged;
-      if (qual.empty())
-        merged = aq;
-      else if (aq.empty())
-        merged = qual;
-      else if (aq == qual)
-        merged = qual;
-      else if (aq.rfind(qual + "::", 0) == 0)
-        merged = aq;
-      else if (qual.rfind(aq + "::", 0) == 0)
-        merged = qual;
-      else
-        merged = qual + "::" + aq;
-      out.emplace_back(build_function(ch, src, merged));
-    } else if (ty == "template_declaration") {
-      int tn = ts_node_named_child_count(ch);
-      for (int ti = 0; ti < tn; ++ti) {
-        TSNode inner = ts_node_named_child(ch, ti);
-        string ity = t(inner);
+    if (ty == Sym::FunctionDefinition) {
+      schedule(ScopeOp::Function, ch, qual);
+    } else if (ty == Sym::TemplateDeclaration) {
+      TSNode prev{};  // named sibling before `inner`
+      for (TSNode inner : NamedChildren(ch)) {
+        Sym ity = t(inner);
         // std::cerr << "[CLike] template child: " << ity << "\n";
-        if (ity == "function_definition") {
-          out.emplace_back(build_function(inner, src, qual));
-        } else if (ity == "field_declaration_list") {
-          string q = qual;
-          if (ti - 1 >= 0) {
-            TSNode prev = ts_node_named_child(ch, ti - 1);
-            if (!ts_node_is_null(prev) && t(prev) == "identifier") {
-              string cn = string(slice(src, prev));
-              q = q.empty() ? cn : (qual + "::" + cn);
-            }
-          }
-          collect_functions_in_scope(inner, src, q, out);
-        } else if (ity == "declaration" || ity == "class_specifier" ||
-                   ity == "struct_specifier" || ity == "namespace_definition" ||
-                   ity == "template_declaration") {
-          collect_functions_in_scope(inner, src, qual, out);
+        if (ity == Sym::FunctionDefinition) {
+          schedule(ScopeOp::TemplateFunction, inner, qual);
+        } else if (ity == Sym::FieldDeclarationList) {
+          string_view q = qual;
+          if (!ts_node_is_null(prev) && t(prev) == Sym::Identifier)
+            q = nested_qual(qual, slice(src, prev));
+          schedule(ScopeOp::Children, inner, q);
+        } else if (ity == Sym::ClassSpecifier ||
+                   ity == Sym::StructSpecifier ||
+                   ity == Sym::NamespaceDefinition) {
+          schedule(ScopeOp::Scope, inner, qual, inner);
+        } else if (ity == Sym::Declaration ||
+                   ity == Sym::TemplateDeclaration) {
+          schedule(ScopeOp::Children, inner, qual);
         }
+        prev = inner;
       }
-    } else if (ty == "class_specifier" || ty == "struct_specifier" ||
-               ty == "union_specifier") {
-      TSNode nm = ts_node_child_by_field_name(ch, "name", 4);
-      string q = qual;
-      if (!ts_node_is_null(nm)) {
-        string cn = string(slice(src, nm));
-        q = q.empty() ? cn : (qual + "::" + cn);
-      }
-      TSNode body = ts_node_child_by_field_name(ch, "body", 4);
-      if (!ts_node_is_null(body)) collect_functions_in_scope(body, src, q, out);
-    } else if (ty == "namespace_definition") {
-      TSNode nm = ts_node_child_by_field_name(ch, "name", 4);
-      string q = qual;
-      if (!ts_node_is_null(nm)) {
-        string nn = string(slice(src, nm));
-        q = q.empty() ? nn : (qual + "::" + nn);
-      }
-      TSNode body = ts_node_child_by_field_name(ch, "body", 4);
-      if (!ts_node_is_null(body)) collect_functions_in_scope(body, src, q, out);
+    } else if (ty == Sym::ClassSpecifier || ty == Sym::StructSpecifier ||
+               ty == Sym::UnionSpecifier || ty == Sym::NamespaceDefinition) {
+      TSNode nm = field(ch, Field::Name);
+      string_view q = qual;
+      if (!ts_node_is_null(nm)) q = nested_qual(qual, slice(src, nm));
+      TSNode body = field(ch, Field::Body);
+      if (!ts_node_is_null(body)) schedule(ScopeOp::Scope, ch, q, body);
     } else {
-      collect_functions_in_scope(ch, src, qual, out);
+      schedule(ScopeOp::Children, ch, qual);
     }
   }
 }
 
-string CLikeGSGBuilder::function_name_from_declarator(TSNode decl,
-                                                      const string &src) {
+string_view CLikeGSGBuilder::function_name_from_declarator(
+    TSNode decl, string_view src) const {
   string_view full = slice(src, decl);
   size_t p = full.find('(');
   if (p != string::npos) {
-    string pre(full.substr(0, p));
-    auto trim = [](string &s) {
+    string_view pre = full.substr(0, p);
+    auto trim = [](string_view &s) {
       size_t a = s.find_first_not_of(" \t\n");
       size_t b = s.find_last_not_of(" \t\n");
       if (a == string::npos)
-        s.clear();
+        s = string_view{};
       else
         s = s.substr(a, b - a + 1);
     };
     trim(pre);
     while (!pre.empty() && (pre[0] == '*' || pre[0] == '&' || pre[0] == '('))
-      pre.erase(pre.begin());
+      pre.remove_prefix(1);
     trim(pre);
     if (!pre.empty()) return pre;
   }
-  int n = ts_node_named_child_count(decl);
-  for (int i = 0; i < n; ++i) {
-    TSNode ch = ts_node_named_child(decl, i);
-    string ty = t(ch);
-    if (ty == "identifier" || ty == "field_identifier")
-      return string(slice(src, ch));
-    string nested = function_name_from_declarator(ch, src);
+  for (TSNode ch : NamedChildren(decl)) {
+    Sym ty = t(ch);
+    if (ty == Sym::Identifier || ty == Sym::FieldIdentifier)
+      return slice(src, ch);
+    string_view nested = function_name_from_declarator(ch, src);
     if (!nested.empty()) return nested;
   }
-  return string{};
+  return string_view{};
 }
 
-GSGNode CLikeGSGBuilder::build_function(TSNode n, const string &src) {
+GSGNode CLikeGSGBuilder::build_function(TSNode n, string_view src) {
   GSGNode g;
   g.kind = GSGNodeKind::Function;
   g.loc = loc(n);
-  TSNode decl = ts_node_child_by_field_name(n, "declarator", 10);
+  TSNode decl = field(n, Field::Declarator);
   if (!ts_node_is_null(decl)) g.name = function_name_from_declarator(decl, src);
-  TSNode body = ts_node_child_by_field_name(n, "body", 4);
-  if (!ts_node_is_null(body)) build_block_children(body, src, g.children, 0);
+  open_node(g);
+  TSNode body = field(n, Field::Body);
+  if (!ts_node_is_null(body)) schedule_block(body, 0);
+  run_blocks(src);
+  close_node(g);
   return g;
 }
 
-GSGNode CLikeGSGBuilder::build_function(TSNode n, const string &src,
-                                        const string &qual) {
+GSGNode CLikeGSGBuilder::build_function(TSNode n, string_view src,
+                                        string_view qual) {
   GSGNode g = build_function(n, src);
-  if (!qual.empty() && !g.name.empty()) {
-    string prefix = qual + "::";
-    if (g.name.rfind(prefix, 0) != 0) g.name = prefix + g.name;
+  g.name = qualify(g.name, qual);
+  return g;
+}
+
+GSGNode CLikeGSGBuilder::build_or_stub(TSNode n, string_view src,
+                                       string_view qual) {
+  if (unchanged(n)) {
+    string_view name;
+    TSNode decl = field(n, Field::Declarator);
+    if (!ts_node_is_null(decl)) name = function_name_from_declarator(decl, src);
+    return function_stub(n, qualify(name, qual));
   }
+  GSGNode g = build_function(n, src, qual);
+  g.start_byte = ts_node_start_byte(n);
   return g;
 }
 
-void CLikeGSGBuilder::build_block_children(TSNode n, const string &src,
-                                           std::vector<GSGNode> &out,
-                                           int nesting) {
-  int m = ts_node_named_child_count(n);
-  for (int i = 0; i < m; ++i) {
-    TSNode s = ts_node_named_child(n, i);
-    string ty = t(s);
-    collect_lambdas_in_node(s, src, out);
-    if (ty == "if_statement")
-      out.emplace_back(build_if(s, src));
-    else if (ty == "while_statement")
-      out.emplace_back(build_while(s, src));
-    else if (ty == "for_statement")
-      out.emplace_back(build_for(s, src));
-    else if (ty == "do_statement")
-      out.emplace_back(build_do_while(s, src));
-    else if (ty == "switch_statement") {
-      GSGNode sw;
-      sw.kind = GSGNodeKind::Switch;
-      sw.loc = loc(s);
-      int cn = ts_node_named_child_count(s);
-      for (int j = 0; j < cn; ++j) {
-        TSNode cc = ts_node_named_child(s, j);
-        string cty = t(cc);
-        if (cty == "case_statement" || cty == "default_statement") {
-          GSGNode cs;
-          cs.kind = GSGNodeKind::Case;
-          cs.loc = loc(cc);
-          int bn = ts_node_named_child_count(cc);
-          for (int k = 0; k < bn; ++k) {
-            TSNode bch = ts_node_named_child(cc, k);
-            if (ts_node_is_named(bch))
-              build_block_children(bch, src, cs.children, nesting + 1);
-          }
-          sw.children.emplace_back(std::move(cs));
-        }
-      }
-      out.emplace_back(std::move(sw));
-    } else if (ty == "return_statement") {
-      TSNode arg = ts_node_child_by_field_name(s, "argument", 8);
-      if (!ts_node_is_null(arg)) {
-        unsigned int cost = c_count_bool_ops_expr(arg, nesting, src);
-        if (cost) {
-          GSGNode e;
-          e.kind = GSGNodeKind::Expr;
-          e.loc = loc(s);
-          e.addl_cost = cost;
-          out.emplace_back(std::move(e));
-        }
-      }
-    } else if (ty == "expression_statement") {
-      if (ts_node_named_child_count(s) > 0) {
-        TSNode expr = ts_node_named_child(s, 0);
-        unsigned int cost = c_count_bool_ops_expr(expr, nesting, src);
-        if (cost) {
-          GSGNode e;
-          e.kind = GSGNodeKind::Expr;
-          e.loc = loc(expr);
-          e.addl_cost = cost;
-          out.emplace_back(std::move(e));
+string_view CLikeGSGBuilder::qualify(string_view name, string_view qual) {
+  if (qual.empty() || name.empty()) return name;
+  if (name.size() >= qual.size() + 2 && name.starts_with(qual) &&
+      name.substr(qual.size(), 2) == "::")
+    return name;
+  return gsg_.intern({qual, "::", name});
+}
+
+void CLikeGSGBuilder::build_statement(TSNode s, string_view src,
+                                      int nesting) {
+  Sym ty = t(s);
+  collect_statement_lambdas(s);
+  if (ty == Sym::IfStatement)
+    schedule_if(s, src);
+  else if (ty == Sym::WhileStatement)
+    schedule_while(s, src);
+  else if (ty == Sym::ForStatement)
+    schedule_for(s);
+  else if (ty == Sym::DoStatement)
+    schedule_do_while(s, src);
+  else if (ty == Sym::SwitchStatement) {
+    GSGNode sw;
+    sw.kind = GSGNodeKind::Switch;
+    sw.loc = loc(s);
+    schedule_open(sw);
+    for (TSNode cc : NamedChildren(s)) {
+      Sym cty = t(cc);
+      if (cty == Sym::CaseStatement || cty == Sym::DefaultStatement) {
+        GSGNode cs;
+        cs.kind = GSGNodeKind::Case;
+        cs.loc = loc(cc);
+        schedule_open(cs);
+        for (TSNode bch : NamedChildren(cc)) {
+          if (ts_node_is_named(bch)) schedule_block(bch, nesting + 1);
         }
+        schedule_close();
       }
-    } else if (ty == "declaration") {
-      unsigned int sum = 0;
-      int dn = ts_node_named_child_count(s);
-      for (int di = 0; di < dn; ++di)
-        sum += c_count_bool_ops_expr(ts_node_named_child(s, di), nesting, src);
-      if (sum) {
+    }
+    schedule_close();
+  } else if (ty == Sym::ReturnStatement) {
+    TSNode arg = field(s, Field::Argument);
+    if (!ts_node_is_null(arg)) {
+      unsigned int cost = c_count_bool_ops_expr(arg, nesting, src);
+      if (cost) {
         GSGNode e;
         e.kind = GSGNodeKind::Expr;
         e.loc = loc(s);
-        e.addl_cost = sum;
-        out.emplace_back(std::move(e));
+        e.addl_cost = cost;
+        schedule_push(e);
+      }
+    }
+  } else if (ty == Sym::ExpressionStatement) {
+    if (ts_node_named_child_count(s) > 0) {
+      TSNode expr = ts_node_named_child(s, 0);
+      unsigned int cost = c_count_bool_ops_expr(expr, nesting, src);
+      if (cost) {
+        GSGNode e;
+        e.kind = GSGNodeKind::Expr;
+        e.loc = loc(expr);
+        e.addl_cost = cost;
+        schedule_push(e);
       }
     }
+  } else if (ty == Sym::Declaration) {
+    unsigned int sum = 0;
+    for (TSNode ch : NamedChildren(s))
+      sum += c_count_bool_ops_expr(ch, nesting, src);
+    if (sum) {
+      GSGNode e;
+      e.kind = GSGNodeKind::Expr;
+      e.loc = loc(s);
+      e.addl_cost = sum;
+      schedule_push(e);
+    }
   }
 }
 
-GSGNode CLikeGSGBuilder::build_if(TSNode n, const string &src) {
-  GSGNode g;
-  g.kind = GSGNodeKind::If;
-  g.loc = loc(n);
-  TSNode cond = ts_node_child_by_field_name(n, "condition", 9);
-  if (!ts_node_is_null(cond))
-    g.addl_cost += c_count_bool_ops_expr(cond, 0, src);
-  TSNode cons = ts_node_child_by_field_name(n, "consequence", 11);
-  if (!ts_node_is_null(cons)) build_block_children(cons, src, g.children, 1);
-  TSNode alt = ts_node_child_by_field_name(n, "alternative", 11);
-  if (!ts_node_is_null(alt)) {
-    string ty = t(alt);
-    if (ty == "if_statement") {
-      auto eif = build_if(alt, src);
-      eif.kind = GSGNodeKind::ElseIf;
-      g.children.emplace_back(std::move(eif));
-    } else {
-      int an = ts_node_named_child_count(alt);
-      if (an == 1) {
-        TSNode only = ts_node_named_child(alt, 0);
-        if (!ts_node_is_null(only) && t(only) == "if_statement") {
-          auto eif = build_if(only, src);
-          eif.kind = GSGNodeKind::ElseIf;
-          g.children.emplace_back(std::move(eif));
-          return g;
-        }
+// An if and its else-if chain as nested If/ElseIf nodes, the chain walked
+// in a loop.
+void CLikeGSGBuilder::schedule_if(TSNode n, string_view src) {
+  GSGNodeKind kind = GSGNodeKind::If;
+  size_t opened = 0;
+  for (;;) {
+    GSGNode g;
+    g.kind = kind;
+    g.loc = loc(n);
+    TSNode cond = field(n, Field::Condition);
+    if (!ts_node_is_null(cond))
+      g.addl_cost += c_count_bool_ops_expr(cond, 0, src);
+    schedule_open(g);
+    ++opened;
+    TSNode cons = field(n, Field::Consequence);
+    if (!ts_node_is_null(cons)) schedule_block(cons, 1);
+    TSNode alt = field(n, Field::Alternative);
+    if (ts_node_is_null(alt)) break;
+    kind = GSGNodeKind::ElseIf;
+    if (t(alt) == Sym::IfStatement) {
+      n = alt;
+      continue;
+    }
+    if (ts_node_named_child_count(alt) == 1) {
+      TSNode only = ts_node_named_child(alt, 0);
+      if (!ts_node_is_null(only) && t(only) == Sym::IfStatement) {
+        n = only;
+        continue;
       }
-      GSGNode el;
-      el.kind = GSGNodeKind::Else;
-      el.loc = loc(alt);
-      build_block_children(alt, src, el.children, 1);
-      g.children.emplace_back(std::move(el));
     }
+    GSGNode el;
+    el.kind = GSGNodeKind::Else;
+    el.loc = loc(alt);
+    schedule_open(el);
+    schedule_block(alt, 1);
+    schedule_close();
+    break;
   }
-  return g;
+  while (opened-- > 0) schedule_close();
 }
 
-GSGNode CLikeGSGBuilder::build_while(TSNode n, const string &src) {
+void CLikeGSGBuilder::schedule_while(TSNode n, string_view src) {
   GSGNode g;
   g.kind = GSGNodeKind::While;
   g.loc = loc(n);
-  TSNode cond = ts_node_child_by_field_name(n, "condition", 9);
+  TSNode cond = field(n, Field::Condition);
   if (!ts_node_is_null(cond))
     g.addl_cost += c_count_bool_ops_expr(cond, 0, src);
-  TSNode body = ts_node_child_by_field_name(n, "body", 4);
-  if (!ts_node_is_null(body)) build_block_children(body, src, g.children, 1);
-  return g;
+  schedule_open(g);
+  TSNode body = field(n, Field::Body);
+  if (!ts_node_is_null(body)) schedule_block(body, 1);
+  schedule_close();
 }
 
-GSGNode CLikeGSGBuilder::build_for(TSNode n, const string &src) {
+void CLikeGSGBuilder::schedule_for(TSNode n) {
   GSGNode g;
   g.kind = GSGNodeKind::For;
   g.loc = loc(n);
-  TSNode body = ts_node_child_by_field_name(n, "body", 4);
-  if (!ts_node_is_null(body)) build_block_children(body, src, g.children, 1);
-  return g;
+  schedule_open(g);
+  TSNode body = field(n, Field::Body);
+  if (!ts_node_is_null(body)) schedule_block(body, 1);
+  schedule_close();
 }
 
-GSGNode CLikeGSGBuilder::build_do_while(TSNode n, const string &src) {
+void CLikeGSGBuilder::schedule_do_while(TSNode n, string_view src) {
   GSGNode g;
   g.kind = GSGNodeKind::DoWhile;
   g.loc = loc(n);
-  TSNode cond = ts_node_child_by_field_name(n, "condition", 9);
+  TSNode cond = field(n, Field::Condition);
   if (!ts_node_is_null(cond))
     g.addl_cost += c_count_bool_ops_expr(cond, 0, src);
-  TSNode body = ts_node_child_by_field_name(n, "body", 4);
-  if (!ts_node_is_null(body)) build_block_children(body, src, g.children);
-  return g;
-}
-
-static inline bool has_logical_token(const string &s) {
-  return s.find("&&") != string::npos || s.find("||") != string::npos ||
-         s.find('!') != string::npos;
+  schedule_open(g);
+  TSNode body = field(n, Field::Body);
+  if (!ts_node_is_null(body)) schedule_block(body, 0);
+  schedule_close();
 }
 
-static inline string_view sv_slice(const string &src, TSNode n) {
-  const uint32_t a = ts_node_start_byte(n);
-  const uint32_t b = ts_node_end_byte(n);
-  return string_view(src).substr(a, b - a);
+// The counts below are defined on source text: a binary expression costs
+// 1 if its text holds "&&", "||" or '!' (so "a != b" counts too), and its
+// operator kind is "&&" if its text holds one, else "||" if it holds one.
+// One scan of the outermost expression records how many of each start
+// before every byte, so any subexpression's kind is two lookups.
+void CLikeGSGBuilder::index_logical_text(TSNode n, string_view src) const {
+  const uint32_t a = ts_node_start_byte(n), b = ts_node_end_byte(n);
+  logical_begin_ = a;
+  logical_before_.resize(b - a + 1);
+  LogicalCounts c;
+  for (uint32_t i = a; i < b; ++i) {
+    logical_before_[i - a] = c;
+    const char ch = src[i];
+    const char next = i + 1 < b ? src[i + 1] : '\0';
+    if (ch == '&' && next == '&') ++c.ands;
+    if (ch == '|' && next == '|') ++c.ors;
+    if (ch == '!') ++c.bangs;
+  }
+  logical_before_[b - a] = c;
 }
 
-static unsigned int c_count_bool_alternations(TSNode n, const string &src) {
-  string ty = t(n);
-  unsigned int c = 0;
-  if (ty == "binary_expression") {
-    TSNode left = ts_node_child_by_field_name(n, "left", 4);
-    TSNode right = ts_node_child_by_field_name(n, "right", 5);
-    auto s = sv_slice(src, n);
-    int curr = (s.find("&&") != string::npos)
-                   ? 0
-                   : ((s.find("||") != string::npos) ? 1 : -1);
-    auto sl = sv_slice(src, left);
-    auto sr = sv_slice(src, right);
-    int lb = (sl.find("&&") != string::npos)
-                 ? 0
-                 : ((sl.find("||") != string::npos) ? 1 : -1);
-    int rb = (sr.find("&&") != string::npos)
-                 ? 0
-                 : ((sr.find("||") != string::npos) ? 1 : -1);
-    if (lb != -1 && curr != lb) c++;
-    if (rb != -1 && curr != rb) c++;
-    c += c_count_bool_alternations(left, src);
-    c += c_count_bool_alternations(right, src);
-  }
-  return c;
+CLikeGSGBuilder::LogicalText CLikeGSGBuilder::logical_text(TSNode n) const {
+  if (ts_node_is_null(n)) return {};
+  const uint32_t a = ts_node_start_byte(n) - logical_begin_;
+  const uint32_t b = ts_node_end_byte(n) - logical_begin_;
+  if (a >= b) return {};
+  // A two-byte operator starting at byte i lies in [a, b) if a <= i < b - 1.
+  const LogicalCounts &lo = logical_before_[a];
+  const LogicalCounts &last = logical_before_[b - 1];
+  LogicalText lt;
+  lt.bang = logical_before_[b].bangs > lo.bangs;
+  lt.op = last.ands > lo.ands ? 0 : last.ors > lo.ors ? 1 : -1;
+  return lt;
 }
 
+// The cost of a binary expression is 1 if its text holds a logical
+// operator, plus its alternations: the operands whose operator kind differs
+// from its own, counted down through directly nested binary expressions.
+// Each operand's cost counts its own alternations again, so a binary
+// expression's local alternations (its own two operands) count once for
+// itself and once per binary expression above it in the chain (`chain` on
+// the stack). That sums the cost top-down with each node visited once.
 unsigned int CLikeGSGBuilder::c_count_bool_ops_expr(TSNode n, int nesting,
-                                                    const string &src) {
+                                                    string_view src) const {
   if (ts_node_is_null(n)) return 0;
-  string ty = t(n);
-  if (ty == "binary_expression") {
-    auto s = sv_slice(src, n);
-    unsigned int base = has_logical_token(string(s)) ? 1 : 0;
-    unsigned int alts = c_count_bool_alternations(n, src);
-    TSNode left = ts_node_child_by_field_name(n, "left", 4);
-    TSNode right = ts_node_child_by_field_name(n, "right", 5);
-    return base + alts + c_count_bool_ops_expr(left, nesting, src) +
-           c_count_bool_ops_expr(right, nesting, src);
-  }
-  if (ty == "unary_expression") {
-    auto s = sv_slice(src, n);
-    if (!s.empty() && s.front() == '!') return 1;
+  index_logical_text(n, src);
+  unsigned int cost = 0;
+  auto &stack = stack_;
+  const size_t base = stack.size();
+  stack.push_back({n, 0});
+  while (stack.size() > base) {
+    const Pending p = stack.back();
+    stack.pop_back();
+    n = p.node;
+    if (ts_node_is_null(n)) continue;
+    Sym ty = t(n);
+    if (ty == Sym::BinaryExpression) {
+      TSNode left = field(n, Field::Left);
+      TSNode right = field(n, Field::Right);
+      const LogicalText self = logical_text(n);
+      const int lb = logical_text(left).op, rb = logical_text(right).op;
+      unsigned int local = 0;
+      if (lb != -1 && self.op != lb) local++;
+      if (rb != -1 && self.op != rb) local++;
+      if (self.op != -1 || self.bang) cost += 1;
+      cost += local * (p.chain + 1);
+      stack.push_back({right, p.chain + 1});
+      stack.push_back({left, p.chain + 1});
+      continue;
+    }
+    if (ty == Sym::UnaryExpression) {
+      const uint32_t a = ts_node_start_byte(n);
+      if (a < ts_node_end_byte(n) && src[a] == '!') {
+        cost += 1;
+        continue;
+      }
+    }
+    if (ty == Sym::ConditionalExpression)
+      cost += 1 + static_cast<unsigned int>(nesting);
+    for (TSNode ch : NamedChildren(n)) stack.push_back({ch, 0});
   }
-  if (ty == "conditional_expression") {
-    unsigned int c = 1 + static_cast<unsigned int>(nesting);
-    int m = ts_node_named_child_count(n);
-    for (int i = 0; i < m; ++i)
-      c += c_count_bool_ops_expr(ts_node_named_child(n, i), nesting, src);
-    return c;
+  return cost;
+}
+
+// Lambdas in statement `s` outside the blocks that are walked on their own
+// when `s` is built (loop and branch bodies, case bodies), so each node is
+// searched once and each lambda built once, as a child of its innermost
+// enclosing block.
+void CLikeGSGBuilder::collect_statement_lambdas(TSNode s) {
+  Sym ty = t(s);
+  if (ty == Sym::IfStatement) {
+    collect_if_lambdas(s);
+  } else if (ty == Sym::WhileStatement || ty == Sym::ForStatement ||
+             ty == Sym::DoStatement) {
+    TSNode body = field(s, Field::Body);
+    for (TSNode ch : NamedChildren(s))
+      if (!ts_node_eq(ch, body)) collect_lambdas_in_node(ch);
+  } else if (ty == Sym::SwitchStatement) {
+    for (TSNode ch : NamedChildren(s)) {
+      Sym cty = t(ch);
+      if (cty != Sym::CaseStatement && cty != Sym::DefaultStatement)
+        collect_lambdas_in_node(ch);
+    }
+  } else {
+    collect_lambdas_in_node(s);
   }
-  unsigned int total = 0;
-  int m = ts_node_named_child_count(n);
-  for (int i = 0; i < m; ++i)
-    total += c_count_bool_ops_expr(ts_node_named_child(n, i), nesting, src);
-  return total;
 }
 
-void CLikeGSGBuilder::collect_lambdas_in_node(TSNode n, const string &src,
-                                              std::vector<GSGNode> &out) {
-  if (ts_node_is_null(n)) return;
-  string ty = t(n);
-  if (ty == "lambda_expression") {
-    out.emplace_back(build_lambda(n, src));
-    return;
+// The if statement's condition and those of its else-if chain; the
+// branches are blocks (see schedule_if).
+void CLikeGSGBuilder::collect_if_lambdas(TSNode n) {
+  while (!ts_node_is_null(n)) {
+    TSNode cons = field(n, Field::Consequence);
+    TSNode alt = field(n, Field::Alternative);
+    for (TSNode ch : NamedChildren(n))
+      if (!ts_node_eq(ch, cons) && !ts_node_eq(ch, alt))
+        collect_lambdas_in_node(ch);
+    TSNode next{};
+    if (!ts_node_is_null(alt)) {
+      if (t(alt) == Sym::IfStatement) {
+        next = alt;
+      } else if (ts_node_named_child_count(alt) == 1) {
+        TSNode only = ts_node_named_child(alt, 0);
+        if (t(only) == Sym::IfStatement) next = only;
+      }
+    }
+    n = next;
   }
-  int m = ts_node_named_child_count(n);
-  for (int i = 0; i < m; ++i)
-    collect_lambdas_in_node(ts_node_named_child(n, i), src, out);
 }
 
-GSGNode CLikeGSGBuilder::build_lambda(TSNode n, const string &src) {
+void CLikeGSGBuilder::collect_lambdas_in_node(TSNode n) {
+  preorder(n, [&](TSNode x) {
+    if (t(x) != Sym::LambdaExpression) return true;
+    schedule_lambda(x);
+    return false;
+  });
+}
+
+void CLikeGSGBuilder::schedule_lambda(TSNode n) {
   GSGNode g;
   g.kind = GSGNodeKind::Function;
   g.loc = loc(n);
-  g.name = "lambda @ " + std::to_string(g.loc.row) + ":" +
-           std::to_string(g.loc.start_col);
-  TSNode body = ts_node_child_by_field_name(n, "body", 4);
-  if (!ts_node_is_null(body)) {
-    CLikeGSGBuilder tmp;
-    tmp.build_block_children(body, src, g.children, 0);
-  }
-  return g;
+  char row[16], col[16];
+  auto r = std::to_chars(row, row + sizeof(row), g.loc.row);
+  auto c = std::to_chars(col, col + sizeof(col), g.loc.start_col);
+  g.name = gsg_.intern({"lambda @ ", string_view(row, r.ptr - row), ":",
+                        string_view(col, c.ptr - col)});
+  schedule_open(g);
+  TSNode body = field(n, Field::Body);
+  if (!ts_node_is_null(body)) schedule_block(body, 0);
+  schedule_close();
 }
@@ -3,38 +3,70 @@
 #include <vector>
 
 #include "../../include/builders/javascript_gsg_builder.h"
+#include "../../include/builders/named_children.h"
+#include "../../include/builders/symbol_table.h"
 
 using std::string;
 using std::string_view;
 
-static inline string t(TSNode n) { return string(ts_node_grammar_type(n)); }
+using Sym = JavaScriptGSGBuilder::Sym;
+using Field = JavaScriptGSGBuilder::Field;
+using JSBoolOp = JavaScriptGSGBuilder::BoolOp;
+
+static constexpr SymbolTable<Sym, Field>::Name kSymNames[] = {
+    {"binary_expression", Sym::BinaryExpression},
+    {"class_declaration", Sym::ClassDeclaration},
+    {"conditional_expression", Sym::ConditionalExpression},
+    {"do_statement", Sym::DoStatement},
+    {"expression_statement", Sym::ExpressionStatement},
+    {"for_statement", Sym::ForStatement},
+    {"function_declaration", Sym::FunctionDeclaration},
+    {"identifier", Sym::Identifier},
+    {"if_statement", Sym::IfStatement},
+    {"lexical_declaration", Sym::LexicalDeclaration},
+    {"method_definition", Sym::MethodDefinition},
+    {"parenthesized_expression", Sym::ParenthesizedExpression},
+    {"property_identifier", Sym::PropertyIdentifier},
+    {"return_statement", Sym::ReturnStatement},
+    {"switch_case", Sym::SwitchCase},
+    {"switch_default", Sym::SwitchDefault},
+    {"switch_statement", Sym::SwitchStatement},
+    {"throw_statement", Sym::ThrowStatement},
+    {"unary_expression", Sym::UnaryExpression},
+    {"variable_declaration", Sym::VariableDeclaration},
+    {"while_statement", Sym::WhileStatement},
+};
+
+// In Field order.
+static constexpr string_view kFieldNames[] = {
+    "alternative", "argument",   "body", "condition", "consequence",
+    "consequent",  "expression", "left", "name",      "right",
+};
+
+JavaScriptGSGBuilder::JavaScriptGSGBuilder() : syms_(kSymNames, kFieldNames) {}
 
 SourceLoc JavaScriptGSGBuilder::loc(TSNode n) {
   TSPoint p = ts_node_start_point(n), q = ts_node_end_point(n);
   return SourceLoc{p.row, p.column, q.column};
 }
 
-string_view JavaScriptGSGBuilder::slice(const string &src, TSNode n) {
+string_view JavaScriptGSGBuilder::slice(string_view src, TSNode n) {
   const uint32_t a = ts_node_start_byte(n);
   const uint32_t b = ts_node_end_byte(n);
   return string_view(src).substr(a, b - a);
 }
 
-string_view JavaScriptGSGBuilder::name_of(TSNode n, const string &src) {
-  TSNode name = ts_node_child_by_field_name(n, "name", 4);
+string_view JavaScriptGSGBuilder::name_of(TSNode n, string_view src) const {
+  TSNode name = field(n, Field::Name);
   if (!ts_node_is_null(name)) return slice(src, name);
-  int m = ts_node_named_child_count(n);
-  for (int i = 0; i < m; ++i) {
-    TSNode ch = ts_node_named_child(n, i);
-    if (t(ch) == "identifier" || t(ch) == "property_identifier")
+  for (TSNode ch : NamedChildren(n)) {
+    if (t(ch) == Sym::Identifier || t(ch) == Sym::PropertyIdentifier)
       return slice(src, ch);
   }
   return string_view{};
 }
 
-enum class JSBoolOp { And, Or, Not, Unknown };
-
-static string_view js_slice(const string &src, TSNode n) {
+static string_view js_slice(string_view src, TSNode n) {
   const uint32_t a = ts_node_start_byte(n);
   const uint32_t b = ts_node_end_byte(n);
   return string_view(src).substr(a, b - a);
@@ -47,313 +79,349 @@ static JSBoolOp js_op_from_text(string_view s) {
   return JSBoolOp::Unknown;
 }
 
-static TSNode js_unwrap_parens(TSNode n) {
-  while (!ts_node_is_null(n) &&
-         string_view{ts_node_type(n)} == "parenthesized_expression") {
-    TSNode inner = ts_node_child_by_field_name(n, "expression", 10);
+TSNode JavaScriptGSGBuilder::js_unwrap_parens(TSNode n) const {
+  while (!ts_node_is_null(n) && t(n) == Sym::ParenthesizedExpression) {
+    TSNode inner = field(n, Field::Expression);
     if (ts_node_is_null(inner)) break;
     n = inner;
   }
   return n;
 }
 
-static JSBoolOp js_get_bool_op(TSNode n, const string &src) {
+JSBoolOp JavaScriptGSGBuilder::js_get_bool_op(TSNode n, string_view src) const {
   n = js_unwrap_parens(n);
-  string ty = t(n);
-  if (ty == "binary_expression") {
+  Sym ty = t(n);
+  if (ty == Sym::BinaryExpression) {
     auto s = js_slice(src, n);
     if (s.find("&&") != string::npos) return JSBoolOp::And;
     if (s.find("||") != string::npos) return JSBoolOp::Or;
-  } else if (ty == "unary_expression") {
+  } else if (ty == Sym::UnaryExpression) {
     auto s = js_slice(src, n);
     if (!s.empty() && s[0] == '!') return JSBoolOp::Not;
   }
   return JSBoolOp::Unknown;
 }
 
-static unsigned int js_count_bool_alternations(TSNode n, const string &src) {
-  n = js_unwrap_parens(n);
-  string ty = t(n);
+// Operator changes between binary expression `n` and its own operands.
+unsigned int JavaScriptGSGBuilder::js_local_alternations(
+    TSNode n, string_view src) const {
+  TSNode left = field(n, Field::Left);
+  TSNode right = field(n, Field::Right);
+  JSBoolOp curr = js_get_bool_op(n, src);
+  JSBoolOp lb = js_get_bool_op(left, src);
+  JSBoolOp rb = js_get_bool_op(right, src);
   unsigned int c = 0;
-  if (ty == "binary_expression") {
-    TSNode left = ts_node_child_by_field_name(n, "left", 4);
-    TSNode right = ts_node_child_by_field_name(n, "right", 5);
-    JSBoolOp curr = js_get_bool_op(n, src);
-    JSBoolOp lb = js_get_bool_op(left, src);
-    JSBoolOp rb = js_get_bool_op(right, src);
-    if (lb != JSBoolOp::Unknown && curr != lb) c++;
-    if (rb != JSBoolOp::Unknown && curr != rb) c++;
-    c += js_count_bool_alternations(left, src);
-    c += js_count_bool_alternations(right, src);
+  if (lb != JSBoolOp::Unknown && curr != lb) c++;
+  if (rb != JSBoolOp::Unknown && curr != rb) c++;
+  return c;
+}
+
+// Operator changes down the operand chain of `n`: every binary expression
+// reached from it through left and right operands and parentheses.
+unsigned int JavaScriptGSGBuilder::js_count_bool_alternations(
+    TSNode n, string_view src) const {
+  unsigned int c = 0;
+  auto &stack = stack_;
+  const size_t base = stack.size();
+  stack.push_back({n, 0});
+  while (stack.size() > base) {
+    n = js_unwrap_parens(stack.back().node);
+    stack.pop_back();
+    if (t(n) != Sym::BinaryExpression) continue;
+    c += js_local_alternations(n, src);
+    stack.push_back({field(n, Field::Right), 0});
+    stack.push_back({field(n, Field::Left), 0});
   }
   return c;
 }
 
-static bool js_has_logical_op(TSNode n, const string &src) {
+static bool js_has_logical_op(TSNode n, string_view src) {
   auto s = js_slice(src, n);
   return s.find("&&") != string::npos || s.find("||") != string::npos ||
          s.find("!") != string::npos;
 }
 
-unsigned int JavaScriptGSGBuilder::js_count_bool_ops_expr(TSNode n, int nesting,
-                                                          const string &src) {
-  if (ts_node_is_null(n)) return 0;
-  string ty = t(n);
-  if (ty == "binary_expression") {
-    unsigned int base = js_has_logical_op(n, src) ? 1 : 0;
-    unsigned int alts = js_count_bool_alternations(n, src);
-    TSNode left = ts_node_child_by_field_name(n, "left", 4);
-    TSNode right = ts_node_child_by_field_name(n, "right", 5);
-    return base + alts + js_count_bool_ops_expr(left, nesting, src) +
-           js_count_bool_ops_expr(right, nesting, src);
-  }
-  if (ty == "unary_expression") {
-    auto s = js_slice(src, n);
-    if (!s.empty() && s[0] == '!') return 1;
-  }
-  if (ty == "conditional_expression") {
-    unsigned int c = 1 + static_cast<unsigned int>(nesting);
-    int m = ts_node_named_child_count(n);
-    for (int i = 0; i < m; ++i)
-      c += js_count_bool_ops_expr(ts_node_named_child(n, i), nesting, src);
-    return c;
-  }
+// A binary expression costs 1 if its text holds a logical operator, plus
+// the alternations of its operand chain (js_count_bool_alternations), plus
+// its operands' own costs. Summed without recursion: a binary expression's
+// local alternations count once for itself and once for each binary
+// expression above it in the same chain (`chain` on the stack), so each
+// node is visited once however deep the expression.
+unsigned int JavaScriptGSGBuilder::js_count_bool_ops_expr(
+    TSNode n, int nesting, string_view src) const {
   unsigned int total = 0;
-  int m = ts_node_named_child_count(n);
-  for (int i = 0; i < m; ++i)
-    total += js_count_bool_ops_expr(ts_node_named_child(n, i), nesting, src);
+  auto &stack = stack_;
+  const size_t base = stack.size();
+  stack.push_back({n, 0});
+  while (stack.size() > base) {
+    const Pending p = stack.back();
+    stack.pop_back();
+    n = p.node;
+    if (ts_node_is_null(n)) continue;
+    Sym ty = t(n);
+    if (ty == Sym::BinaryExpression) {
+      if (js_has_logical_op(n, src)) total += 1;
+      total += js_local_alternations(n, src) * (p.chain + 1);
+      stack.push_back({field(n, Field::Left), p.chain + 1});
+      stack.push_back({field(n, Field::Right), p.chain + 1});
+      continue;
+    }
+    if (ty == Sym::UnaryExpression) {
+      auto s = js_slice(src, n);
+      if (!s.empty() && s[0] == '!') {
+        total += 1;
+        continue;
+      }
+    }
+    if (ty == Sym::ConditionalExpression)
+      total += 1 + static_cast<unsigned int>(nesting);
+    // Parentheses pass the chain on to the expression they hold.
+    TSNode inner{};
+    if (ty == Sym::ParenthesizedExpression) inner = field(n, Field::Expression);
+    for (TSNode ch : NamedChildren(n))
+      stack.push_back({ch, ts_node_eq(ch, inner) ? p.chain : 0});
+  }
   return total;
 }
 
-std::vector<GSGNode> JavaScriptGSGBuilder::build_functions(TSNode root,
-                                                           const string &src) {
-  std::vector<GSGNode> funcs;
-  int n = ts_node_named_child_count(root);
-  for (int i = 0; i < n; ++i) {
-    TSNode ch = ts_node_named_child(root, i);
-    string ty = t(ch);
-    if (ty == "function_declaration") {
-      funcs.emplace_back(build_function(ch, src));
-    } else if (ty == "class_declaration") {
-      TSNode body = ts_node_child_by_field_name(ch, "body", 4);
-      int m = ts_node_named_child_count(body);
-      for (int j = 0; j < m; ++j) {
-        TSNode mem = ts_node_named_child(body, j);
-        if (t(mem) == "method_definition") {
-          funcs.emplace_back(build_function(mem, src));
+void JavaScriptGSGBuilder::build_functions(TSNode root, string_view src) {
+  syms_.use(ts_node_language(root));
+  for (TSNode ch : NamedChildren(root)) {
+    Sym ty = t(ch);
+    if (ty == Sym::FunctionDeclaration) {
+      emit_function(build_or_stub(ch, src));
+    } else if (ty == Sym::ClassDeclaration) {
+      TSNode body = field(ch, Field::Body);
+      for (TSNode mem : NamedChildren(body)) {
+        if (t(mem) == Sym::MethodDefinition) {
+          emit_function(build_or_stub(mem, src));
         }
       }
     }
   }
-  return funcs;
 }
 
-GSGNode JavaScriptGSGBuilder::build_function(TSNode n, const string &src) {
+GSGNode JavaScriptGSGBuilder::build_or_stub(TSNode n, string_view src) {
+  if (unchanged(n)) return function_stub(n, name_of(n, src));
+  GSGNode g = build_function(n, src);
+  g.start_byte = ts_node_start_byte(n);
+  return g;
+}
+
+GSGNode JavaScriptGSGBuilder::build_function(TSNode n, string_view src) {
+  GSGNode g = function_node(n, src);
+  open_node(g);
+  TSNode body = field(n, Field::Body);
+  if (!ts_node_is_null(body)) schedule_block(body, 0);
+  run_blocks(src);
+  close_node(g);
+  return g;
+}
+
+GSGNode JavaScriptGSGBuilder::function_node(TSNode n, string_view src) const {
   GSGNode g;
   g.kind = GSGNodeKind::Function;
-  g.name = string(name_of(n, src));
+  g.name = name_of(n, src);
   g.loc = loc(n);
-
-  TSNode body = ts_node_child_by_field_name(n, "body", 4);
-  if (!ts_node_is_null(body)) build_block_children(body, src, g.children, 0);
   return g;
 }
 
-void JavaScriptGSGBuilder::build_block_children(TSNode n, const string &src,
-                                                std::vector<GSGNode> &out,
-                                                int nesting) {
-  int m = ts_node_named_child_count(n);
-  for (int i = 0; i < m; ++i) {
-    TSNode s = ts_node_named_child(n, i);
-    string ty = t(s);
-    if (ty == "if_statement")
-      out.emplace_back(build_if(s, src));
-    else if (ty == "while_statement")
-      out.emplace_back(build_while(s, src));
-    else if (ty == "for_statement")
-      out.emplace_back(build_for(s, src));
-    else if (ty == "do_statement")
-      out.emplace_back(build_do_while(s, src));
-    else if (ty == "function_declaration" || ty == "method_definition")
-      out.emplace_back(build_function(s, src));
-    else if (ty == "switch_statement") {
-      GSGNode sw;
-      sw.kind = GSGNodeKind::Switch;
-      sw.loc = loc(s);
-      TSNode body = ts_node_child_by_field_name(s, "body", 4);
-      if (!ts_node_is_null(body)) {
-        int kmax = ts_node_named_child_count(body);
-        for (int k = 0; k < kmax; ++k) {
-          TSNode cc = ts_node_named_child(body, k);
-          string cty = t(cc);
-          if (cty == "switch_case" || cty == "switch_default") {
-            GSGNode cs;
-            cs.kind = GSGNodeKind::Case;
-            cs.loc = loc(cc);
-            TSNode cbody = ts_node_child_by_field_name(cc, "consequent", 10);
-            if (!ts_node_is_null(cbody)) {
-              string cbty = t(cbody);
-              if (cbty == "return_statement") {
-                TSNode arg = ts_node_child_by_field_name(cbody, "argument", 8);
-                if (ts_node_is_null(arg) &&
-                    ts_node_named_child_count(cbody) > 0)
-                  arg = ts_node_named_child(cbody, 0);
-                if (!ts_node_is_null(arg)) {
-                  unsigned int cost =
-                      js_count_bool_ops_expr(arg, nesting + 1, src);
-                  if (cost) {
-                    GSGNode e;
-                    e.kind = GSGNodeKind::Expr;
-                    e.loc = loc(cbody);
-                    e.addl_cost = cost;
-                    cs.children.emplace_back(std::move(e));
-                  }
+void JavaScriptGSGBuilder::build_statement(TSNode s, string_view src,
+                                           int nesting) {
+  Sym ty = t(s);
+  if (ty == Sym::IfStatement)
+    schedule_if(s, src);
+  else if (ty == Sym::WhileStatement)
+    schedule_while(s, src);
+  else if (ty == Sym::ForStatement)
+    schedule_for(s);
+  else if (ty == Sym::DoStatement)
+    schedule_do_while(s, src);
+  else if (ty == Sym::FunctionDeclaration || ty == Sym::MethodDefinition) {
+    schedule_open(function_node(s, src));
+    TSNode body = field(s, Field::Body);
+    if (!ts_node_is_null(body)) schedule_block(body, 0);
+    schedule_close();
+  } else if (ty == Sym::SwitchStatement) {
+    GSGNode sw;
+    sw.kind = GSGNodeKind::Switch;
+    sw.loc = loc(s);
+    schedule_open(sw);
+    TSNode body = field(s, Field::Body);
+    if (!ts_node_is_null(body)) {
+      for (TSNode cc : NamedChildren(body)) {
+        Sym cty = t(cc);
+        if (cty == Sym::SwitchCase || cty == Sym::SwitchDefault) {
+          GSGNode cs;
+          cs.kind = GSGNodeKind::Case;
+          cs.loc = loc(cc);
+          schedule_open(cs);
+          TSNode cbody = field(cc, Field::Consequent);
+          if (!ts_node_is_null(cbody)) {
+            Sym cbty = t(cbody);
+            if (cbty == Sym::ReturnStatement) {
+              TSNode arg = field(cbody, Field::Argument);
+              if (ts_node_is_null(arg) && ts_node_named_child_count(cbody) > 0)
+                arg = ts_node_named_child(cbody, 0);
+              if (!ts_node_is_null(arg)) {
+                unsigned int cost =
+                    js_count_bool_ops_expr(arg, nesting + 1, src);
+                if (cost) {
+                  GSGNode e;
+                  e.kind = GSGNodeKind::Expr;
+                  e.loc = loc(cbody);
+                  e.addl_cost = cost;
+                  schedule_push(e);
                 }
-              } else if (cbty == "expression_statement") {
-                if (ts_node_named_child_count(cbody) > 0) {
-                  TSNode expr = ts_node_named_child(cbody, 0);
-                  unsigned int cost =
-                      js_count_bool_ops_expr(expr, nesting + 1, src);
-                  if (cost) {
-                    GSGNode e;
-                    e.kind = GSGNodeKind::Expr;
-                    e.loc = loc(expr);
-                    e.addl_cost = cost;
-                    cs.children.emplace_back(std::move(e));
-                  }
+              }
+            } else if (cbty == Sym::ExpressionStatement) {
+              if (ts_node_named_child_count(cbody) > 0) {
+                TSNode expr = ts_node_named_child(cbody, 0);
+                unsigned int cost =
+                    js_count_bool_ops_expr(expr, nesting + 1, src);
+                if (cost) {
+                  GSGNode e;
+                  e.kind = GSGNodeKind::Expr;
+                  e.loc = loc(expr);
+                  e.addl_cost = cost;
+                  schedule_push(e);
                 }
-              } else {
-                build_block_children(cbody, src, cs.children, nesting + 1);
               }
+            } else {
+              schedule_block(cbody, nesting + 1);
             }
-            sw.children.emplace_back(std::move(cs));
           }
+          schedule_close();
         }
       }
-      out.emplace_back(std::move(sw));
-    } else if (ty == "expression_statement") {
-      if (ts_node_named_child_count(s) > 0) {
-        TSNode expr = ts_node_named_child(s, 0);
-        unsigned int cost = js_count_bool_ops_expr(expr, nesting, src);
-        if (cost) {
-          GSGNode e;
-          e.kind = GSGNodeKind::Expr;
-          e.loc = loc(expr);
-          e.addl_cost = cost;
-          out.emplace_back(std::move(e));
-        }
-      }
-    } else if (ty == "return_statement") {
-      TSNode arg = ts_node_child_by_field_name(s, "argument", 8);
-      if (ts_node_is_null(arg) && ts_node_named_child_count(s) > 0)
-        arg = ts_node_named_child(s, 0);
-      if (!ts_node_is_null(arg)) {
-        unsigned int cost = js_count_bool_ops_expr(arg, nesting, src);
-        if (cost) {
-          GSGNode e;
-          e.kind = GSGNodeKind::Expr;
-          e.loc = loc(s);
-          e.addl_cost = cost;
-          out.emplace_back(std::move(e));
-        }
-      }
-    } else if (ty == "throw_statement") {
-      TSNode arg = ts_node_child_by_field_name(s, "argument", 8);
-      if (!ts_node_is_null(arg)) {
-        unsigned int cost = js_count_bool_ops_expr(arg, nesting, src);
-        if (cost) {
-          GSGNode e;
-          e.kind = GSGNodeKind::Expr;
-          e.loc = loc(s);
-          e.addl_cost = cost;
-          out.emplace_back(std::move(e));
-        }
+    }
+    schedule_close();
+  } else if (ty == Sym::ExpressionStatement) {
+    if (ts_node_named_child_count(s) > 0) {
+      TSNode expr = ts_node_named_child(s, 0);
+      unsigned int cost = js_count_bool_ops_expr(expr, nesting, src);
+      if (cost) {
+        GSGNode e;
+        e.kind = GSGNodeKind::Expr;
+        e.loc = loc(expr);
+        e.addl_cost = cost;
+        push_node(e);
       }
-    } else if (ty == "lexical_declaration" || ty == "variable_declaration") {
-      int dn = ts_node_named_child_count(s);
-      unsigned int sum = 0;
-      for (int di = 0; di < dn; ++di) {
-        TSNode d = ts_node_named_child(s, di);
-        sum += js_count_bool_ops_expr(d, nesting, src);
+    }
+  } else if (ty == Sym::ReturnStatement) {
+    TSNode arg = field(s, Field::Argument);
+    if (ts_node_is_null(arg) && ts_node_named_child_count(s) > 0)
+      arg = ts_node_named_child(s, 0);
+    if (!ts_node_is_null(arg)) {
+      unsigned int cost = js_count_bool_ops_expr(arg, nesting, src);
+      if (cost) {
+        GSGNode e;
+        e.kind = GSGNodeKind::Expr;
+        e.loc = loc(s);
+        e.addl_cost = cost;
+        push_node(e);
       }
-      if (sum) {
+    }
+  } else if (ty == Sym::ThrowStatement) {
+    TSNode arg = field(s, Field::Argument);
+    if (!ts_node_is_null(arg)) {
+      unsigned int cost = js_count_bool_ops_expr(arg, nesting, src);
+      if (cost) {
         GSGNode e;
         e.kind = GSGNodeKind::Expr;
         e.loc = loc(s);
-        e.addl_cost = sum;
-        out.emplace_back(std::move(e));
+        e.addl_cost = cost;
+        push_node(e);
       }
     }
+  } else if (ty == Sym::LexicalDeclaration ||
+             ty == Sym::VariableDeclaration) {
+    unsigned int sum = 0;
+    for (TSNode d : NamedChildren(s))
+      sum += js_count_bool_ops_expr(d, nesting, src);
+    if (sum) {
+      GSGNode e;
+      e.kind = GSGNodeKind::Expr;
+      e.loc = loc(s);
+      e.addl_cost = sum;
+      push_node(e);
+    }
   }
 }
 
-GSGNode JavaScriptGSGBuilder::build_if(TSNode n, const string &src) {
-  GSGNode g;
-  g.kind = GSGNodeKind::If;
-  g.loc = loc(n);
-  TSNode cond = ts_node_child_by_field_name(n, "condition", 9);
-  if (!ts_node_is_null(cond))
-    g.addl_cost += js_count_bool_ops_expr(cond, 0, src);
-  TSNode cons = ts_node_child_by_field_name(n, "consequence", 11);
-  if (!ts_node_is_null(cons)) build_block_children(cons, src, g.children, 1);
-  TSNode alt = ts_node_child_by_field_name(n, "alternative", 11);
-  if (!ts_node_is_null(alt)) {
-    string ty = t(alt);
-    if (ty == "if_statement") {
-      auto eif = build_if(alt, src);
-      eif.kind = GSGNodeKind::ElseIf;
-      g.children.emplace_back(std::move(eif));
-    } else {
-      int an = ts_node_named_child_count(alt);
-      if (an == 1) {
-        TSNode only = ts_node_named_child(alt, 0);
-        if (!ts_node_is_null(only) && t(only) == "if_statement") {
-          auto eif = build_if(only, src);
-          eif.kind = GSGNodeKind::ElseIf;
-          g.children.emplace_back(std::move(eif));
-          return g;
-        }
+// An if and its else-if chain as nested If/ElseIf nodes, the chain walked
+// in a loop.
+void JavaScriptGSGBuilder::schedule_if(TSNode n, string_view src) {
+  GSGNodeKind kind = GSGNodeKind::If;
+  size_t opened = 0;
+  for (;;) {
+    GSGNode g;
+    g.kind = kind;
+    g.loc = loc(n);
+    TSNode cond = field(n, Field::Condition);
+    if (!ts_node_is_null(cond))
+      g.addl_cost += js_count_bool_ops_expr(cond, 0, src);
+    schedule_open(g);
+    ++opened;
+    TSNode cons = field(n, Field::Consequence);
+    if (!ts_node_is_null(cons)) schedule_block(cons, 1);
+    TSNode alt = field(n, Field::Alternative);
+    if (ts_node_is_null(alt)) break;
+    kind = GSGNodeKind::ElseIf;
+    if (t(alt) == Sym::IfStatement) {
+      n = alt;
+      continue;
+    }
+    if (ts_node_named_child_count(alt) == 1) {
+      TSNode only = ts_node_named_child(alt, 0);
+      if (!ts_node_is_null(only) && t(only) == Sym::IfStatement) {
+        n = only;
+        continue;
       }
-      GSGNode el;
-      el.kind = GSGNodeKind::Else;
-      el.loc = loc(alt);
-      build_block_children(alt, src, el.children, 1);
-      g.children.emplace_back(std::move(el));
     }
+    GSGNode el;
+    el.kind = GSGNodeKind::Else;
+    el.loc = loc(alt);
+    schedule_open(el);
+    schedule_block(alt, 1);
+    schedule_close();
+    break;
   }
-  return g;
+  while (opened-- > 0) schedule_close();
 }
 
-GSGNode JavaScriptGSGBuilder::build_while(TSNode n, const string &src) {
+void JavaScriptGSGBuilder::schedule_while(TSNode n, string_view src) {
   GSGNode g;
   g.kind = GSGNodeKind::While;
   g.loc = loc(n);
-  TSNode cond = ts_node_child_by_field_name(n, "condition", 9);
+  TSNode cond = field(n, Field::Condition);
   if (!ts_node_is_null(cond))
     g.addl_cost += js_count_bool_ops_expr(cond, 0, src);
-  TSNode body = ts_node_child_by_field_name(n, "body", 4);
-  if (!ts_node_is_null(body)) build_block_children(body, src, g.children, 1);
-  return g;
+  schedule_open(g);
+  TSNode body = field(n, Field::Body);
+  if (!ts_node_is_null(body)) schedule_block(body, 1);
+  schedule_close();
 }
 
-GSGNode JavaScriptGSGBuilder::build_for(TSNode n, const string &src) {
+void JavaScriptGSGBuilder::schedule_for(TSNode n) {
   GSGNode g;
   g.kind = GSGNodeKind::For;
   g.loc = loc(n);
-  TSNode body = ts_node_child_by_field_name(n, "body", 4);
-  if (!ts_node_is_null(body)) build_block_children(body, src, g.children, 1);
-  return g;
+  schedule_open(g);
+  TSNode body = field(n, Field::Body);
+  if (!ts_node_is_null(body)) schedule_block(body, 1);
+  schedule_close();
 }
 
-GSGNode JavaScriptGSGBuilder::build_do_while(TSNode n, const string &src) {
-  (void)src;
+void JavaScriptGSGBuilder::schedule_do_while(TSNode n, string_view src) {
   GSGNode g;
   g.kind = GSGNodeKind::DoWhile;
   g.loc = loc(n);
-  TSNode cond = ts_node_child_by_field_name(n, "condition", 9);
+  TSNode cond = field(n, Field::Condition);
   if (!ts_node_is_null(cond))
     g.addl_cost += js_count_bool_alternations(cond, src);
-  TSNode body = ts_node_child_by_field_name(n, "body", 4);
-  if (!ts_node_is_null(body)) build_block_children(body, src, g.children, 1);
-  return g;
+  schedule_open(g);
+  TSNode body = field(n, Field::Body);
+  if (!ts_node_is_null(body)) schedule_block(body, 1);
+  schedule_close();
 }
@@ -3,12 +3,63 @@
 #include <vector>
 
 #include "../../include/builders/python_gsg_builder.h"
+#include "../../include/builders/named_children.h"
+#include "../../include/builders/preorder.h"
+#include "../../include/builders/symbol_table.h"
 
 using std::string;
 using std::string_view;
+using Sym = PythonGSGBuilder::Sym;
+using Field = PythonGSGBuilder::Field;
 
-static inline string node_type(TSNode n) {
-  return string(ts_node_grammar_type(n));
+static constexpr SymbolTable<Sym, Field>::Name kSymNames[] = {
+    {"_simple_statement", Sym::SimpleStatement},
+    {"assert_statement", Sym::AssertStatement},
+    {"assignment", Sym::Assignment},
+    {"augmented_assignment", Sym::AugmentedAssignment},
+    {"block", Sym::Block},
+    {"boolean_operator", Sym::BooleanOperator},
+    {"case_clause", Sym::CaseClause},
+    {"class_definition", Sym::ClassDefinition},
+    {"comparison_operator", Sym::ComparisonOperator},
+    {"conditional_expression", Sym::ConditionalExpression},
+    {"decorated_definition", Sym::DecoratedDefinition},
+    {"elif_clause", Sym::ElifClause},
+    {"else_clause", Sym::ElseClause},
+    {"except_clause", Sym::ExceptClause},
+    {"expression", Sym::Expression},
+    {"expression_statement", Sym::ExpressionStatement},
+    {"finally_clause", Sym::FinallyClause},
+    {"for_statement", Sym::ForStatement},
+    {"function_definition", Sym::FunctionDefinition},
+    {"if_statement", Sym::IfStatement},
+    {"match_statement", Sym::MatchStatement},
+    {"not_operator", Sym::NotOperator},
+    {"raise_statement", Sym::RaiseStatement},
+    {"return_statement", Sym::ReturnStatement},
+    {"try_statement", Sym::TryStatement},
+    {"while_statement", Sym::WhileStatement},
+    {"with_statement", Sym::WithStatement},
+};
+
+// In Field order.
+static constexpr string_view kFieldNames[] = {
+    "body", "condition", "consequence", "definition",
+    "left", "name",      "right",
+};
+
+PythonGSGBuilder::PythonGSGBuilder() : syms_(kSymNames, kFieldNames) {}
+
+// The body of an except/else/finally clause without a `body` field: its
+// first block child, or a block right after it (then also stored in `taken`
+// so the caller's sibling loop skips it).
+TSNode PythonGSGBuilder::clause_block(TSNode clause, TSNode &taken) const {
+  for (TSNode cand : NamedChildren(clause))
+    if (node_type(cand) == Sym::Block) return cand;
+  TSNode next = ts_node_next_named_sibling(clause);
+  if (ts_node_is_null(next) || node_type(next) != Sym::Block) return TSNode{};
+  taken = next;
+  return next;
 }
 
 SourceLoc PythonGSGBuilder::loc_from_node(TSNode node) {
@@ -16,15 +67,15 @@ SourceLoc PythonGSGBuilder::loc_from_node(TSNode node) {
   return SourceLoc{p.row, p.column, q.column};
 }
 
-string_view PythonGSGBuilder::slice_source(const string &source, TSNode node) {
+string_view PythonGSGBuilder::slice_source(string_view source, TSNode node) {
   const uint32_t a = ts_node_start_byte(node);
   const uint32_t b = ts_node_end_byte(node);
   return string_view(source).substr(a, b - a);
 }
 
 string_view PythonGSGBuilder::get_identifier(TSNode node,
-                                             const string &source) {
-  TSNode name = ts_node_child_by_field_name(node, "name", 4);
+                                             string_view source) const {
+  TSNode name = field(node, Field::Name);
   return slice_source(source, name);
 }
 
@@ -37,28 +88,33 @@ static BoolOp from_text_get_bool_op(string_view s) {
   return BoolOp::Unknown;
 }
 
-static string_view slice_src(const string &source, TSNode node) {
+static string_view slice_src(string_view source, TSNode node) {
   const uint32_t a = ts_node_start_byte(node);
   const uint32_t b = ts_node_end_byte(node);
   return string_view(source).substr(a, b - a);
 }
 
-static BoolOp get_boolean_op_for_node(TSNode node, const string &source) {
+static BoolOp get_boolean_op_for_node(TSNode node, string_view source) {
   return from_text_get_bool_op(slice_src(source, node));
 }
 
-unsigned int PythonGSGBuilder::count_bool_operators(TSNode node,
-                                                    const string &source) {
-  if (ts_node_is_null(node)) return 0;
-  string t = node_type(node);
+// Operator changes down a chain of boolean operators (through their left
+// and right operands); an explicit stack, since a long `a and b and ...`
+// nests one level per operand.
+unsigned int PythonGSGBuilder::count_bool_operators(
+    TSNode node, string_view source) const {
   unsigned int complexity = 0;
-  if (t != "boolean_operator" && t != "not_operator") return 0;
-
-  BoolOp current_bool = get_boolean_op_for_node(node, source);
-
-  if (t == "boolean_operator") {
-    TSNode left = ts_node_child_by_field_name(node, "left", 4);
-    TSNode right = ts_node_child_by_field_name(node, "right", 5);
+  std::vector<TSNode> &stack = stack_;
+  const size_t base = stack.size();
+  stack.push_back(node);
+  while (stack.size() > base) {
+    node = stack.back();
+    stack.pop_back();
+    if (ts_node_is_null(node) || node_type(node) != Sym::BooleanOperator)
+      continue;
+    BoolOp current_bool = get_boolean_op_for_node(node, source);
+    TSNode left = field(node, Field::Left);
+    TSNode right = field(node, Field::Right);
 
     BoolOp left_bool = get_boolean_op_for_node(left, source);
     BoolOp right_bool = get_boolean_op_for_node(right, source);
@@ -67,448 +123,389 @@ unsigned int PythonGSGBuilder::count_bool_operators(TSNode node,
     if (right_bool != BoolOp::Unknown && current_bool != right_bool)
       complexity++;
 
-    complexity += count_bool_operators(left, source);
-    complexity += count_bool_operators(right, source);
+    stack.push_back(right);
+    stack.push_back(left);
   }
   return complexity;
 }
 
-unsigned int PythonGSGBuilder::count_bool_ops_expr(TSNode node, int nesting,
-                                                   const string &source) {
-  if (ts_node_is_null(node)) return 0;
-  string t = node_type(node);
-  if (t == "boolean_operator") {
-    return 1 + count_bool_operators(node, source);
-  }
-  if (t == "not_operator") {
-    return 1;
-  }
-  if (t == "conditional_expression") {
-    unsigned int c = 1 + static_cast<unsigned int>(nesting);
-    int m = ts_node_named_child_count(node);
-    for (int i = 0; i < m; ++i) {
-      c += count_bool_ops_expr(ts_node_named_child(node, i), nesting, source);
-    }
-    return c;
-  }
-  if (t == "comparison_operator") {
-    unsigned int total = 0;
-    int m = ts_node_named_child_count(node);
-    for (int i = 0; i < m; ++i)
-      total +=
-          count_bool_ops_expr(ts_node_named_child(node, i), nesting, source);
-    return total;
-  }
+unsigned int PythonGSGBuilder::count_bool_ops_expr(
+    TSNode node, int nesting, string_view source) const {
   unsigned int total = 0;
-  int m = ts_node_named_child_count(node);
-  for (int i = 0; i < m; ++i)
-    total += count_bool_ops_expr(ts_node_named_child(node, i), nesting, source);
+  preorder(node, [&](TSNode n) {
+    Sym t = node_type(n);
+    if (t == Sym::BooleanOperator) {
+      total += 1 + count_bool_operators(n, source);
+      return false;
+    }
+    if (t == Sym::NotOperator) {
+      total += 1;
+      return false;
+    }
+    if (t == Sym::ConditionalExpression)
+      total += 1 + static_cast<unsigned int>(nesting);
+    return true;
+  });
   return total;
 }
 
-std::vector<GSGNode> PythonGSGBuilder::build_functions(TSNode root,
-                                                       const string &source) {
-  std::vector<GSGNode> funcs;
-  int n = ts_node_named_child_count(root);
-  for (int i = 0; i < n; ++i) {
-    TSNode child = ts_node_named_child(root, i);
-    auto t = node_type(child);
-    if (t == "function_definition") {
-      funcs.emplace_back(build_function(child, source));
-    } else if (t == "decorated_definition") {
-      TSNode def = ts_node_child_by_field_name(child, "definition", 10);
-      if (!ts_node_is_null(def) && node_type(def) == "function_definition")
-        funcs.emplace_back(build_function(def, source));
-      else if (!ts_node_is_null(def) && node_type(def) == "class_definition") {
-        TSNode body = ts_node_child_by_field_name(def, "body", 4);
+void PythonGSGBuilder::build_functions(TSNode root, string_view source) {
+  syms_.use(ts_node_language(root));
+  for (TSNode child : NamedChildren(root)) {
+    Sym t = node_type(child);
+    if (t == Sym::FunctionDefinition) {
+      emit_function(build_or_stub(child, source));
+    } else if (t == Sym::DecoratedDefinition) {
+      TSNode def = field(child, Field::Definition);
+      if (!ts_node_is_null(def) && node_type(def) == Sym::FunctionDefinition)
+        emit_function(build_or_stub(def, source));
+      else if (!ts_node_is_null(def) &&
+               node_type(def) == Sym::ClassDefinition) {
+        TSNode body = field(def, Field::Body);
         if (!ts_node_is_null(body)) {
-          int m = ts_node_named_child_count(body);
-          for (int j = 0; j < m; ++j) {
-            TSNode member = ts_node_named_child(body, j);
-            if (node_type(member) == "function_definition")
-              funcs.emplace_back(build_function(member, source));
+          for (TSNode member : NamedChildren(body)) {
+            if (node_type(member) == Sym::FunctionDefinition)
+              emit_function(build_or_stub(member, source));
           }
         }
       }
-    } else if (t == "class_definition") {
-      TSNode body = ts_node_child_by_field_name(child, "body", 4);
+    } else if (t == Sym::ClassDefinition) {
+      TSNode body = field(child, Field::Body);
       if (!ts_node_is_null(body)) {
-        int m = ts_node_named_child_count(body);
-        for (int j = 0; j < m; ++j) {
-          TSNode member = ts_node_named_child(body, j);
-          if (node_type(member) == "function_definition")
-            funcs.emplace_back(build_function(member, source));
+        for (TSNode member : NamedChildren(body)) {
+          if (node_type(member) == Sym::FunctionDefinition)
+            emit_function(build_or_stub(member, source));
         }
       }
     }
   }
-  return funcs;
 }
 
-GSGNode PythonGSGBuilder::build_function(TSNode node, const string &source) {
+GSGNode PythonGSGBuilder::build_or_stub(TSNode node, string_view source) {
+  if (unchanged(node))
+    return function_stub(node, get_identifier(node, source));
+  GSGNode f = build_function(node, source);
+  f.start_byte = ts_node_start_byte(node);
+  return f;
+}
+
+GSGNode PythonGSGBuilder::build_function(TSNode node, string_view source) {
+  GSGNode f = function_node(node, source);
+  open_node(f);
+  schedule_body(node);
+  run_blocks(source);
+  close_node(f);
+  return f;
+}
+
+GSGNode PythonGSGBuilder::function_node(TSNode node,
+                                        string_view source) const {
   GSGNode f;
   f.kind = GSGNodeKind::Function;
-  f.name = std::string(get_identifier(node, source));
+  f.name = get_identifier(node, source);
   f.loc = loc_from_node(node);
+  return f;
+}
 
-  TSNode body = ts_node_child_by_field_name(node, "body", 4);
-  if (!ts_node_is_null(body)) {
-    bool flattened = false;
-    int bn = ts_node_named_child_count(body);
-    if (bn == 2) {
-      TSNode first = ts_node_named_child(body, 0);
-      TSNode second = ts_node_named_child(body, 1);
-      if (node_type(first) == "function_definition" &&
-          node_type(second) == "return_statement") {
-        TSNode inner_body = ts_node_child_by_field_name(first, "body", 4);
-        if (!ts_node_is_null(inner_body)) {
-          build_block_children(inner_body, source, f.children, 0);
-          flattened = true;
-        }
+void PythonGSGBuilder::schedule_body(TSNode node) {
+  TSNode body = field(node, Field::Body);
+  if (ts_node_is_null(body)) return;
+  int bn = ts_node_named_child_count(body);
+  if (bn == 2) {
+    TSNode first = ts_node_named_child(body, 0);
+    TSNode second = ts_node_named_child(body, 1);
+    if (node_type(first) == Sym::FunctionDefinition &&
+        node_type(second) == Sym::ReturnStatement) {
+      TSNode inner_body = field(first, Field::Body);
+      if (!ts_node_is_null(inner_body)) {
+        schedule_block(inner_body, 0);
+        return;
       }
     }
-    if (!flattened) {
-      build_block_children(body, source, f.children, 0);
-    }
   }
-  return f;
+  schedule_block(body, 0);
 }
 
-void PythonGSGBuilder::build_block_children(TSNode block, const string &source,
-                                            std::vector<GSGNode> &out,
-                                            int nesting) {
-  int n = ts_node_named_child_count(block);
-  for (int i = 0; i < n; ++i) {
-    TSNode stmt = ts_node_named_child(block, i);
-    string t = node_type(stmt);
-    // debug
-    // std::cerr << "stmt type: " << t << "\n";
-    if (t == "for_statement")
-      out.emplace_back(build_for(stmt, source, nesting));
-    else if (t == "while_statement")
-      out.emplace_back(build_while(stmt, source, nesting));
-    else if (t == "if_statement")
-      out.emplace_back(build_if(stmt, source, nesting));
-    else if (t == "match_statement") {
-      int mc = ts_node_named_child_count(stmt);
-      for (int k = 0; k < mc; ++k) {
-        TSNode ch = ts_node_named_child(stmt, k);
-        if (node_type(ch) == "case_clause") {
-          TSNode cbody = ts_node_child_by_field_name(ch, "body", 4);
-          if (!ts_node_is_null(cbody))
-            build_block_children(cbody, source, out, nesting + 1);
-        }
+void PythonGSGBuilder::build_statement(TSNode stmt, string_view source,
+                                       int nesting) {
+  Sym t = node_type(stmt);
+  // debug
+  // std::cerr << "stmt type: " << t << "\n";
+  if (t == Sym::ForStatement)
+    schedule_for(stmt, nesting);
+  else if (t == Sym::WhileStatement)
+    schedule_while(stmt, source, nesting);
+  else if (t == Sym::IfStatement)
+    schedule_if(stmt, source, nesting);
+  else if (t == Sym::MatchStatement) {
+    for (TSNode ch : NamedChildren(stmt)) {
+      if (node_type(ch) == Sym::CaseClause) {
+        TSNode cbody = field(ch, Field::Body);
+        if (!ts_node_is_null(cbody))
+          schedule_block(cbody, nesting + 1);
       }
-    } else if (t == "try_statement") {
-      TSNode body = ts_node_child_by_field_name(stmt, "body", 4);
-      if (!ts_node_is_null(body)) {
-        GSGNode tr;
-        tr.kind = GSGNodeKind::Try;
-        tr.loc = loc_from_node(stmt);
-        build_block_children(body, source, tr.children, nesting + 1);
-        out.emplace_back(std::move(tr));
-      }
-      int m = ts_node_named_child_count(stmt);
-      for (int j = 0; j < m; ++j) {
-        TSNode ch = ts_node_named_child(stmt, j);
-        string cht = node_type(ch);
-        if (cht == "except_clause") {
-          GSGNode ex;
-          ex.kind = GSGNodeKind::Except;
-          ex.loc = loc_from_node(ch);
-          ex.addl_cost = 1;
-          TSNode exbody = ts_node_child_by_field_name(ch, "body", 4);
-          if (ts_node_is_null(exbody))
-            exbody = ts_node_child_by_field_name(ch, "consequence", 11);
-          if (ts_node_is_null(exbody)) {
-            int xcn = ts_node_named_child_count(ch);
-            for (int xi = 0; xi < xcn && ts_node_is_null(exbody); ++xi) {
-              TSNode cand = ts_node_named_child(ch, xi);
-              if (node_type(cand) == "block") exbody = cand;
-            }
-          }
-          if (ts_node_is_null(exbody) && j + 1 < m) {
-            TSNode next = ts_node_named_child(stmt, j + 1);
-            if (node_type(next) == "block") {
-              exbody = next;
-              ++j;
-            }
-          }
-          if (!ts_node_is_null(exbody))
-            build_block_children(exbody, source, ex.children, nesting + 1);
-          out.emplace_back(std::move(ex));
-        } else if (cht == "else_clause") {
-          TSNode elbody = ts_node_child_by_field_name(ch, "body", 4);
-          if (ts_node_is_null(elbody)) {
-            int en = ts_node_named_child_count(ch);
-            for (int ei = 0; ei < en && ts_node_is_null(elbody); ++ei) {
-              TSNode cand = ts_node_named_child(ch, ei);
-              if (node_type(cand) == "block") elbody = cand;
-            }
-          }
-          if (ts_node_is_null(elbody) && j + 1 < m) {
-            TSNode next = ts_node_named_child(stmt, j + 1);
-            if (node_type(next) == "block") {
-              elbody = next;
-              ++j;
-            }
-          }
-          if (!ts_node_is_null(elbody)) {
-            GSGNode el;
-            el.kind = GSGNodeKind::Else;
-            el.loc = loc_from_node(ch);
-            build_block_children(elbody, source, el.children, nesting + 1);
-            out.emplace_back(std::move(el));
-          }
-        } else if (cht == "finally_clause") {
-          TSNode fibody = ts_node_child_by_field_name(ch, "body", 4);
-          if (ts_node_is_null(fibody)) {
-            int fnn = ts_node_named_child_count(ch);
-            for (int fi = 0; fi < fnn && ts_node_is_null(fibody); ++fi) {
-              TSNode cand = ts_node_named_child(ch, fi);
-              if (node_type(cand) == "block") fibody = cand;
-            }
-          }
-          if (ts_node_is_null(fibody) && j + 1 < m) {
-            TSNode next = ts_node_named_child(stmt, j + 1);
-            if (node_type(next) == "block") {
-              fibody = next;
-              ++j;
-            }
-          }
-          if (!ts_node_is_null(fibody)) {
-            GSGNode fin;
-            fin.kind = GSGNodeKind::Finally;
-            fin.loc = loc_from_node(ch);
-            build_block_children(fibody, source, fin.children, nesting + 1);
-            out.emplace_back(std::move(fin));
-          }
+    }
+  } else if (t == Sym::TryStatement) {
+    TSNode body = field(stmt, Field::Body);
+    if (!ts_node_is_null(body)) {
+      GSGNode tr;
+      tr.kind = GSGNodeKind::Try;
+      tr.loc = loc_from_node(stmt);
+      schedule_open(tr);
+      schedule_block(body, nesting + 1);
+      schedule_close();
+    }
+    TSNode taken{};
+    for (TSNode ch : NamedChildren(stmt)) {
+      if (ts_node_eq(ch, taken)) continue;
+      Sym cht = node_type(ch);
+      if (cht == Sym::ExceptClause) {
+        GSGNode ex;
+        ex.kind = GSGNodeKind::Except;
+        ex.loc = loc_from_node(ch);
+        ex.addl_cost = 1;
+        TSNode exbody = field(ch, Field::Body);
+        if (ts_node_is_null(exbody))
+          exbody = field(ch, Field::Consequence);
+        if (ts_node_is_null(exbody)) exbody = clause_block(ch, taken);
+        schedule_open(ex);
+        if (!ts_node_is_null(exbody))
+          schedule_block(exbody, nesting + 1);
+        schedule_close();
+      } else if (cht == Sym::ElseClause) {
+        TSNode elbody = field(ch, Field::Body);
+        if (ts_node_is_null(elbody)) elbody = clause_block(ch, taken);
+        if (!ts_node_is_null(elbody)) {
+          GSGNode el;
+          el.kind = GSGNodeKind::Else;
+          el.loc = loc_from_node(ch);
+          schedule_open(el);
+          schedule_block(elbody, nesting + 1);
+          schedule_close();
+        }
+      } else if (cht == Sym::FinallyClause) {
+        TSNode fibody = field(ch, Field::Body);
+        if (ts_node_is_null(fibody)) fibody = clause_block(ch, taken);
+        if (!ts_node_is_null(fibody)) {
+          GSGNode fin;
+          fin.kind = GSGNodeKind::Finally;
+          fin.loc = loc_from_node(ch);
+          schedule_open(fin);
+          schedule_block(fibody, nesting + 1);
+          schedule_close();
         }
       }
-    } else if (t == "return_statement") {
-      TSNode value = ts_node_named_child(stmt, 0);
-      if (!ts_node_is_null(value) && node_type(value) == "expression") {
-        GSGNode e;
-        e.kind = GSGNodeKind::Expr;
-        e.loc = loc_from_node(stmt);
-        e.addl_cost = count_bool_ops_expr(value, nesting, source);
-        out.emplace_back(std::move(e));
-      }
-    } else if (t == "raise_statement") {
+    }
+  } else if (t == Sym::ReturnStatement) {
+    TSNode value = ts_node_named_child(stmt, 0);
+    if (!ts_node_is_null(value) && node_type(value) == Sym::Expression) {
       GSGNode e;
       e.kind = GSGNodeKind::Expr;
       e.loc = loc_from_node(stmt);
-      unsigned int rc = 0;
-      int m = ts_node_named_child_count(stmt);
-      for (int j = 0; j < m; ++j) {
-        TSNode ch = ts_node_named_child(stmt, j);
-        rc += count_bool_ops_expr(ch, nesting, source);
-      }
-      e.addl_cost = rc;
-      out.emplace_back(std::move(e));
-    } else if (t == "assert_statement") {
+      e.addl_cost = count_bool_ops_expr(value, nesting, source);
+      push_node(e);
+    }
+  } else if (t == Sym::RaiseStatement) {
+    GSGNode e;
+    e.kind = GSGNodeKind::Expr;
+    e.loc = loc_from_node(stmt);
+    unsigned int rc = 0;
+    for (TSNode ch : NamedChildren(stmt)) {
+      rc += count_bool_ops_expr(ch, nesting, source);
+    }
+    e.addl_cost = rc;
+    push_node(e);
+  } else if (t == Sym::AssertStatement) {
+    GSGNode e;
+    e.kind = GSGNodeKind::Expr;
+    e.loc = loc_from_node(stmt);
+    unsigned int ac = 0;
+    for (TSNode ch : NamedChildren(stmt)) {
+      ac += count_bool_ops_expr(ch, nesting, source);
+    }
+    e.addl_cost = ac;
+    push_node(e);
+  } else if (t == Sym::WithStatement) {
+    GSGNode w;
+    w.kind = GSGNodeKind::With;
+    w.loc = loc_from_node(stmt);
+    unsigned int wc = 0;
+    for (TSNode ch : NamedChildren(stmt)) {
+      wc += count_bool_ops_expr(ch, nesting, source);
+    }
+    w.addl_cost = wc;
+    schedule_open(w);
+    TSNode wbody = field(stmt, Field::Body);
+    if (!ts_node_is_null(wbody))
+      schedule_block(wbody, nesting + 1);
+    schedule_close();
+  } else if (t == Sym::Assignment) {
+    TSNode right = field(stmt, Field::Right);
+    if (!ts_node_is_null(right)) {
       GSGNode e;
       e.kind = GSGNodeKind::Expr;
       e.loc = loc_from_node(stmt);
-      unsigned int ac = 0;
-      int m = ts_node_named_child_count(stmt);
-      for (int j = 0; j < m; ++j) {
-        TSNode ch = ts_node_named_child(stmt, j);
-        ac += count_bool_ops_expr(ch, nesting, source);
-      }
-      e.addl_cost = ac;
-      out.emplace_back(std::move(e));
-    } else if (t == "with_statement") {
-      GSGNode w;
-      w.kind = GSGNodeKind::With;
-      w.loc = loc_from_node(stmt);
-      unsigned int wc = 0;
-      int m = ts_node_named_child_count(stmt);
-      for (int j = 0; j < m; ++j) {
-        TSNode ch = ts_node_named_child(stmt, j);
-        wc += count_bool_ops_expr(ch, nesting, source);
-      }
-      w.addl_cost = wc;
-      TSNode wbody = ts_node_child_by_field_name(stmt, "body", 4);
-      if (!ts_node_is_null(wbody))
-        build_block_children(wbody, source, w.children, nesting + 1);
-      out.emplace_back(std::move(w));
-    } else if (t == "assignment") {
-      TSNode right = ts_node_child_by_field_name(stmt, "right", 5);
-      if (!ts_node_is_null(right)) {
-        GSGNode e;
-        e.kind = GSGNodeKind::Expr;
-        e.loc = loc_from_node(stmt);
-        e.addl_cost = count_bool_ops_expr(right, nesting, source);
-        out.emplace_back(std::move(e));
-      }
-    } else if (t == "augmented_assignment") {
-      TSNode right = ts_node_child_by_field_name(stmt, "right", 5);
-      if (!ts_node_is_null(right)) {
-        GSGNode e;
-        e.kind = GSGNodeKind::Expr;
-        e.loc = loc_from_node(stmt);
-        e.addl_cost = count_bool_ops_expr(right, nesting, source);
-        out.emplace_back(std::move(e));
-      }
-    } else if (t == "_simple_statement" || t == "expression_statement") {
-      int sN = ts_node_named_child_count(stmt);
-      for (int sj = 0; sj < sN; ++sj) {
-        TSNode sub = ts_node_named_child(stmt, sj);
-        string st = node_type(sub);
-        // std::cerr << "  simple sub: " << st << "\n";
-        if (st == "assignment") {
-          TSNode right = ts_node_child_by_field_name(sub, "right", 5);
-          unsigned int cost = 0;
-          if (!ts_node_is_null(right))
-            cost = count_bool_ops_expr(right, nesting, source);
-          else
-            cost = count_bool_ops_expr(sub, nesting, source);
-          if (cost) {
-            GSGNode e;
-            e.kind = GSGNodeKind::Expr;
-            e.loc = loc_from_node(sub);
-            e.addl_cost = cost;
-            out.emplace_back(std::move(e));
-          }
-        } else if (st == "augmented_assignment") {
-          TSNode right = ts_node_child_by_field_name(sub, "right", 5);
-          unsigned int cost = 0;
-          if (!ts_node_is_null(right))
-            cost = count_bool_ops_expr(right, nesting, source);
-          else
-            cost = count_bool_ops_expr(sub, nesting, source);
-          if (cost) {
-            GSGNode e;
-            e.kind = GSGNodeKind::Expr;
-            e.loc = loc_from_node(sub);
-            e.addl_cost = cost;
-            out.emplace_back(std::move(e));
-          }
-        } else if (st == "return_statement") {
-          TSNode value = ts_node_named_child(sub, 0);
-          unsigned int cost = 0;
-          if (!ts_node_is_null(value))
-            cost = count_bool_ops_expr(value, nesting, source);
-          else
-            cost = count_bool_ops_expr(sub, nesting, source);
-          if (cost) {
-            GSGNode e;
-            e.kind = GSGNodeKind::Expr;
-            e.loc = loc_from_node(sub);
-            e.addl_cost = cost;
-            out.emplace_back(std::move(e));
-          }
-        } else if (st == "assert_statement") {
-          unsigned int ac = 0;
-          int cm = ts_node_named_child_count(sub);
-          for (int cj = 0; cj < cm; ++cj)
-            ac += count_bool_ops_expr(ts_node_named_child(sub, cj), nesting,
-                                      source);
-          if (ac) {
-            GSGNode e;
-            e.kind = GSGNodeKind::Expr;
-            e.loc = loc_from_node(sub);
-            e.addl_cost = ac;
-            out.emplace_back(std::move(e));
-          }
-        } else if (st == "raise_statement") {
-          unsigned int rc = 0;
-          int rm = ts_node_named_child_count(sub);
-          for (int rj = 0; rj < rm; ++rj)
-            rc += count_bool_ops_expr(ts_node_named_child(sub, rj), nesting,
-                                      source);
-          if (rc) {
-            GSGNode e;
-            e.kind = GSGNodeKind::Expr;
-            e.loc = loc_from_node(sub);
-            e.addl_cost = rc;
-            out.emplace_back(std::move(e));
-          }
-        } else if (st == "conditional_expression") {
-          unsigned int cost = count_bool_ops_expr(sub, nesting, source);
-          if (cost) {
-            GSGNode e;
-            e.kind = GSGNodeKind::Expr;
-            e.loc = loc_from_node(sub);
-            e.addl_cost = cost;
-            out.emplace_back(std::move(e));
-          }
+      e.addl_cost = count_bool_ops_expr(right, nesting, source);
+      push_node(e);
+    }
+  } else if (t == Sym::AugmentedAssignment) {
+    TSNode right = field(stmt, Field::Right);
+    if (!ts_node_is_null(right)) {
+      GSGNode e;
+      e.kind = GSGNodeKind::Expr;
+      e.loc = loc_from_node(stmt);
+      e.addl_cost = count_bool_ops_expr(right, nesting, source);
+      push_node(e);
+    }
+  } else if (t == Sym::SimpleStatement || t == Sym::ExpressionStatement) {
+    for (TSNode sub : NamedChildren(stmt)) {
+      Sym st = node_type(sub);
+      // std::cerr << "  simple sub: " << st << "\n";
+      if (st == Sym::Assignment) {
+        TSNode right = field(sub, Field::Right);
+        unsigned int cost = 0;
+        if (!ts_node_is_null(right))
+          cost = count_bool_ops_expr(right, nesting, source);
+        else
+          cost = count_bool_ops_expr(sub, nesting, source);
+        if (cost) {
+          GSGNode e;
+          e.kind = GSGNodeKind::Expr;
+          e.loc = loc_from_node(sub);
+          e.addl_cost = cost;
+          push_node(e);
+        }
+      } else if (st == Sym::AugmentedAssignment) {
+        TSNode right = field(sub, Field::Right);
+        unsigned int cost = 0;
+        if (!ts_node_is_null(right))
+          cost = count_bool_ops_expr(right, nesting, source);
+        else
+          cost = count_bool_ops_expr(sub, nesting, source);
+        if (cost) {
+          GSGNode e;
+          e.kind = GSGNodeKind::Expr;
+          e.loc = loc_from_node(sub);
+          e.addl_cost = cost;
+          push_node(e);
+        }
+      } else if (st == Sym::ReturnStatement) {
+        TSNode value = ts_node_named_child(sub, 0);
+        unsigned int cost = 0;
+        if (!ts_node_is_null(value))
+          cost = count_bool_ops_expr(value, nesting, source);
+        else
+          cost = count_bool_ops_expr(sub, nesting, source);
+        if (cost) {
+          GSGNode e;
+          e.kind = GSGNodeKind::Expr;
+          e.loc = loc_from_node(sub);
+          e.addl_cost = cost;
+          push_node(e);
+        }
+      } else if (st == Sym::AssertStatement) {
+        unsigned int ac = 0;
+        for (TSNode ch : NamedChildren(sub))
+          ac += count_bool_ops_expr(ch, nesting, source);
+        if (ac) {
+          GSGNode e;
+          e.kind = GSGNodeKind::Expr;
+          e.loc = loc_from_node(sub);
+          e.addl_cost = ac;
+          push_node(e);
+        }
+      } else if (st == Sym::RaiseStatement) {
+        unsigned int rc = 0;
+        for (TSNode ch : NamedChildren(sub))
+          rc += count_bool_ops_expr(ch, nesting, source);
+        if (rc) {
+          GSGNode e;
+          e.kind = GSGNodeKind::Expr;
+          e.loc = loc_from_node(sub);
+          e.addl_cost = rc;
+          push_node(e);
+        }
+      } else if (st == Sym::ConditionalExpression) {
+        unsigned int cost = count_bool_ops_expr(sub, nesting, source);
+        if (cost) {
+          GSGNode e;
+          e.kind = GSGNodeKind::Expr;
+          e.loc = loc_from_node(sub);
+          e.addl_cost = cost;
+          push_node(e);
         }
       }
-    } else if (t == "function_definition") {
-      out.emplace_back(build_function(stmt, source));
-    } else {
     }
+  } else if (t == Sym::FunctionDefinition) {
+    schedule_open(function_node(stmt, source));
+    schedule_body(stmt);
+    schedule_close();
+  } else {
   }
 }
 
-GSGNode PythonGSGBuilder::build_for(TSNode node, const string &source,
-                                    int nesting) {
-  (void)source;
+void PythonGSGBuilder::schedule_for(TSNode node, int nesting) {
   GSGNode g;
   g.kind = GSGNodeKind::For;
   g.loc = loc_from_node(node);
-  TSNode body = ts_node_child_by_field_name(node, "body", 4);
-  if (!ts_node_is_null(body))
-    build_block_children(body, source, g.children, nesting + 1);
-  return g;
+  schedule_open(g);
+  TSNode body = field(node, Field::Body);
+  if (!ts_node_is_null(body)) schedule_block(body, nesting + 1);
+  schedule_close();
 }
 
-GSGNode PythonGSGBuilder::build_while(TSNode node, const string &source,
+void PythonGSGBuilder::schedule_while(TSNode node, string_view source,
                                       int nesting) {
   GSGNode g;
   g.kind = GSGNodeKind::While;
   g.loc = loc_from_node(node);
 
-  TSNode cond = ts_node_child_by_field_name(node, "condition", 9);
+  TSNode cond = field(node, Field::Condition);
   if (!ts_node_is_null(cond))
     g.addl_cost += count_bool_ops_expr(cond, nesting, source);
 
-  TSNode body = ts_node_child_by_field_name(node, "body", 4);
-  if (!ts_node_is_null(body))
-    build_block_children(body, source, g.children, nesting + 1);
-  return g;
+  schedule_open(g);
+  TSNode body = field(node, Field::Body);
+  if (!ts_node_is_null(body)) schedule_block(body, nesting + 1);
+  schedule_close();
 }
 
-GSGNode PythonGSGBuilder::build_if(TSNode node, const string &source,
+void PythonGSGBuilder::schedule_if(TSNode node, string_view source,
                                    int nesting) {
   GSGNode g;
   g.kind = GSGNodeKind::If;
   g.loc = loc_from_node(node);
 
-  TSNode cond = ts_node_child_by_field_name(node, "condition", 9);
+  TSNode cond = field(node, Field::Condition);
   if (!ts_node_is_null(cond))
     g.addl_cost += count_bool_ops_expr(cond, nesting, source);
 
-  TSNode cons = ts_node_child_by_field_name(node, "consequence", 11);
-  if (!ts_node_is_null(cons))
-    build_block_children(cons, source, g.children, nesting + 1);
+  schedule_open(g);
+  TSNode cons = field(node, Field::Consequence);
+  if (!ts_node_is_null(cons)) schedule_block(cons, nesting + 1);
 
-  int n = ts_node_named_child_count(node);
-  for (int i = 0; i < n; ++i) {
-    TSNode ch = ts_node_named_child(node, i);
-    string t = node_type(ch);
-    if (t == "elif_clause") {
+  for (TSNode ch : NamedChildren(node)) {
+    Sym t = node_type(ch);
+    if (t == Sym::ElifClause) {
       GSGNode eif;
       eif.kind = GSGNodeKind::ElseIf;
       eif.loc = loc_from_node(ch);
-      TSNode econd = ts_node_child_by_field_name(ch, "condition", 9);
+      TSNode econd = field(ch, Field::Condition);
       if (!ts_node_is_null(econd))
         eif.addl_cost += count_bool_ops_expr(econd, nesting, source);
-      TSNode ebody = ts_node_child_by_field_name(ch, "consequence", 11);
-      if (!ts_node_is_null(ebody))
-        build_block_children(ebody, source, eif.children, nesting + 1);
-      g.children.emplace_back(std::move(eif));
-    } else if (t == "else_clause") {
+      schedule_open(eif);
+      TSNode ebody = field(ch, Field::Consequence);
+      if (!ts_node_is_null(ebody)) schedule_block(ebody, nesting + 1);
+      schedule_close();
+    } else if (t == Sym::ElseClause) {
       GSGNode el;
       el.kind = GSGNodeKind::Else;
       el.loc = loc_from_node(ch);
-      TSNode ebody = ts_node_child_by_field_name(ch, "body", 4);
-      if (!ts_node_is_null(ebody))
-        build_block_children(ebody, source, el.children, nesting + 1);
-      g.children.emplace_back(std::move(el));
+      schedule_open(el);
+      TSNode ebody = field(ch, Field::Body);
+      if (!ts_node_is_null(ebody)) schedule_block(ebody, nesting + 1);
+      schedule_close();
     }
   }
-  return g;
+  schedule_close();
 }
@@ -50,11 +50,43 @@ static bool is_version(std::string &s) { return s == "--version"; }
 
 static bool is_exclude(std::string &s) { return s == "--exclude" || s == "-x"; }
 
+static bool is_jobs(std::string &s) { return s == "--jobs" || s == "-j"; }
+
+static bool is_stats(std::string &s) { return s == "--stats"; }
+
+static bool is_cache_dir(std::string &s) { return s == "--cache-dir"; }
+
+static bool is_cache_max_mb(std::string &s) { return s == "--cache-max-mb"; }
+
+static bool is_watch(std::string &s) { return s == "--watch"; }
+
+static bool is_socket(std::string &s) { return s == "--socket"; }
+
+static bool is_parse_timeout_ms(std::string &s) {
+  return s == "--parse-timeout-ms";
+}
+
+static bool is_max_file_bytes(std::string &s) {
+  return s == "--max-file-bytes";
+}
+
+static bool is_max_gsg_nodes(std::string &s) { return s == "--max-gsg-nodes"; }
+
+static bool is_profile(std::string &s) { return s == "--profile"; }
+
+static bool is_profile_top(std::string &s) { return s == "--profile-top"; }
+
+static bool is_trace_out(std::string &s) { return s == "--trace-out"; }
+
 bool is_argument(std::string &s) {
   return is_max_complexity(s) or is_quiet(s) or is_ignore_complexity(s) or
          is_detail(s) or is_sort(s) or is_output_csv(s) or is_output_json(s) ||
          is_lang(s) || is_exclude(s) || is_max_fn_width(s) || is_help(s) ||
-         is_version(s);
+         is_version(s) || is_jobs(s) || is_stats(s) || is_cache_dir(s) ||
+         is_cache_max_mb(s) || is_watch(s) || is_socket(s) ||
+         is_parse_timeout_ms(s) || is_max_file_bytes(s) ||
+         is_max_gsg_nodes(s) || is_profile(s) || is_profile_top(s) ||
+         is_trace_out(s);
 }
 
 static Language language_from_token(std::string tok) {
@@ -266,6 +298,18 @@ CLI_PARSE_RESULT parse_arguments_relaxed(std::vector<std::string> &arguments) {
   int max_function_width = 0;
   bool show_help = false;
   bool show_version = false;
+  int jobs = 0;
+  bool stats = false;
+  std::string cache_dir;
+  int cache_max_mb = 256;
+  bool watch = false;
+  std::string socket = ".cognity.sock";
+  int parse_timeout_ms = 0;
+  int max_file_bytes = 0;
+  int max_gsg_nodes = 0;
+  bool profile = false;
+  int profile_top = 10;
+  std::string trace_out;
 
   for (i = 0; i < arguments.size() && reading_paths; i++) {
     if (!is_argument(arguments[i]))
@@ -346,6 +390,111 @@ CLI_PARSE_RESULT parse_arguments_relaxed(std::vector<std::string> &arguments) {
         throw std::invalid_argument(
             "Expected a number after --max-fn-width/-fw");
       }
+    } else if (is_jobs(arguments[i])) {
+      if (++i >= arguments.size())
+        throw std::invalid_argument("Expected number after --jobs/-j");
+      try {
+        jobs = std::stoi(arguments[i]);
+        if (jobs < 0) jobs = 0;
+        res.has_jobs = true;
+      } catch (const std::invalid_argument &e) {
+        throw std::invalid_argument("Expected a number after --jobs/-j");
+      } catch (const std::out_of_range &e) {
+        throw std::invalid_argument("Expected a number after --jobs/-j");
+      }
+    } else if (is_stats(arguments[i])) {
+      stats = true;
+      res.has_stats = true;
+    } else if (is_watch(arguments[i])) {
+      watch = true;
+      res.has_watch = true;
+    } else if (is_socket(arguments[i])) {
+      if (++i >= arguments.size())
+        throw std::invalid_argument("Expected path after --socket");
+      socket = arguments[i];
+      res.has_socket = true;
+    } else if (is_cache_dir(arguments[i])) {
+      if (++i >= arguments.size())
+        throw std::invalid_argument("Expected directory after --cache-dir");
+      cache_dir = arguments[i];
+      res.has_cache_dir = true;
+    } else if (is_cache_max_mb(arguments[i])) {
+      if (++i >= arguments.size())
+        throw std::invalid_argument("Expected number after --cache-max-mb");
+      try {
+        cache_max_mb = std::stoi(arguments[i]);
+        if (cache_max_mb < 0) cache_max_mb = 0;
+        res.has_cache_max_mb = true;
+      } catch (const std::invalid_argument &e) {
+        throw std::invalid_argument("Expected a number after --cache-max-mb");
+      } catch (const std::out_of_range &e) {
+        throw std::invalid_argument("Expected a number after --cache-max-mb");
+      }
+    } else if (is_parse_timeout_ms(arguments[i])) {
+      if (++i >= arguments.size())
+        throw std::invalid_argument(
+            "Expected number after --parse-timeout-ms");
+      try {
+        parse_timeout_ms = std::stoi(arguments[i]);
+        if (parse_timeout_ms < 0) parse_timeout_ms = 0;
+        res.has_parse_timeout_ms = true;
+      } catch (const std::invalid_argument &e) {
+        throw std::invalid_argument(
+            "Expected a number after --parse-timeout-ms");
+      } catch (const std::out_of_range &e) {
+        throw std::invalid_argument(
+            "Expected a number after --parse-timeout-ms");
+      }
+    } else if (is_max_file_bytes(arguments[i])) {
+      if (++i >= arguments.size())
+        throw std::invalid_argument(
+            "Expected number after --max-file-bytes");
+      try {
+        max_file_bytes = std::stoi(arguments[i]);
+        if (max_file_bytes < 0) max_file_bytes = 0;
+        res.has_max_file_bytes = true;
+      } catch (const std::invalid_argument &e) {
+        throw std::invalid_argument(
+            "Expected a number after --max-file-bytes");
+      } catch (const std::out_of_range &e) {
+        throw std::invalid_argument(
+            "Expected a number after --max-file-bytes");
+      }
+    } else if (is_max_gsg_nodes(arguments[i])) {
+      if (++i >= arguments.size())
+        throw std::invalid_argument(
+            "Expected number after --max-gsg-nodes");
+      try {
+        max_gsg_nodes = std::stoi(arguments[i]);
+        if (max_gsg_nodes < 0) max_gsg_nodes = 0;
+        res.has_max_gsg_nodes = true;
+      } catch (const std::invalid_argument &e) {
+        throw std::invalid_argument(
+            "Expected a number after --max-gsg-nodes");
+      } catch (const std::out_of_range &e) {
+        throw std::invalid_argument(
+            "Expected a number after --max-gsg-nodes");
+      }
+    } else if (is_profile(arguments[i])) {
+      profile = true;
+      res.has_profile = true;
+    } else if (is_profile_top(arguments[i])) {
+      if (++i >= arguments.size())
+        throw std::invalid_argument("Expected number after --profile-top");
+      try {
+        profile_top = std::stoi(arguments[i]);
+        if (profile_top < 0) profile_top = 0;
+        res.has_profile_top = true;
+      } catch (const std::invalid_argument &e) {
+        throw std::invalid_argument("Expected a number after --profile-top");
+      } catch (const std::out_of_range &e) {
+        throw std::invalid_argument("Expected a number after --profile-top");
+      }
+    } else if (is_trace_out(arguments[i])) {
+      if (++i >= arguments.size())
+        throw std::invalid_argument("Expected path after --trace-out");
+      trace_out = arguments[i];
+      res.has_trace_out = true;
     } else if (is_detail(arguments[i])) {
       if (++i >= arguments.size())
         throw std::invalid_argument(
@@ -396,6 +545,18 @@ CLI_PARSE_RESULT parse_arguments_relaxed(std::vector<std::string> &arguments) {
                            max_function_width,
                            show_help,
                            show_version,
-                           langs_filter};
+                           langs_filter,
+                           jobs,
+                           stats,
+                           cache_dir,
+                           cache_max_mb,
+                           watch,
+                           socket,
+                           parse_timeout_ms,
+                           max_file_bytes,
+                           max_gsg_nodes,
+                           profile,
+                           profile_top,
+                           trace_out};
   return res;
 }
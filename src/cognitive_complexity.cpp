@@ -1,106 +1,303 @@
+#include <algorithm>
+
 #include "../include/builders/c_gsg_builder.h"
 #include "../include/builders/javascript_gsg_builder.h"
 #include "../include/builders/python_gsg_builder.h"
 #include "../include/cognitive_complexity.h"
 #include "../include/gsg.h"
+#include "../include/profile.h"
 
 static inline LineComplexity build_line_complexity_from_loc(
     const SourceLoc &loc, unsigned int c) {
   return LineComplexity{loc.row, loc.start_col, loc.end_col, c};
 }
 
-std::pair<unsigned int, std::vector<LineComplexity>>
-compute_cognitive_complexity_gsg(const GSGNode &node, int nesting_level) {
-  unsigned int complexity = 0;
-  std::vector<LineComplexity> lines;
+// What `node` adds on its own line when scored at `nesting`; false if it
+// reports no line (ElseIf reports one even at zero cost).
+static bool own_cost(const GSGNode &node, int nesting, unsigned int &cost) {
+  switch (node.kind) {
+    case GSGNodeKind::For:
+    case GSGNodeKind::While:
+    case GSGNodeKind::DoWhile:
+    case GSGNodeKind::If:
+      cost = 1 + nesting + node.addl_cost;
+      return true;
+    case GSGNodeKind::ElseIf:
+      cost = node.addl_cost;
+      return true;
+    case GSGNodeKind::With:
+    case GSGNodeKind::Except:
+    case GSGNodeKind::Expr:
+    case GSGNodeKind::Ternary:
+      cost = node.addl_cost;
+      return cost != 0;
+    default:
+      return false;
+  }
+}
 
-  auto count_children = [&](int next_nesting) {
-    for (const auto &ch : node.children) {
-      auto [c, l] = compute_cognitive_complexity_gsg(ch, next_nesting);
-      complexity += c;
-      if (!l.empty()) lines.insert(lines.end(), l.begin(), l.end());
-    }
-  };
+// Whether own_cost depends on the nesting level.
+static bool nests(GSGNodeKind kind) {
+  return kind == GSGNodeKind::For || kind == GSGNodeKind::While ||
+         kind == GSGNodeKind::DoWhile || kind == GSGNodeKind::If;
+}
 
-  switch (node.kind) {
-    case GSGNodeKind::Function: {
-      if (node.children.size() == 2 &&
-          node.children[0].kind == GSGNodeKind::Function &&
-          node.children[1].kind == GSGNodeKind::Expr &&
-          node.children[1].addl_cost == 0) {
-        const auto &inner = node.children[0];
-        for (const auto &ich : inner.children) {
-          int next_nest = (ich.kind == GSGNodeKind::Function)
-                              ? nesting_level + 1
-                              : nesting_level;
-          auto [c2, l2] = compute_cognitive_complexity_gsg(ich, next_nest);
-          complexity += c2;
-          if (!l2.empty()) lines.insert(lines.end(), l2.begin(), l2.end());
-        }
-        break;
-      }
-      for (const auto &ch : node.children) {
-        int next_nest = (ch.kind == GSGNodeKind::Function) ? nesting_level + 1
-                                                           : nesting_level;
-        auto [c, l] = compute_cognitive_complexity_gsg(ch, next_nest);
-        complexity += c;
-        if (!l.empty()) lines.insert(lines.end(), l.begin(), l.end());
-      }
-      break;
-    }
+// Level a `child` of a `parent` node scored at `nesting` is scored at.
+// Nested functions add a level; everything else in a function stays at it.
+static int child_nesting(GSGNodeKind parent, int nesting, GSGNodeKind child) {
+  switch (parent) {
+    case GSGNodeKind::Function:
+      return child == GSGNodeKind::Function ? nesting + 1 : nesting;
     case GSGNodeKind::For:
     case GSGNodeKind::While:
-    case GSGNodeKind::DoWhile: {
-      unsigned int stmt = 1 + nesting_level + node.addl_cost;
-      complexity += stmt;
-      lines.push_back(build_line_complexity_from_loc(node.loc, stmt));
-      count_children(nesting_level + 1);
-      break;
-    }
-    case GSGNodeKind::If: {
-      unsigned int stmt = 1 + nesting_level + node.addl_cost;
-      complexity += stmt;
-      lines.push_back(build_line_complexity_from_loc(node.loc, stmt));
-      count_children(nesting_level + 1);
-      break;
-    }
-    case GSGNodeKind::ElseIf: {
-      unsigned int stmt = node.addl_cost;
-      complexity += stmt;
-      lines.push_back(build_line_complexity_from_loc(node.loc, stmt));
-      count_children(nesting_level + 1);
-      break;
-    }
-    case GSGNodeKind::Try:
-    case GSGNodeKind::Switch: {
-      count_children(nesting_level);
-      break;
-    }
+    case GSGNodeKind::DoWhile:
+    case GSGNodeKind::If:
+    case GSGNodeKind::ElseIf:
     case GSGNodeKind::Finally:
     case GSGNodeKind::Case:
-    case GSGNodeKind::Else: {
-      count_children(nesting_level + 1);
-      break;
-    }
+    case GSGNodeKind::Else:
     case GSGNodeKind::With:
     case GSGNodeKind::Except:
     case GSGNodeKind::Expr:
-    case GSGNodeKind::Ternary: {
-      if (node.addl_cost) {
-        complexity += node.addl_cost;
-        lines.push_back(
-            build_line_complexity_from_loc(node.loc, node.addl_cost));
+    case GSGNodeKind::Ternary:
+      return nesting + 1;
+    default:
+      return nesting;
+  }
+}
+
+unsigned int compute_cognitive_complexity_gsg(
+    const GSG &gsg, const GSGNode &node, int nesting_level,
+    std::vector<LineComplexity> &lines) {
+  // Preorder with an explicit stack (graphs can nest far deeper than the
+  // call stack allows); children are pushed last first.
+  struct Item {
+    const GSGNode *node;
+    int nesting;
+  };
+  static thread_local std::vector<Item> stack;
+  const size_t base = stack.size();
+  stack.push_back({&node, nesting_level});
+  unsigned int complexity = 0;
+  while (stack.size() > base) {
+    const Item it = stack.back();
+    stack.pop_back();
+    const GSGNode &n = *it.node;
+    unsigned int cost = 0;
+    if (own_cost(n, it.nesting, cost)) {
+      complexity += cost;
+      lines.push_back(build_line_complexity_from_loc(n.loc, cost));
+    }
+
+    auto children = gsg.children(n);
+    // A function that only wraps an inner one (plus a zero-cost Expr) is
+    // scored as the inner function's body.
+    if (n.kind == GSGNodeKind::Function && children.size() == 2 &&
+        children[0].kind == GSGNodeKind::Function &&
+        children[1].kind == GSGNodeKind::Expr && children[1].addl_cost == 0)
+      children = gsg.children(children[0]);
+
+    for (size_t i = children.size(); i-- > 0;)
+      stack.push_back({&children[i],
+                       child_nesting(n.kind, it.nesting, children[i].kind)});
+  }
+  return complexity;
+}
+
+void StreamScorer::begin(std::vector<FunctionComplexity> &out) {
+  out_ = &out;
+  lines_ = nullptr;
+  frames_.clear();
+  closed_ = false;
+}
+
+int StreamScorer::enter(const GSGNode &n) {
+  int nesting = 0;
+  if (!frames_.empty()) {
+    Frame &parent = frames_.back();
+    nesting = child_nesting(parent.kind, parent.nesting, n.kind);
+    const auto here = static_cast<std::uint32_t>(lines_->size());
+    if (++parent.children == 1) {
+      parent.first_is_function = n.kind == GSGNodeKind::Function;
+      parent.first_begin = parent.first_end = here;
+    } else if (parent.children == 2) {
+      parent.second_is_bare_expr =
+          n.kind == GSGNodeKind::Expr && n.addl_cost == 0;
+    }
+  }
+  unsigned int cost = 0;
+  if (own_cost(n, nesting, cost)) {
+    lines_->push_back(build_line_complexity_from_loc(n.loc, cost));
+    nested_.push_back(nests(n.kind));
+  }
+  return nesting;
+}
+
+void StreamScorer::open(const GSGNode &n) {
+  if (frames_.empty()) {
+    out_->emplace_back();
+    lines_ = &out_->back().lines;
+    nested_.clear();
+  }
+  frames_.push_back(Frame{.kind = n.kind, .nesting = enter(n)});
+}
+
+void StreamScorer::close() {
+  const Frame f = frames_.back();
+  frames_.pop_back();
+  const auto here = static_cast<std::uint32_t>(lines_->size());
+  std::uint32_t wrappers = 0;
+  if (f.kind == GSGNodeKind::Function && f.children == 2 &&
+      f.first_is_function && f.second_is_bare_expr) {
+    // The wrapper case moves the inner function's body up one level, but
+    // a wrapper that is itself flattened by its parent is not checked, so
+    // a run of k nested wrappers (all spanning the same lines) moves it up
+    // ceil(k / 2) levels.
+    wrappers = f.first_wrappers + 1;
+    if (wrappers % 2 == 1)
+      for (auto i = f.first_begin; i < f.first_end; ++i)
+        if (nested_[i]) --(*lines_)[i].complexity;
+  }
+  if (!frames_.empty() && frames_.back().children == 1) {
+    frames_.back().first_end = here;
+    frames_.back().first_wrappers = wrappers;
+  }
+  closed_ = true;
+}
+
+void StreamScorer::push(const GSGNode &n) {
+  if (closed_)
+    closed_ = false;  // already scored while it was open
+  else
+    enter(n);
+}
+
+void StreamScorer::add_function(const GSGNode &fn) {
+  if (closed_)
+    closed_ = false;
+  else
+    out_->emplace_back();  // a stub: no body, nothing to score
+  FunctionComplexity &fc = out_->back();
+  fc.name = std::string(fn.name);
+  fc.row = fn.loc.row;
+  fc.start_col = fn.loc.start_col;
+  fc.end_col = fn.loc.end_col;
+  fc.complexity = 0;
+  for (const auto &line : fc.lines) fc.complexity += line.complexity;
+}
+
+bool IBuilder::unchanged(TSNode fn) const {
+  if (!changed_ranges_) return false;
+  const uint32_t a = ts_node_start_byte(fn), b = ts_node_end_byte(fn);
+  for (const auto &r : *changed_ranges_)
+    if (a <= r.end_byte && r.start_byte <= b) return false;
+  return true;
+}
+
+IBuilder::~IBuilder() {
+  for (auto &c : cursors_) ts_tree_cursor_delete(&c);
+}
+
+void IBuilder::reset_work() {
+  work_.clear();
+  opened_.clear();
+  active_cursors_ = 0;
+  statement_mark_ = 0;
+}
+
+void IBuilder::run_blocks(std::string_view source) {
+  while (!work_.empty()) {
+    const Work w = work_.back();
+    work_.pop_back();
+    switch (w.op) {
+      case Op::Open:
+        opened_.push_back(w.g);
+        open_node(opened_.back());
+        break;
+      case Op::Close: {
+        close_node(opened_.back());
+        const GSGNode n = opened_.back();
+        opened_.pop_back();
+        push_node(n);
+        break;
       }
-      count_children(nesting_level + 1);
-      break;
+      case Op::Push:
+        push_node(w.g);
+        break;
+      case Op::Block: {
+        if (active_cursors_ == cursors_.size())
+          cursors_.push_back(ts_tree_cursor_new(w.node));
+        else
+          ts_tree_cursor_reset(&cursors_[active_cursors_], w.node);
+        TSTreeCursor *c = &cursors_[active_cursors_++];
+        bool any = ts_tree_cursor_goto_first_child(c);
+        while (any && !ts_node_is_named(ts_tree_cursor_current_node(c)))
+          any = ts_tree_cursor_goto_next_sibling(c);
+        if (any)
+          step_block(source, w.nesting);
+        else
+          --active_cursors_;
+        break;
+      }
+      case Op::Next:
+        step_block(source, w.nesting);
+        break;
     }
-    default: {
-      count_children(nesting_level);
-      break;
+  }
+}
+
+void IBuilder::step_block(std::string_view source, int nesting) {
+  TSTreeCursor *c = &cursors_[active_cursors_ - 1];
+  for (;;) {
+    const TSNode stmt = ts_tree_cursor_current_node(c);
+    bool more = ts_tree_cursor_goto_next_sibling(c);
+    while (more && !ts_node_is_named(ts_tree_cursor_current_node(c)))
+      more = ts_tree_cursor_goto_next_sibling(c);
+    // The last statement hands the cursor back before its work runs, so
+    // a chain of blocks each ending in a nested one keeps no cursors.
+    if (!more) --active_cursors_;
+    const size_t mark = work_.size();
+    statement_mark_ = mark;
+    build_statement(stmt, source, nesting);
+    if (work_.size() != mark) {
+      std::reverse(work_.begin() + mark, work_.end());
+      if (more) work_.insert(work_.begin() + mark, {Op::Next, nesting, {}, {}});
+      return;
     }
+    if (!more) return;
   }
+}
+
+const GSG &IBuilder::build(TSNode root, std::string_view source) {
+  reset_work();
+  streaming_ = false;
+  nodes_ = 0;
+  gsg_.clear();
+  build_functions(root, source);
+  gsg_.finish();
+  return gsg_;
+}
 
-  return {complexity, lines};
+void IBuilder::score(TSNode root, std::string_view source,
+                     std::vector<FunctionComplexity> &out) {
+  reset_work();
+  gsg_.clear();
+  scorer_.begin(out);
+  streaming_ = true;
+  nodes_ = 0;
+  build_functions(root, source);
+  streaming_ = false;
+}
+
+GSGNode IBuilder::function_stub(TSNode fn, std::string_view name) {
+  TSPoint p = ts_node_start_point(fn), q = ts_node_end_point(fn);
+  GSGNode g;
+  g.kind = GSGNodeKind::Function;
+  g.name = name;
+  g.loc = SourceLoc{p.row, p.column, q.column};
+  g.start_byte = ts_node_start_byte(fn);
+  g.reused = true;
+  return g;
 }
 
 std::unique_ptr<IBuilder> make_builder(Language lang) {
@@ -119,29 +316,60 @@ std::unique_ptr<IBuilder> make_builder(Language lang) {
   }
 }
 
+FunctionComplexity function_complexity(const GSG &gsg, const GSGNode &fn) {
+  FunctionComplexity fc{.name = std::string(fn.name),
+                        .complexity = 0,
+                        .row = fn.loc.row,
+                        .start_col = fn.loc.start_col,
+                        .end_col = fn.loc.end_col,
+                        .lines = {}};
+  fc.complexity = compute_cognitive_complexity_gsg(gsg, fn, 0, fc.lines);
+  return fc;
+}
+
 std::vector<FunctionComplexity> functions_complexity_file(
-    const std::string &source_code, TSParser *parser, Language lang) {
+    std::string_view source_code, TSParser *parser, Language lang) {
+  auto builder = make_builder(lang);
+  if (!builder) return {};
+  return functions_complexity_file(source_code, parser, *builder);
+}
+
+std::vector<FunctionComplexity> functions_complexity_file(
+    std::string_view source_code, TSParser *parser, IBuilder &builder) {
   std::vector<FunctionComplexity> functions;
 
-  TSTree *tree = ts_parser_parse_string(parser, NULL, source_code.c_str(),
-                                        strlen(source_code.c_str()));
+  TSTree *tree;
+  {
+    profile::Timer t(profile::Phase::Parse);
+    tree = ts_parser_parse_string(parser, NULL, source_code.data(),
+                                  static_cast<uint32_t>(source_code.size()));
+  }
+  if (!tree) {
+    // Without a reset the next parse would resume this one.
+    ts_parser_reset(parser);
+    throw ParseTimeout("parse timed out");
+  }
   TSNode root_node = ts_tree_root_node(tree);
 
-  auto builder = make_builder(lang);
-  if (!builder) {
+  try {
+    if (profile::enabled()) {
+      // Build and score apart so each gets its own time; the results are
+      // the same as the streamed walk's.
+      const GSG *gsg;
+      {
+        profile::Timer t(profile::Phase::Build);
+        gsg = &builder.build(root_node, source_code);
+      }
+      profile::add_nodes(gsg->node_count());
+      profile::Timer t(profile::Phase::Score);
+      for (const auto &fn : gsg->functions())
+        functions.push_back(function_complexity(*gsg, fn));
+    } else {
+      builder.score(root_node, source_code, functions);
+    }
+  } catch (...) {  // e.g. GSGTooLarge
     ts_tree_delete(tree);
-    return functions;
-  }
-
-  auto func_nodes = builder->build_functions(root_node, source_code);
-  for (const auto &fn : func_nodes) {
-    auto [c, lines] = compute_cognitive_complexity_gsg(fn, 0);
-    functions.push_back(FunctionComplexity{.name = fn.name,
-                                           .complexity = c,
-                                           .row = fn.loc.row,
-                                           .start_col = fn.loc.start_col,
-                                           .end_col = fn.loc.end_col,
-                                           .lines = lines});
+    throw;
   }
 
   ts_tree_delete(tree);
@@ -304,6 +304,97 @@ LoadedConfig load_cognity_toml(const std::string &filepath) {
       continue;
     }
 
+    if (ieq(k, "jobs")) {
+      if (auto v = parse_int_value(value)) {
+        cfg.args.jobs = (int)std::max(0LL, *v);
+        cfg.present.jobs = true;
+      }
+      continue;
+    }
+
+    if (ieq(k, "stats")) {
+      if (auto v = parse_bool_value(value)) {
+        cfg.args.stats = *v;
+        cfg.present.stats = true;
+      }
+      continue;
+    }
+
+    if (ieq(k, "cache_dir") || ieq(k, "cache-dir")) {
+      size_t pos = 0;
+      if (auto v = parse_string_value(value, pos)) {
+        cfg.args.cache_dir = *v;
+        cfg.present.cache_dir = true;
+      }
+      continue;
+    }
+
+    if (ieq(k, "cache_max_mb") || ieq(k, "cache-max-mb")) {
+      if (auto v = parse_int_value(value)) {
+        cfg.args.cache_max_mb = (int)std::max(0LL, *v);
+        cfg.present.cache_max_mb = true;
+      }
+      continue;
+    }
+
+    if (ieq(k, "parse_timeout_ms") || ieq(k, "parse-timeout-ms")) {
+      if (auto v = parse_int_value(value)) {
+        cfg.args.parse_timeout_ms = (int)std::max(0LL, *v);
+        cfg.present.parse_timeout_ms = true;
+      }
+      continue;
+    }
+
+    if (ieq(k, "max_file_bytes") || ieq(k, "max-file-bytes")) {
+      if (auto v = parse_int_value(value)) {
+        cfg.args.max_file_bytes = (int)std::max(0LL, *v);
+        cfg.present.max_file_bytes = true;
+      }
+      continue;
+    }
+
+    if (ieq(k, "max_gsg_nodes") || ieq(k, "max-gsg-nodes")) {
+      if (auto v = parse_int_value(value)) {
+        cfg.args.max_gsg_nodes = (int)std::max(0LL, *v);
+        cfg.present.max_gsg_nodes = true;
+      }
+      continue;
+    }
+
+    if (ieq(k, "profile")) {
+      if (auto v = parse_bool_value(value)) {
+        cfg.args.profile = *v;
+        cfg.present.profile = true;
+      }
+      continue;
+    }
+
+    if (ieq(k, "profile_top") || ieq(k, "profile-top")) {
+      if (auto v = parse_int_value(value)) {
+        cfg.args.profile_top = (int)std::max(0LL, *v);
+        cfg.present.profile_top = true;
+      }
+      continue;
+    }
+
+    if (ieq(k, "trace_out") || ieq(k, "trace-out")) {
+      size_t pos = 0;
+      if (auto v = parse_string_value(value, pos)) {
+        cfg.args.trace_out = *v;
+        cfg.present.trace_out = true;
+      }
+      continue;
+    }
+
+    if (ieq(k, "socket")) {
+      size_t pos = 0;
+      if (auto v = parse_string_value(value, pos)) {
+        cfg.args.socket = *v;
+        cfg.present.socket = true;
+      }
+      continue;
+    }
+
     if (ieq(k, "lang") || ieq(k, "languages")) {
       std::vector<string> vals;
       if (!value.empty() && value.front() == '[') {
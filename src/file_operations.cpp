@@ -1,16 +1,103 @@
+#include <stdexcept>
+#include <utility>
+
 #include "../include/file_operations.h"
 
-std::string load_file_content(std::string& path) {
-  std::ifstream file;
-  std::stringstream buffer;
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#define COGNITY_HAVE_MMAP 1
+#else
+#include <fstream>
+#include <iterator>
+#endif
 
-  file.open(path);
-  if (file.fail()) {
-    throw std::runtime_error("Failed to open file: " + path);
+SourceBuffer SourceBuffer::open(const std::string &path, bool map) {
+  SourceBuffer buf;
+#ifdef COGNITY_HAVE_MMAP
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) throw std::runtime_error("Failed to open file: " + path);
+
+  struct stat st;
+  const bool regular = ::fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+  if (map && regular && static_cast<size_t>(st.st_size) >= kMapThreshold) {
+    void *p = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ,
+                     MAP_PRIVATE, fd, 0);
+    if (p != MAP_FAILED) {
+      ::close(fd);
+      buf.data_ = static_cast<const char *>(p);
+      buf.size_ = static_cast<size_t>(st.st_size);
+      buf.mapped_ = true;
+      return buf;
+    }
+    // Fall through to read() if the mapping is refused.
   }
 
-  buffer << file.rdbuf();
-  file.close();
+  if (regular) buf.owned_.reserve(static_cast<size_t>(st.st_size));
+  char chunk[64 * 1024];
+  for (;;) {
+    ssize_t n = ::read(fd, chunk, sizeof chunk);
+    if (n > 0) {
+      buf.owned_.append(chunk, static_cast<size_t>(n));
+    } else if (n == 0) {
+      break;
+    } else if (errno != EINTR) {
+      ::close(fd);
+      throw std::runtime_error("Failed to open file: " + path);
+    }
+  }
+  ::close(fd);
+#else
+  (void)map;
+  std::ifstream file(path, std::ios::binary);
+  if (file.fail()) throw std::runtime_error("Failed to open file: " + path);
+  buf.owned_.assign(std::istreambuf_iterator<char>(file),
+                    std::istreambuf_iterator<char>());
+#endif
+  buf.data_ = buf.owned_.data();
+  buf.size_ = buf.owned_.size();
+  return buf;
+}
+
+std::string SourceBuffer::read_copy(const std::string &path) {
+  return std::move(open(path, false).owned_);
+}
+
+SourceBuffer::SourceBuffer(SourceBuffer &&other) noexcept {
+  *this = std::move(other);
+}
+
+SourceBuffer &SourceBuffer::operator=(SourceBuffer &&other) noexcept {
+  if (this == &other) return *this;
+  release();
+  mapped_ = other.mapped_;
+  size_ = other.size_;
+  if (mapped_) {
+    data_ = other.data_;
+  } else {
+    // Moving a std::string may relocate a small (SSO) buffer.
+    owned_ = std::move(other.owned_);
+    data_ = owned_.data();
+  }
+  other.data_ = "";
+  other.size_ = 0;
+  other.mapped_ = false;
+  other.owned_.clear();
+  return *this;
+}
+
+SourceBuffer::~SourceBuffer() { release(); }
 
-  return buffer.str();
+void SourceBuffer::release() {
+#ifdef COGNITY_HAVE_MMAP
+  if (mapped_) ::munmap(const_cast<char *>(data_), size_);
+#endif
+  data_ = "";
+  size_ = 0;
+  mapped_ = false;
+  owned_.clear();
 }
@@ -1,17 +1,15 @@
 #include <algorithm>
+#include <array>
 #include <cctype>
+#include <cstdint>
 #include <fstream>
-#include <sstream>
+#include <functional>
+#include <unordered_map>
 
 #include "../include/gitignore.h"
 
 namespace {
 
-static std::string to_slash_path(const std::filesystem::path &p) {
-  std::string s = p.generic_string();
-  return s;
-}
-
 static std::string trim(const std::string &s) {
   size_t i = 0, j = s.size();
   while (i < j && std::isspace(static_cast<unsigned char>(s[i]))) ++i;
@@ -19,108 +17,271 @@ static std::string trim(const std::string &s) {
   return s.substr(i, j - i);
 }
 
-static bool glob_match(const std::string &pattern, const std::string &text) {
-  size_t pi = 0, ti = 0;
-  size_t star_pi = std::string::npos;
-  size_t star_ti = std::string::npos;
-  bool star_allows_slash = false;
-
-  auto is_double_star = [&](size_t pos) -> bool {
-    return pos + 1 < pattern.size() && pattern[pos] == '*' &&
-           pattern[pos + 1] == '*';
-  };
+// A pattern is a sequence of tokens: a literal character (escaped with '\'
+// or not), '?' (any character but '/'), '*' (any run without '/') or '**'
+// (any run, '/' included).
+enum class Tok : unsigned char { Lit, Any, Star, DStar, End };
 
-  while (ti < text.size()) {
-    if (pi < pattern.size()) {
-      char pc = pattern[pi];
-      if (pc == '*') {
-        bool dbl = is_double_star(pi);
-        if (dbl) {
-          while (pi < pattern.size() && pattern[pi] == '*') ++pi;
-          star_pi = pi;
-          star_ti = ti;
-          star_allows_slash = true;
-          continue;
-        } else {
-          ++pi;
-          star_pi = pi;
-          star_ti = ti;
-          star_allows_slash = false;
-          continue;
-        }
-      } else if (pc == '?') {
-        if (text[ti] == '/') {
-          if (star_pi != std::string::npos) {
-            if (star_allows_slash || text[star_ti] != '/') {
-              ++star_ti;
-              ti = star_ti;
-              pi = star_pi;
-              continue;
-            }
-          }
-          return false;
-        }
-        ++pi;
-        ++ti;
-        continue;
-      } else if (pc == '\\') {
-        ++pi;
-        if (pi >= pattern.size()) return false;
-        if (pattern[pi] == text[ti]) {
-          ++pi;
-          ++ti;
-          continue;
-        }
-      } else if (pc == text[ti]) {
-        ++pi;
-        ++ti;
-        continue;
-      }
-    }
+struct Token {
+  Tok kind;
+  char c;  // for Lit
+};
 
-    if (star_pi != std::string::npos) {
-      if (star_allows_slash || text[star_ti] != '/') {
-        ++star_ti;
-        ti = star_ti;
-        pi = star_pi;
-        continue;
-      }
+// False for a pattern ending in a lone '\', which matches nothing.
+static bool tokenize(const std::string &pattern, std::vector<Token> &out) {
+  for (size_t i = 0; i < pattern.size(); ++i) {
+    const char c = pattern[i];
+    if (c == '\\') {
+      if (++i == pattern.size()) return false;
+      out.push_back({Tok::Lit, pattern[i]});
+    } else if (c == '*') {
+      const bool dbl = i + 1 < pattern.size() && pattern[i + 1] == '*';
+      while (i + 1 < pattern.size() && pattern[i + 1] == '*') ++i;
+      out.push_back({dbl ? Tok::DStar : Tok::Star, 0});
+    } else if (c == '?') {
+      out.push_back({Tok::Any, 0});
+    } else {
+      out.push_back({Tok::Lit, c});
     }
-    return false;
   }
+  return true;
+}
 
-  while (pi < pattern.size() && pattern[pi] == '*') {
-    ++pi;
-    while (pi < pattern.size() && pattern[pi] == '*') ++pi;
+// Whether tokens [b, e) are all literal; their characters go to `lit`.
+static bool literal(const std::vector<Token> &t, size_t b, size_t e,
+                    std::string &lit) {
+  for (size_t i = b; i < e; ++i) {
+    if (t[i].kind != Tok::Lit) return false;
+    lit += t[i].c;
   }
-  return pi == pattern.size();
+  return true;
 }
 
-static bool match_against(const ignore::Rule &r,
-                          const std::filesystem::path &base,
-                          const std::filesystem::path &abs_path, bool is_dir) {
-  if (r.dir_only && !is_dir) return false;
+struct StringHash {
+  using is_transparent = void;
+  size_t operator()(std::string_view s) const {
+    return std::hash<std::string_view>{}(s);
+  }
+};
 
-  std::error_code ec;
-  auto rel = std::filesystem::relative(abs_path, base, ec);
-  if (ec) return false;
-  if (rel.empty()) return false;
+// Rule indices (ascending) by literal string.
+using LiteralMap = std::unordered_map<std::string, std::vector<std::uint32_t>,
+                                      StringHash, std::equal_to<>>;
 
-  std::string rel_str = to_slash_path(rel);
-  if (rel_str.rfind("./", 0) == 0) rel_str = rel_str.substr(2);
+// Literal patterns over one kind of text: equal to, starting with, or
+// ending with a string.
+struct Literals {
+  LiteralMap exact, prefix, suffix;
+  std::vector<size_t> prefix_lengths, suffix_lengths;  // distinct
 
-  if (!r.has_slash) {
-    std::string name = abs_path.filename().generic_string();
-    return glob_match(r.pattern, name);
+  static void add(LiteralMap &map, std::vector<size_t> *lengths,
+                  std::string lit, std::uint32_t rule) {
+    if (lengths && std::find(lengths->begin(), lengths->end(), lit.size()) ==
+                       lengths->end())
+      lengths->push_back(lit.size());
+    map[std::move(lit)].push_back(rule);
   }
 
-  return glob_match(r.pattern, rel_str);
-}
+  // Calls `hit` with the rules matching `text` (several lookups, one per
+  // distinct prefix / suffix length).
+  template <class F>
+  void match(std::string_view text, F &&hit) const {
+    auto find = [&](const LiteralMap &map, std::string_view key) {
+      if (auto it = map.find(key); it != map.end()) hit(it->second);
+    };
+    if (!exact.empty()) find(exact, text);
+    for (size_t n : prefix_lengths)
+      if (n <= text.size()) find(prefix, text.substr(0, n));
+    for (size_t n : suffix_lengths)
+      if (n <= text.size()) find(suffix, text.substr(text.size() - n));
+  }
+};
+
+// Glob patterns run as one automaton over the text. A state is "pattern p
+// has matched its first i tokens"; the active states advance together, one
+// character at a time, so each character is looked at once however many
+// globs there are. A pattern only starts where its first token can match
+// (indexed by that character unless it is a wildcard), so the states alive
+// at any point are the few patterns still agreeing with the text. Patterns
+// of the form "**/rest" start `rest` after every '/' instead of keeping a
+// '**' state alive along the whole path.
+class GlobSet {
+ public:
+  bool empty() const { return rules_.empty(); }
+
+  void add(const std::vector<Token> &tokens, std::uint32_t rule) {
+    const bool floating = tokens.size() > 2 && tokens[0].kind == Tok::DStar &&
+                          tokens[1].kind == Tok::Lit && tokens[1].c == '/';
+    const auto start = static_cast<std::uint32_t>(tokens_.size());
+    tokens_.insert(tokens_.end(), tokens.begin() + (floating ? 2 : 0),
+                   tokens.end());
+    tokens_.push_back({Tok::End, 0});
+    ends_.push_back(static_cast<std::uint32_t>(tokens_.size() - 1));
+    rules_.push_back(rule);
+    const Token &first = tokens_[start];
+    Starts &starts = floating ? after_slash_ : at_start_;
+    if (first.kind == Tok::Lit)
+      starts.by_char[static_cast<unsigned char>(first.c)].push_back(start);
+    else
+      starts.wild.push_back(start);
+  }
+
+  // Calls `hit` with each rule whose glob matches all of `text`.
+  template <class F>
+  void match(std::string_view text, F &&hit) const {
+    Scratch &s = scratch();
+    if (s.mark.size() < tokens_.size()) s.mark.resize(tokens_.size(), 0);
+    next_generation(s);
+    s.cur.clear();
+    for (size_t i = 0; i < text.size(); ++i) {
+      const auto c = static_cast<unsigned char>(text[i]);
+      const Starts *starts = i == 0                ? &at_start_
+                             : text[i - 1] == '/' ? &after_slash_
+                                                  : nullptr;
+      if (starts) {
+        for (std::uint32_t p : starts->by_char[c]) activate(s, s.cur, p);
+        for (std::uint32_t p : starts->wild) activate(s, s.cur, p);
+      }
+      next_generation(s);
+      s.next.clear();
+      for (std::uint32_t p : s.cur) {
+        const Token &t = tokens_[p];
+        switch (t.kind) {
+          case Tok::Lit:
+            if (t.c == text[i]) activate(s, s.next, p + 1);
+            break;
+          case Tok::Any:
+            if (c != '/') activate(s, s.next, p + 1);
+            break;
+          case Tok::Star:
+            if (c != '/') activate(s, s.next, p);
+            break;
+          case Tok::DStar:
+            activate(s, s.next, p);
+            break;
+          case Tok::End:
+            break;
+        }
+      }
+      s.cur.swap(s.next);
+    }
+    for (std::uint32_t p : s.cur)
+      if (tokens_[p].kind == Tok::End) hit(rule_of(p));
+  }
+
+ private:
+  struct Starts {
+    std::array<std::vector<std::uint32_t>, 256> by_char;  // first token Lit
+    std::vector<std::uint32_t> wild;                      // any other
+  };
+
+  // Per-thread state sets, reused across calls. `mark[p] == generation`
+  // when p is already in the set being built.
+  struct Scratch {
+    std::vector<std::uint32_t> cur, next, mark;
+    std::uint32_t generation = 1;
+  };
+  static Scratch &scratch() {
+    thread_local Scratch s;
+    return s;
+  }
+  static void next_generation(Scratch &s) {
+    if (++s.generation == 0) {
+      std::fill(s.mark.begin(), s.mark.end(), 0);
+      s.generation = 1;
+    }
+  }
+
+  // Add state p to `set`, and the states after it for stars (which also
+  // match nothing).
+  void activate(Scratch &s, std::vector<std::uint32_t> &set,
+                std::uint32_t p) const {
+    while (s.mark[p] != s.generation) {
+      s.mark[p] = s.generation;
+      set.push_back(p);
+      const Tok k = tokens_[p].kind;
+      if (k != Tok::Star && k != Tok::DStar) return;
+      ++p;
+    }
+  }
+
+  std::uint32_t rule_of(std::uint32_t end) const {
+    // End states are in pattern order, so their rank is the pattern's.
+    return rules_[static_cast<size_t>(
+        std::lower_bound(ends_.begin(), ends_.end(), end) - ends_.begin())];
+  }
+
+  std::vector<Token> tokens_;  // every pattern, each followed by End
+  std::vector<std::uint32_t> rules_;
+  std::vector<std::uint32_t> ends_;
+  Starts at_start_, after_slash_;
+};
 
 }  // namespace
 
 namespace ignore {
 
+class Matcher {
+ public:
+  explicit Matcher(const std::vector<Rule> &rules) {
+    std::vector<Token> t;
+    for (std::uint32_t i = 0; i < rules.size(); ++i) {
+      const Rule &r = rules[i];
+      dir_only_.push_back(r.dir_only);
+      t.clear();
+      if (!tokenize(r.pattern, t)) continue;
+      // Rules without a '/' match the entry's name, the others its path
+      // relative to the .gitignore.
+      Literals &lits = r.has_slash ? path_lits_ : name_lits_;
+      GlobSet &globs = r.has_slash ? path_globs_ : name_globs_;
+      const bool starts_star = t.front().kind == Tok::DStar ||
+                               (!r.has_slash && t.front().kind == Tok::Star);
+      const bool ends_star = t.back().kind == Tok::DStar ||
+                             (!r.has_slash && t.back().kind == Tok::Star);
+      std::string lit;
+      auto literal_in = [&](size_t b, size_t e) {
+        lit.clear();
+        return literal(t, b, e, lit);
+      };
+      if (literal_in(0, t.size()))
+        Literals::add(lits.exact, nullptr, std::move(lit), i);
+      else if (starts_star && literal_in(1, t.size()))
+        Literals::add(lits.suffix, &lits.suffix_lengths, std::move(lit), i);
+      else if (ends_star && literal_in(0, t.size() - 1))
+        Literals::add(lits.prefix, &lits.prefix_lengths, std::move(lit), i);
+      else
+        globs.add(t, i);
+    }
+  }
+
+  // Index + 1 of the last rule matching the entry `rel` (relative to the
+  // rules' directory) named `name`, or 0 if none does.
+  size_t last_match(std::string_view rel, std::string_view name,
+                    bool is_dir) const {
+    size_t best = 0;
+    auto hit = [&](std::uint32_t rule) {
+      if (rule + 1 > best && (is_dir || !dir_only_[rule])) best = rule + 1;
+    };
+    auto hits = [&](const std::vector<std::uint32_t> &rules) {
+      for (auto it = rules.rbegin(); it != rules.rend(); ++it)
+        if (is_dir || !dir_only_[*it]) {
+          hit(*it);
+          break;
+        }
+    };
+    name_lits_.match(name, hits);
+    path_lits_.match(rel, hits);
+    if (!name_globs_.empty()) name_globs_.match(name, hit);
+    if (!path_globs_.empty()) path_globs_.match(rel, hit);
+    return best;
+  }
+
+ private:
+  std::vector<bool> dir_only_;
+  Literals name_lits_, path_lits_;
+  GlobSet name_globs_, path_globs_;
+};
+
 static bool parse_rule_line(const std::string &raw, Rule &out) {
   std::string s = trim(raw);
   if (s.empty()) return false;
@@ -161,20 +322,43 @@ RulesFile load_rules_for_dir(const std::filesystem::path &dir) {
       rf.rules.push_back(std::move(r));
     }
   }
+  if (!rf.rules.empty()) rf.matcher = std::make_shared<Matcher>(rf.rules);
   return rf;
 }
 
-bool is_ignored(const std::vector<RulesFile> &stack,
-                const std::filesystem::path &abs_path, bool is_dir) {
-  bool ignored = false;
-  for (const auto &rf : stack) {
-    for (const auto &r : rf.rules) {
-      if (match_against(r, rf.base, abs_path, is_dir)) {
-        ignored = !r.negated;
-      }
-    }
-  }
-  return ignored;
+RulesStack push(RulesStack stack, RulesFile rules) {
+  return std::make_shared<const RulesLink>(
+      RulesLink{std::move(rules), std::move(stack)});
+}
+
+static std::string_view base_name(std::string_view rel) {
+  const size_t slash = rel.rfind('/');
+  return slash == std::string_view::npos ? rel : rel.substr(slash + 1);
+}
+
+// 1 if `rf` ignores `rel`, 0 if it re-includes it, -1 if no rule matches.
+static int match(const RulesFile &rf, std::string_view rel,
+                 std::string_view name, bool is_dir) {
+  if (!rf.matcher || rf.prefix >= rel.size()) return -1;
+  if (size_t m = rf.matcher->last_match(rel.substr(rf.prefix), name, is_dir))
+    return rf.rules[m - 1].negated ? 0 : 1;
+  return -1;
+}
+
+// The last matching rule decides, so both search the deepest file first.
+bool is_ignored(const std::vector<RulesFile> &stack, std::string_view rel,
+                bool is_dir) {
+  const std::string_view name = base_name(rel);
+  for (auto it = stack.rbegin(); it != stack.rend(); ++it)
+    if (int m = match(*it, rel, name, is_dir); m >= 0) return m;
+  return false;
+}
+
+bool is_ignored(const RulesStack &stack, std::string_view rel, bool is_dir) {
+  const std::string_view name = base_name(rel);
+  for (const RulesLink *l = stack.get(); l; l = l->parent.get())
+    if (int m = match(l->rules, rel, name, is_dir); m >= 0) return m;
+  return false;
 }
 
 }  // namespace ignore
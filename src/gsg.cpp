@@ -0,0 +1,51 @@
+#include <algorithm>
+#include <cstring>
+
+#include "../include/gsg.h"
+
+void GSG::clear() {
+  nodes_.clear();
+  pending_.clear();
+  functions_begin_ = 0;
+  functions_count_ = 0;
+  chunk_ = 0;
+  used_ = 0;
+}
+
+void GSG::close(GSGNode &parent) {
+  const size_t mark = parent.first_child;
+  parent.first_child = static_cast<std::uint32_t>(nodes_.size());
+  parent.child_count = static_cast<std::uint32_t>(pending_.size() - mark);
+  nodes_.insert(nodes_.end(), pending_.begin() + mark, pending_.end());
+  pending_.resize(mark);
+}
+
+void GSG::finish() {
+  functions_begin_ = static_cast<std::uint32_t>(nodes_.size());
+  functions_count_ = static_cast<std::uint32_t>(pending_.size());
+  nodes_.insert(nodes_.end(), pending_.begin(), pending_.end());
+  pending_.clear();
+}
+
+std::string_view GSG::intern(std::initializer_list<std::string_view> parts) {
+  size_t size = 0;
+  for (auto part : parts) size += part.size();
+  if (size == 0) return {};
+  while (chunk_ < chunks_.size() && used_ + size > chunks_[chunk_].size) {
+    ++chunk_;
+    used_ = 0;
+  }
+  if (chunk_ == chunks_.size()) {
+    const size_t chunk_size = std::max(kChunkSize, size);
+    chunks_.push_back(Chunk{std::make_unique<char[]>(chunk_size), chunk_size});
+  }
+  char *begin = chunks_[chunk_].data.get() + used_;
+  char *dst = begin;
+  for (auto part : parts) {
+    if (part.empty()) continue;
+    std::memcpy(dst, part.data(), part.size());
+    dst += part.size();
+  }
+  used_ += size;
+  return {begin, size};
+}
@@ -0,0 +1,172 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+
+#include "../include/incremental.h"
+
+namespace incremental {
+
+namespace {
+
+// Position reached after `text`, starting at `from`.
+TSPoint advance(TSPoint from, std::string_view text) {
+  size_t nl = text.rfind('\n');
+  if (nl == std::string_view::npos)
+    return TSPoint{from.row, from.column + static_cast<uint32_t>(text.size())};
+  auto rows = static_cast<uint32_t>(std::count(text.begin(), text.end(), '\n'));
+  return TSPoint{from.row + rows, static_cast<uint32_t>(text.size() - nl - 1)};
+}
+
+// Single edit turning `old_src` into `new_src`: everything between their
+// common prefix and common suffix.
+TSInputEdit diff_edit(std::string_view old_src, std::string_view new_src) {
+  size_t limit = std::min(old_src.size(), new_src.size());
+  size_t prefix = 0;
+  while (prefix < limit && old_src[prefix] == new_src[prefix]) ++prefix;
+  size_t suffix = 0;
+  while (suffix < limit - prefix &&
+         old_src[old_src.size() - 1 - suffix] ==
+             new_src[new_src.size() - 1 - suffix])
+    ++suffix;
+
+  TSInputEdit e;
+  e.start_byte = static_cast<uint32_t>(prefix);
+  e.old_end_byte = static_cast<uint32_t>(old_src.size() - suffix);
+  e.new_end_byte = static_cast<uint32_t>(new_src.size() - suffix);
+  e.start_point = advance(TSPoint{0, 0}, new_src.substr(0, prefix));
+  e.old_end_point = advance(
+      e.start_point, old_src.substr(prefix, e.old_end_byte - e.start_byte));
+  e.new_end_point = advance(
+      e.start_point, new_src.substr(prefix, e.new_end_byte - e.start_byte));
+  return e;
+}
+
+}  // namespace
+
+IncrementalFile::~IncrementalFile() {
+  if (tree_) ts_tree_delete(tree_);
+}
+
+void IncrementalFile::rebuild_all(TSNode root, IBuilder &builder) {
+  builder.set_changed_ranges(nullptr);
+  const GSG &gsg = builder.build(root, source_);
+  functions_.clear();
+  known_.clear();
+  for (const auto &fn : gsg.functions()) {
+    functions_.push_back(function_complexity(gsg, fn));
+    known_.push_back(
+        Known{std::string(fn.name), fn.start_byte, fn.loc.start_col});
+  }
+  rebuilt_ = gsg.functions().size();
+  reused_ = 0;
+}
+
+void IncrementalFile::abandon(TSParser *parser) {
+  // Without a reset the next parse would resume this one.
+  ts_parser_reset(parser);
+  if (tree_) ts_tree_delete(tree_);
+  tree_ = nullptr;
+  source_.clear();
+  known_.clear();
+  functions_.clear();
+  rebuilt_ = reused_ = 0;
+  throw ParseTimeout("parse timed out");
+}
+
+const std::vector<FunctionComplexity> &IncrementalFile::update(
+    std::string source, TSParser *parser, IBuilder &builder) {
+  if (!tree_) {
+    source_ = std::move(source);
+    tree_ = ts_parser_parse_string(parser, nullptr, source_.data(),
+                                   static_cast<uint32_t>(source_.size()));
+    if (!tree_) abandon(parser);
+    rebuild_all(ts_tree_root_node(tree_), builder);
+    return functions_;
+  }
+
+  const TSInputEdit edit = diff_edit(source_, source);
+  if (edit.start_byte == edit.old_end_byte &&
+      edit.start_byte == edit.new_end_byte) {
+    rebuilt_ = 0;
+    reused_ = functions_.size();
+    return functions_;
+  }
+
+  ts_tree_edit(tree_, &edit);
+  source_ = std::move(source);
+  TSTree *tree = ts_parser_parse_string(parser, tree_, source_.data(),
+                                        static_cast<uint32_t>(source_.size()));
+  if (!tree) abandon(parser);
+
+  // Changed ranges only cover structural differences, so a same-shape edit
+  // (e.g. renaming a variable) must be added explicitly.
+  uint32_t count = 0;
+  TSRange *changed = ts_tree_get_changed_ranges(tree_, tree, &count);
+  std::vector<TSRange> ranges(changed, changed + count);
+  std::free(changed);
+  ranges.push_back(TSRange{edit.start_point, edit.new_end_point,
+                           edit.start_byte, edit.new_end_byte});
+  ts_tree_delete(tree_);
+  tree_ = tree;
+  TSNode root = ts_tree_root_node(tree_);
+
+  // Previous results by their start byte in the old source.
+  std::unordered_map<uint32_t, size_t> by_start;
+  for (size_t i = 0; i < known_.size(); ++i)
+    by_start.emplace(known_[i].start_byte, i);
+
+  builder.set_changed_ranges(&ranges);
+  const GSG &gsg = builder.build(root, source_);
+  builder.set_changed_ranges(nullptr);
+  const auto nodes = gsg.functions();
+
+  const int64_t byte_delta = static_cast<int64_t>(edit.new_end_byte) -
+                             static_cast<int64_t>(edit.old_end_byte);
+  const int64_t row_delta = static_cast<int64_t>(edit.new_end_point.row) -
+                            static_cast<int64_t>(edit.old_end_point.row);
+
+  std::vector<FunctionComplexity> functions;
+  std::vector<Known> known;
+  functions.reserve(nodes.size());
+  known.reserve(nodes.size());
+  size_t rebuilt = 0, reused = 0;
+  for (const auto &fn : nodes) {
+    if (!fn.reused) {
+      functions.push_back(function_complexity(gsg, fn));
+      ++rebuilt;
+    } else {
+      // A stub lies entirely before the edit or entirely after it.
+      const bool after = fn.start_byte >= edit.new_end_byte;
+      const uint32_t old_start =
+          after ? static_cast<uint32_t>(fn.start_byte - byte_delta)
+                : fn.start_byte;
+      auto it = by_start.find(old_start);
+      if (it == by_start.end() || known_[it->second].name != fn.name ||
+          known_[it->second].start_col != fn.loc.start_col) {
+        // Cannot match the stub to a previous result; fall back.
+        rebuild_all(root, builder);
+        return functions_;
+      }
+      FunctionComplexity fc = functions_[it->second];
+      if (after && row_delta != 0) {
+        fc.row = static_cast<unsigned int>(fc.row + row_delta);
+        for (auto &line : fc.lines)
+          line.row = static_cast<unsigned int>(line.row + row_delta);
+      }
+      functions.push_back(std::move(fc));
+      ++reused;
+    }
+    known.push_back(
+        Known{std::string(fn.name), fn.start_byte, fn.loc.start_col});
+  }
+
+  functions_ = std::move(functions);
+  known_ = std::move(known);
+  rebuilt_ = rebuilt;
+  reused_ = reused;
+  return functions_;
+}
+
+}  // namespace incremental
@@ -1,19 +1,33 @@
+#include <algorithm>
+#include <chrono>
+#include <memory>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "../include/analysis.h"
 #include "../include/cli_arguments.h"
 #include "../include/cli_helpers.h"
 #include "../include/cognitive_complexity.h"
 #include "../include/config.h"
-#include "../include/file_operations.h"
 #include "../include/output.h"
+#include "../include/profile.h"
+#include "../include/result_cache.h"
+#include "../include/serve.h"
 #include "../include/sourcing.h"
+#include "../include/watch.h"
 
 int main(int argc, char **argv) {
   LoadedConfig file_cfg = load_cognity_toml("cognity.toml");
 
   std::vector<std::string> args = args_to_string(argv, argc);
+  // `cognity serve ...` / `cognity query ...` take the usual options.
+  std::string command;
+  if (!args.empty() && (args[0] == "serve" || args[0] == "query")) {
+    command = args[0];
+    args.erase(args.begin());
+  }
   CLI_PARSE_RESULT parsed;
   try {
     parsed = parse_arguments_relaxed(args);
@@ -35,81 +49,80 @@ int main(int argc, char **argv) {
   // Merge config + CLI (CLI overrides)
   CLI_ARGUMENTS cli_args = cli_helpers::merge_cli_and_config(file_cfg, parsed);
 
+  // No paths asks the server for everything it tracks.
+  if (command == "query") return serve::query(cli_args);
+
   if (cli_args.paths.empty()) {
     cli_helpers::print_error(
         "expected at least one path (via CLI or cognity.toml)");
     return 1;
   }
 
-  TSParser *parser = ts_parser_new();
-  std::string source_code;
+  if (command == "serve") return serve::run(cli_args);
 
-  std::vector<std::string> files;
-  collect_source_files(cli_args.paths, cli_args.languages, cli_args.excludes,
-                       files);
+  const auto start = std::chrono::steady_clock::now();
+  if (cli_args.profile || !cli_args.trace_out.empty())
+    profile::enable(!cli_args.trace_out.empty());
+
+  std::vector<SourceFile> files;
+  std::vector<report::Row> all_rows;
+  std::vector<report::Skipped> skipped;
+  analysis::RunStats stats;
+  try {
+    std::unique_ptr<cache::ResultCache> result_cache;
+    if (!cli_args.cache_dir.empty())
+      result_cache = std::make_unique<cache::ResultCache>(
+          cli_args.cache_dir,
+          static_cast<std::uintmax_t>(cli_args.cache_max_mb) * 1024 * 1024);
+
+    analysis::Options opts;
+    opts.sort = cli_args.sort;
+    opts.jobs = analysis::resolve_jobs(cli_args.jobs);
+    opts.cache = result_cache.get();
+    opts.max_file_bytes = static_cast<std::uintmax_t>(cli_args.max_file_bytes);
+    opts.parse_timeout_ms =
+        static_cast<std::uint64_t>(cli_args.parse_timeout_ms);
+    opts.max_gsg_nodes = static_cast<size_t>(cli_args.max_gsg_nodes);
+    opts.on_skip = [&](const std::string &path, const std::string &reason) {
+      skipped.push_back(report::Skipped{path, reason});
+    };
+    all_rows = analysis::analyze_sources(cli_args.paths, cli_args.languages,
+                                         cli_args.excludes, opts, files,
+                                         cli_args.stats ? &stats : nullptr);
+  } catch (const std::runtime_error &e) {
+    cli_helpers::print_error(e.what());
+    return 1;
+  }
   if (files.empty()) {
     cli_helpers::print_error("No matching source files found");
-    ts_parser_delete(parser);
     return 1;
   }
-
-  std::vector<report::Row> all_rows;
-
-  for (std::string &path : files) {
-    Language lang = detect_language_from_path(path);
-    set_ts_language_for_file(parser, lang, path);
-    if (lang == Language::Unknown) continue;
+  if (cli_args.stats) analysis::print_stats(stats, files, std::cerr);
+  std::sort(skipped.begin(), skipped.end(),
+            [](const report::Skipped &a, const report::Skipped &b) {
+              return a.file < b.file;
+            });
+
+  const int code = cli_helpers::print_report(all_rows, cli_args, skipped);
+  if (cli_args.profile) {
+    const double wall = std::chrono::duration<double>(
+                            std::chrono::steady_clock::now() - start)
+                            .count();
+    const auto top = static_cast<size_t>(cli_args.profile_top);
+    if (cli_args.output_json)
+      profile::print_summary_json(std::cerr, wall, top);
+    else
+      profile::print_summary(std::cerr, wall, top);
+  }
+  if (!cli_args.trace_out.empty()) {
     try {
-      source_code = load_file_content(path);
+      profile::write_trace(cli_args.trace_out);
     } catch (const std::runtime_error &e) {
       cli_helpers::print_error(e.what());
       return 1;
     }
-
-    std::vector<FunctionComplexity> functions_complexity =
-        functions_complexity_file(source_code, parser, lang);
-    report::sort_functions(functions_complexity, cli_args.sort);
-
-    for (const auto &fn : functions_complexity) {
-      all_rows.push_back(report::Row{path, fn});
-    }
   }
-
-  bool any_exceeds = report::any_exceeds(
-      all_rows, cli_args.max_complexity_allowed, cli_args.ignore_complexity);
-
-  auto rows_cmp_name = [](const report::Row &a, const report::Row &b) {
-    if (a.file != b.file) return a.file < b.file;
-    if (a.fn.name != b.fn.name) return a.fn.name < b.fn.name;
-    return a.fn.row < b.fn.row;
-  };
-
-  // Quiet mode suppresses all normal output (table/JSON/CSV). Exit code only.
-  if (cli_args.quiet) {
-    ts_parser_delete(parser);
-    return any_exceeds ? 2 : 0;
-  }
-
-  if (cli_args.output_json) {
-    report::print_json(all_rows, cli_args.sort, cli_args.max_complexity_allowed,
-                       cli_args.ignore_complexity, cli_args.detail);
-    ts_parser_delete(parser);
-    return any_exceeds ? 2 : 0;
-  }
-
-  if (cli_args.output_csv) {
-    report::print_csv(all_rows, cli_args.sort, cli_args.max_complexity_allowed,
-                      cli_args.ignore_complexity, cli_args.detail);
-    ts_parser_delete(parser);
-    return any_exceeds ? 2 : 0;
-  }
-
-  report::print_table(all_rows, cli_args.sort, cli_args.max_function_width,
-                      cli_args.max_complexity_allowed,
-                      cli_args.ignore_complexity, cli_args.quiet,
-                      cli_args.detail);
-
-  ts_parser_delete(parser);
-
-  return any_exceeds ? 2 : 0;
+  if (cli_args.watch)
+    watch::run(cli_args, std::move(files), std::move(all_rows), skipped);
+  return code;
 }
@@ -20,6 +20,7 @@
 #include <iomanip>
 
 #include "../include/output.h"
+#include "../include/profile.h"
 
 namespace term {
 
@@ -112,6 +113,7 @@ bool any_exceeds(const std::vector<Row> &rows, int max_complexity_allowed,
 }
 
 static inline void sort_rows(std::vector<Row> &rows, SortType sort) {
+  profile::Timer timer(profile::Phase::Sort);
   auto rows_cmp_name = [](const Row &a, const Row &b) {
     if (a.file != b.file) return a.file < b.file;
     if (a.fn.name != b.fn.name) return a.fn.name < b.fn.name;
@@ -147,6 +149,7 @@ static inline void sort_rows(std::vector<Row> &rows, SortType sort) {
 }
 
 void sort_functions(std::vector<FunctionComplexity> &functions, SortType sort) {
+  profile::Timer timer(profile::Phase::Sort);
   auto cmp_name = [](const FunctionComplexity &a, const FunctionComplexity &b) {
     if (a.name != b.name) return a.name < b.name;
     if (a.row != b.row) return a.row < b.row;
@@ -177,7 +180,8 @@ void sort_functions(std::vector<FunctionComplexity> &functions, SortType sort) {
 
 void print_json(std::vector<Row> rows, SortType sort,
                 int max_complexity_allowed, bool ignore_complexity,
-                DetailType detail) {
+                DetailType detail, const std::vector<Skipped> &skipped) {
+  profile::Timer timer(profile::Phase::Print);
   if (detail == LOW && !ignore_complexity) {
     rows.erase(std::remove_if(rows.begin(), rows.end(),
                               [&](const Row &r) {
@@ -197,12 +201,19 @@ void print_json(std::vector<Row> rows, SortType sort,
               << "\"complexity\": " << r.fn.complexity << ", "
               << "\"line\": " << r.fn.row + 1 << " }";
   }
-  if (!rows.empty()) std::cout << "\n";
+  for (size_t i = 0; i < skipped.size(); ++i) {
+    std::cout << (i || !rows.empty() ? ",\n" : "\n");
+    std::cout << "  {\"file\": \"" << skipped[i].file << "\", "
+              << "\"not_analysed\": \"" << skipped[i].reason << "\" }";
+  }
+  if (!rows.empty() || !skipped.empty()) std::cout << "\n";
   std::cout << "]" << '\n';
 }
 
 void print_csv(std::vector<Row> rows, SortType sort, int max_complexity_allowed,
-               bool ignore_complexity, DetailType detail) {
+               bool ignore_complexity, DetailType detail,
+               const std::vector<Skipped> &skipped) {
+  profile::Timer timer(profile::Phase::Print);
   if (detail == LOW && !ignore_complexity) {
     rows.erase(std::remove_if(rows.begin(), rows.end(),
                               [&](const Row &r) {
@@ -217,11 +228,14 @@ void print_csv(std::vector<Row> rows, SortType sort, int max_complexity_allowed,
     std::cout << r.file << "," << r.fn.name << "@" << r.fn.row + 1 << ","
               << r.fn.complexity << "," << r.fn.row + 1 << '\n';
   }
+  for (const auto &s : skipped)
+    std::cout << s.file << ",not analysed: " << s.reason << ",," << '\n';
 }
 
 void print_table(std::vector<Row> rows, SortType sort, int max_fn_width,
                  int max_complexity_allowed, bool ignore_complexity, bool quiet,
-                 DetailType detail) {
+                 DetailType detail, const std::vector<Skipped> &skipped) {
+  profile::Timer timer(profile::Phase::Print);
   // Quiet mode: suppress all output entirely
   if (quiet) return;
 
@@ -255,6 +269,8 @@ void print_table(std::vector<Row> rows, SortType sort, int max_fn_width,
   int file_w = static_cast<int>(file_header.size());
   int fn_w = static_cast<int>(func_header.size());
   int cc_w = static_cast<int>(cc_header.size());
+  for (const auto &s : skipped)
+    file_w = std::max(file_w, static_cast<int>(s.file.size()));
   for (const auto &r : rows) {
     file_w = std::max(file_w, static_cast<int>(r.file.size()));
     std::string suffix = "@" + std::to_string(r.fn.row + 1);
@@ -310,6 +326,13 @@ void print_table(std::vector<Row> rows, SortType sort, int max_fn_width,
     }
     std::cout << '\n';
   }
+
+  for (const auto &s : skipped) {
+    std::cout << std::left << std::setw(file_w) << s.file << "  ";
+    painter.print(std::cout, term::Style::yellow,
+                  "not analysed (" + s.reason + ")");
+    std::cout << '\n';
+  }
 }
 
 }  // namespace report
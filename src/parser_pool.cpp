@@ -0,0 +1,49 @@
+#include "../include/parser_pool.h"
+
+#include "../include/cognitive_complexity.h"
+
+const TSLanguage *ts_language_for_file(Language lang,
+                                       const std::string &path) {
+  switch (lang) {
+    case Language::Python:
+      return tree_sitter_python();
+    case Language::JavaScript:
+      return tree_sitter_javascript();
+    case Language::C:
+      return tree_sitter_c();
+    case Language::Cpp:
+      return tree_sitter_cpp();
+    case Language::TypeScript:
+      if (path.size() >= 4 && path.rfind(".tsx") == path.size() - 4)
+        return tree_sitter_tsx();
+      return tree_sitter_typescript();
+    default:
+      return nullptr;
+  }
+}
+
+ParserPool::~ParserPool() {
+  for (auto &slot : slots_)
+    if (slot.parser) ts_parser_delete(slot.parser);
+}
+
+TSParser *ParserPool::get(Language lang, const std::string &path) {
+  const TSLanguage *language = ts_language_for_file(lang, path);
+  if (!language) return nullptr;
+  for (auto &slot : slots_) {
+    if (slot.language == language) return slot.parser;
+    if (slot.language) continue;
+    slot.language = language;
+    slot.parser = ts_parser_new();
+    ts_parser_set_language(slot.parser, language);
+    ts_parser_set_timeout_micros(slot.parser, timeout_micros_);
+    return slot.parser;
+  }
+  return nullptr;  // unreachable: one slot per grammar
+}
+
+void ParserPool::set_timeout_micros(std::uint64_t micros) {
+  timeout_micros_ = micros;
+  for (auto &slot : slots_)
+    if (slot.parser) ts_parser_set_timeout_micros(slot.parser, micros);
+}
@@ -0,0 +1,425 @@
+#include "../include/profile.h"
+
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace profile {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct FileRecord {
+  std::string path;
+  Language lang;
+  double seconds;
+  std::array<double, kPhaseCount> phase_seconds;
+  std::uint64_t bytes;
+  std::uint64_t nodes;
+  std::uint64_t allocations;
+};
+
+// A Timer (a phase) or a FileScope (a file: `phase` unused) for the trace.
+// `file` indexes the thread's file records: the file this span is, or the
+// one being analysed when the phase ran (-1 for none).
+struct Span {
+  Clock::time_point begin;
+  Clock::time_point end;
+  Phase phase;
+  bool is_file;
+  std::int64_t file;
+};
+
+// Everything one thread recorded. Owned by the registry so it outlives the
+// thread and can be summed after the workers are joined.
+struct ThreadData {
+  std::array<double, kPhaseCount> seconds{};
+  std::uint64_t bytes = 0;
+  std::uint64_t nodes = 0;
+  std::uint64_t allocations_at_start = 0;
+  std::uint64_t allocations = 0;  // snapshot, see flush_allocations
+  std::vector<FileRecord> files;
+  std::vector<Span> spans;  // only when tracing
+  std::string name;         // track name, see set_thread_name
+  std::int64_t open_file = -1;
+  // The running phase and since when it has been charged.
+  Phase current = Phase::Other;
+  Clock::time_point since;
+  int depth = 0;
+};
+
+std::mutex registry_mu;
+std::deque<ThreadData> registry;
+Clock::time_point epoch;  // trace timestamps are relative to enable()
+
+ThreadData &local() {
+  static thread_local ThreadData *data = [] {
+    std::lock_guard<std::mutex> lock(registry_mu);
+    ThreadData &d = registry.emplace_back();
+    d.allocations_at_start = t_allocations;
+    return &d;
+  }();
+  return *data;
+}
+
+double seconds_between(Clock::time_point a, Clock::time_point b) {
+  return std::chrono::duration<double>(b - a).count();
+}
+
+// Charge the running phase up to `now`.
+void charge(ThreadData &d, Clock::time_point now) {
+  if (d.depth > 0)
+    d.seconds[static_cast<size_t>(d.current)] += seconds_between(d.since, now);
+  d.since = now;
+}
+
+// The allocation counter is thread_local, so it is copied into the record
+// by the thread itself whenever a phase ends.
+void flush_allocations(ThreadData &d) {
+  d.allocations = t_allocations - d.allocations_at_start;
+}
+
+const char *language_name(Language lang) {
+  switch (lang) {
+    case Language::Python:
+      return "python";
+    case Language::C:
+      return "c";
+    case Language::Cpp:
+      return "cpp";
+    case Language::JavaScript:
+      return "javascript";
+    case Language::TypeScript:
+      return "typescript";
+    case Language::Java:
+      return "java";
+    default:
+      return "unknown";
+  }
+}
+
+std::string json_string(const std::string &s) {
+  std::string out = "\"";
+  for (char c : s) {
+    if (c == '"' || c == '\\') out += '\\';
+    out += c;
+  }
+  return out + "\"";
+}
+
+struct Summary {
+  std::array<double, kPhaseCount> seconds{};
+  std::uint64_t bytes = 0;
+  std::uint64_t nodes = 0;
+  std::uint64_t allocations = 0;
+  size_t threads = 0;
+  std::vector<FileRecord> files;  // slowest first
+
+  struct LanguageTotals {
+    size_t files = 0;
+    double seconds = 0;
+    std::uint64_t bytes = 0;
+    std::uint64_t nodes = 0;
+    std::array<double, kPhaseCount> phase_seconds{};
+  };
+  std::map<std::string, LanguageTotals> languages;
+
+  double busy() const {
+    double s = 0;
+    for (double p : seconds) s += p;
+    return s;
+  }
+};
+
+Summary summarize() {
+  Summary sum;
+  std::lock_guard<std::mutex> lock(registry_mu);
+  for (const auto &d : registry) {
+    ++sum.threads;
+    for (size_t p = 0; p < kPhaseCount; ++p) sum.seconds[p] += d.seconds[p];
+    sum.bytes += d.bytes;
+    sum.nodes += d.nodes;
+    sum.allocations += d.allocations;
+    sum.files.insert(sum.files.end(), d.files.begin(), d.files.end());
+  }
+  std::sort(sum.files.begin(), sum.files.end(),
+            [](const FileRecord &a, const FileRecord &b) {
+              if (a.seconds != b.seconds) return a.seconds > b.seconds;
+              return a.path < b.path;
+            });
+  for (const auto &f : sum.files) {
+    auto &l = sum.languages[language_name(f.lang)];
+    ++l.files;
+    l.seconds += f.seconds;
+    l.bytes += f.bytes;
+    l.nodes += f.nodes;
+    for (size_t p = 0; p < kPhaseCount; ++p)
+      l.phase_seconds[p] += f.phase_seconds[p];
+  }
+  return sum;
+}
+
+constexpr Phase kFilePhases[] = {Phase::Read, Phase::Parse, Phase::Build,
+                                 Phase::Score, Phase::Sort};
+
+double ms(double s) { return s * 1000.0; }
+
+}  // namespace
+
+const char *phase_name(Phase p) {
+  switch (p) {
+    case Phase::Other:
+      return "other";
+    case Phase::Walk:
+      return "walk";
+    case Phase::Gitignore:
+      return "gitignore";
+    case Phase::Queue:
+      return "queue";
+    case Phase::Read:
+      return "read";
+    case Phase::Parse:
+      return "parse";
+    case Phase::Build:
+      return "build";
+    case Phase::Score:
+      return "score";
+    case Phase::Sort:
+      return "sort";
+    case Phase::Print:
+      return "print";
+  }
+  return "";
+}
+
+void enable(bool trace) {
+  detail::enabled = true;
+  detail::tracing = trace;
+  epoch = Clock::now();
+  local();  // register the main thread first
+}
+
+void set_thread_name(std::string name) {
+  if (enabled()) local().name = std::move(name);
+}
+
+void Timer::start(Phase phase) {
+  ThreadData &d = local();
+  start_ = Clock::now();
+  charge(d, start_);
+  outer_ = d.current;
+  d.current = phase;
+  ++d.depth;
+  active_ = true;
+}
+
+void Timer::stop() {
+  ThreadData &d = local();
+  const Clock::time_point end = Clock::now();
+  charge(d, end);
+  if (span_ && tracing())
+    d.spans.push_back(Span{start_, end, d.current, false, d.open_file});
+  d.current = outer_;
+  --d.depth;
+  flush_allocations(d);
+}
+
+void add_bytes_read(std::uint64_t n) {
+  if (enabled()) local().bytes += n;
+}
+
+void add_nodes(std::uint64_t n) {
+  if (enabled()) local().nodes += n;
+}
+
+FileScope::FileScope(const std::string &path, Language lang) {
+  if (!enabled()) return;
+  ThreadData &d = local();
+  active_ = true;
+  path_ = &path;
+  lang_ = lang;
+  start_ = Clock::now();
+  charge(d, start_);
+  before_ = Snapshot{d.seconds, d.bytes, d.nodes, t_allocations};
+  d.open_file = static_cast<std::int64_t>(d.files.size());
+}
+
+FileScope::~FileScope() {
+  if (!active_) return;
+  ThreadData &d = local();
+  const Clock::time_point end = Clock::now();
+  charge(d, end);
+  flush_allocations(d);
+  FileRecord r{*path_, lang_, seconds_between(start_, end), {},
+               d.bytes - before_.bytes, d.nodes - before_.nodes,
+               t_allocations - before_.allocations};
+  double covered = 0;
+  for (size_t p = 0; p < kPhaseCount; ++p) {
+    r.phase_seconds[p] = d.seconds[p] - before_.seconds[p];
+    covered += r.phase_seconds[p];
+  }
+  // Untimed work inside the file (cache lookups, hashing) shows as other.
+  const double other = std::max(0.0, r.seconds - covered);
+  r.phase_seconds[static_cast<size_t>(Phase::Other)] += other;
+  d.seconds[static_cast<size_t>(Phase::Other)] += other;
+  if (tracing())
+    d.spans.push_back(Span{start_, end, Phase::Other, true, d.open_file});
+  d.files.push_back(std::move(r));
+  d.open_file = -1;
+}
+
+void print_summary(std::ostream &os, double wall_seconds, size_t top) {
+  const Summary sum = summarize();
+  const double busy = sum.busy();
+  std::ios_base::fmtflags flags = os.flags();
+  os << std::fixed << std::setprecision(2);
+
+  os << "Profile (" << sum.threads << " threads, wall " << ms(wall_seconds)
+     << " ms, busy " << ms(busy) << " ms):\n";
+  os << "  phase            ms   share\n";
+  for (size_t p = 0; p < kPhaseCount; ++p) {
+    if (sum.seconds[p] == 0) continue;
+    os << "  " << std::left << std::setw(10)
+       << phase_name(static_cast<Phase>(p)) << std::right << std::setw(10)
+       << ms(sum.seconds[p]) << std::setw(7)
+       << (busy > 0 ? 100.0 * sum.seconds[p] / busy : 0) << "%\n";
+  }
+  os << "  files           " << sum.files.size() << " ("
+     << static_cast<double>(sum.bytes) / (1024.0 * 1024.0) << " MB)\n"
+     << "  nodes visited   " << sum.nodes << "\n"
+     << "  allocations     " << sum.allocations << "\n";
+
+  const size_t n = std::min(top, sum.files.size());
+  if (n) {
+    os << "Slowest files (ms: total read parse build score sort):\n";
+    for (size_t i = 0; i < n; ++i) {
+      const auto &f = sum.files[i];
+      os << "  " << std::setw(8) << ms(f.seconds);
+      for (Phase p : kFilePhases)
+        os << ' ' << std::setw(7)
+           << ms(f.phase_seconds[static_cast<size_t>(p)]);
+      os << "  " << f.path << " (" << f.nodes << " nodes, " << f.allocations
+         << " allocs)\n";
+    }
+  }
+
+  if (!sum.languages.empty()) {
+    os << "By language (files, MB, ms: total parse build score):\n";
+    for (const auto &[name, l] : sum.languages)
+      os << "  " << std::left << std::setw(11) << name << std::right
+         << std::setw(6) << l.files << std::setw(8)
+         << static_cast<double>(l.bytes) / (1024.0 * 1024.0) << std::setw(10)
+         << ms(l.seconds) << std::setw(10)
+         << ms(l.phase_seconds[static_cast<size_t>(Phase::Parse)])
+         << std::setw(10)
+         << ms(l.phase_seconds[static_cast<size_t>(Phase::Build)])
+         << std::setw(10)
+         << ms(l.phase_seconds[static_cast<size_t>(Phase::Score)]) << "\n";
+  }
+  os.flags(flags);
+}
+
+void print_summary_json(std::ostream &os, double wall_seconds, size_t top) {
+  const Summary sum = summarize();
+  auto phases = [&](const std::array<double, kPhaseCount> &seconds) {
+    os << "{";
+    for (size_t p = 0; p < kPhaseCount; ++p)
+      os << (p ? ", " : "") << "\"" << phase_name(static_cast<Phase>(p))
+         << "\": " << ms(seconds[p]);
+    os << "}";
+  };
+  std::ios_base::fmtflags flags = os.flags();
+  os << std::fixed << std::setprecision(3);
+
+  os << "{\"profile\": {\n  \"threads\": " << sum.threads
+     << ",\n  \"wall_ms\": " << ms(wall_seconds)
+     << ",\n  \"busy_ms\": " << ms(sum.busy()) << ",\n  \"phases_ms\": ";
+  phases(sum.seconds);
+  os << ",\n  \"files\": " << sum.files.size()
+     << ",\n  \"bytes_read\": " << sum.bytes
+     << ",\n  \"nodes_visited\": " << sum.nodes
+     << ",\n  \"allocations\": " << sum.allocations
+     << ",\n  \"slowest_files\": [";
+  const size_t n = std::min(top, sum.files.size());
+  for (size_t i = 0; i < n; ++i) {
+    const auto &f = sum.files[i];
+    os << (i ? ",\n" : "\n") << "    {\"file\": " << json_string(f.path)
+       << ", \"language\": \"" << language_name(f.lang)
+       << "\", \"ms\": " << ms(f.seconds) << ", \"bytes\": " << f.bytes
+       << ", \"nodes\": " << f.nodes << ", \"allocations\": " << f.allocations
+       << ", \"phases_ms\": ";
+    phases(f.phase_seconds);
+    os << "}";
+  }
+  os << (n ? "\n  ]" : "]") << ",\n  \"languages\": {";
+  bool first = true;
+  for (const auto &[name, l] : sum.languages) {
+    os << (first ? "\n" : ",\n") << "    \"" << name
+       << "\": {\"files\": " << l.files << ", \"bytes\": " << l.bytes
+       << ", \"nodes\": " << l.nodes << ", \"ms\": " << ms(l.seconds)
+       << ", \"phases_ms\": ";
+    phases(l.phase_seconds);
+    os << "}";
+    first = false;
+  }
+  os << (first ? "}" : "\n  }") << "\n}}\n";
+  os.flags(flags);
+}
+
+void write_trace(const std::string &path) {
+  std::ofstream os(path, std::ios::binary);
+  if (!os) throw std::runtime_error("cannot write trace file " + path);
+  auto us = [](Clock::time_point t) {
+    return std::chrono::duration<double, std::micro>(t - epoch).count();
+  };
+  os << std::fixed << std::setprecision(3);
+  os << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+  bool first = true;
+  auto sep = [&] {
+    os << (first ? "\n" : ",\n");
+    first = false;
+  };
+  std::lock_guard<std::mutex> lock(registry_mu);
+  size_t tid = 0;
+  for (const auto &d : registry) {
+    // enable() registers the main thread first; the others name themselves.
+    sep();
+    os << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+       << "\"tid\": " << tid << ", \"args\": {\"name\": "
+       << json_string(!d.name.empty() ? d.name
+                      : tid           ? "thread " + std::to_string(tid)
+                                      : std::string("main"))
+       << "}}";
+    for (const auto &span : d.spans) {
+      const FileRecord *file =
+          span.file >= 0 ? &d.files[static_cast<size_t>(span.file)] : nullptr;
+      sep();
+      os << "{\"name\": "
+         << (span.is_file ? json_string(file->path)
+                          : json_string(phase_name(span.phase)))
+         << ", \"cat\": \"" << (span.is_file ? "file" : "phase")
+         << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << tid
+         << ", \"ts\": " << us(span.begin)
+         << ", \"dur\": " << us(span.end) - us(span.begin);
+      if (span.is_file)
+        os << ", \"args\": {\"language\": \"" << language_name(file->lang)
+           << "\", \"bytes\": " << file->bytes << ", \"nodes\": "
+           << file->nodes << ", \"allocations\": " << file->allocations
+           << "}";
+      else if (file)
+        os << ", \"args\": {\"file\": " << json_string(file->path) << "}";
+      os << "}";
+    }
+    ++tid;
+  }
+  os << "\n]}\n";
+  if (!os) throw std::runtime_error("cannot write trace file " + path);
+}
+
+}  // namespace profile
@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <utility>
+
+#include "../include/analysis.h"
+#include "../include/file_operations.h"
+#include "../include/project.h"
+
+namespace project {
+
+Limits limits_of(const CLI_ARGUMENTS &cli_args) {
+  Limits limits;
+  limits.max_file_bytes = static_cast<std::uintmax_t>(cli_args.max_file_bytes);
+  limits.parse_timeout_ms =
+      static_cast<std::uint64_t>(cli_args.parse_timeout_ms);
+  limits.max_gsg_nodes = static_cast<size_t>(cli_args.max_gsg_nodes);
+  return limits;
+}
+
+Model::Model(SortType sort, const Limits &limits)
+    : sort_(sort), limits_(limits) {
+  parsers_.set_timeout_micros(limits.parse_timeout_ms * 1000);
+}
+
+IBuilder *Model::builder_for(Language lang) {
+  auto &b = builders_[static_cast<size_t>(lang)];
+  if (!b) b = make_builder(lang);
+  return b.get();
+}
+
+std::vector<std::string> Model::set_files(std::vector<SourceFile> files) {
+  std::vector<std::string> added;
+  std::map<std::string, File> next;
+  for (auto &f : files) {
+    auto it = files_.find(f.path);
+    if (it != files_.end()) {
+      next.emplace(f.path, std::move(it->second));
+    } else {
+      added.push_back(f.path);
+      next.emplace(added.back(), File{std::move(f), {}, {}, nullptr});
+    }
+  }
+  files_ = std::move(next);
+  return added;
+}
+
+void Model::set_results(const std::string &path,
+                        std::vector<FunctionComplexity> functions) {
+  auto it = files_.find(path);
+  if (it != files_.end()) it->second.functions = std::move(functions);
+}
+
+void Model::set_skipped(const std::string &path, std::string reason) {
+  auto it = files_.find(path);
+  if (it != files_.end()) skip(it->second, std::move(reason));
+}
+
+void Model::skip(File &f, std::string reason) {
+  f.functions.clear();
+  f.parsed.reset();
+  f.skipped = std::move(reason);
+}
+
+std::vector<std::string> Model::stale_files() {
+  std::vector<std::string> stale;
+  for (auto &[path, f] : files_) {
+    SourceFile now = stat_source_file(path);
+    if (now.mtime_ns == 0) continue;  // vanished; the next walk drops it
+    if (now.size == f.meta.size && now.mtime_ns == f.meta.mtime_ns &&
+        now.inode == f.meta.inode)
+      continue;
+    f.meta = std::move(now);
+    stale.push_back(path);
+  }
+  return stale;
+}
+
+bool Model::refresh(const std::string &path) {
+  auto it = files_.find(path);
+  if (it == files_.end()) return false;
+  File &f = it->second;
+  Language lang = detect_language_from_path(path);
+  IBuilder *builder = builder_for(lang);
+  if (!builder) return false;
+
+  SourceFile now = stat_source_file(path);
+  if (now.mtime_ns != 0) f.meta = std::move(now);
+  last_ = RefreshInfo{};
+  // Checked before reading, as analysis::analyze_sources does.
+  std::string over = analysis::over_size_limit(f.meta.size,
+                                               limits_.max_file_bytes);
+  if (!over.empty()) {
+    skip(f, std::move(over));
+    return true;
+  }
+
+  std::string source;
+  try {
+    source = SourceBuffer::read_copy(path);
+  } catch (const std::runtime_error &) {
+    return false;  // deleted or replaced mid-save
+  }
+  over = analysis::over_size_limit(source.size(), limits_.max_file_bytes);
+  if (!over.empty()) {
+    skip(f, std::move(over));
+    return true;
+  }
+
+  const auto start = std::chrono::steady_clock::now();
+  if (!f.parsed) f.parsed = std::make_unique<incremental::IncrementalFile>();
+  builder->set_node_limit(limits_.max_gsg_nodes);
+  try {
+    f.functions = f.parsed->update(std::move(source),
+                                   parsers_.get(lang, path), *builder);
+  } catch (const ParseTimeout &) {
+    skip(f, analysis::parse_timed_out(limits_.parse_timeout_ms));
+    return true;
+  } catch (const GSGTooLarge &e) {
+    skip(f, e.what());
+    return true;
+  }
+  f.skipped.clear();
+  report::sort_functions(f.functions, sort_);
+  last_.ms = std::chrono::duration<double, std::milli>(
+                 std::chrono::steady_clock::now() - start)
+                 .count();
+  last_.rebuilt = f.parsed->rebuilt();
+  last_.reused = f.parsed->reused();
+  return true;
+}
+
+std::vector<std::string> Model::paths() const {
+  std::vector<std::string> out;
+  out.reserve(files_.size());
+  for (const auto &entry : files_) out.push_back(entry.first);
+  return out;
+}
+
+std::vector<report::Row> Model::rows(
+    const std::vector<std::string> &paths) const {
+  std::vector<report::Row> out;
+  auto add = [&](const std::string &path, const File &f) {
+    for (const auto &fn : f.functions) out.push_back(report::Row{path, fn});
+  };
+  if (paths.empty()) {
+    for (const auto &[path, f] : files_) add(path, f);
+    return out;
+  }
+  for (const auto &path : paths) {
+    auto it = files_.find(path);
+    if (it != files_.end()) add(path, it->second);
+  }
+  return out;
+}
+
+std::vector<report::Skipped> Model::skipped(
+    const std::vector<std::string> &paths) const {
+  std::vector<report::Skipped> out;
+  auto add = [&](const std::string &path, const File &f) {
+    if (!f.skipped.empty()) out.push_back(report::Skipped{path, f.skipped});
+  };
+  if (paths.empty()) {
+    for (const auto &[path, f] : files_) add(path, f);
+    return out;
+  }
+  for (const auto &path : paths) {
+    auto it = files_.find(path);
+    if (it != files_.end()) add(path, it->second);
+  }
+  std::sort(out.begin(), out.end(),
+            [](const report::Skipped &a, const report::Skipped &b) {
+              return a.file < b.file;
+            });
+  return out;
+}
+
+}  // namespace project
@@ -0,0 +1,437 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#include "../include/result_cache.h"
+
+namespace fs = std::filesystem;
+
+#ifndef COGNITY_VERSION
+#define COGNITY_VERSION "dev"
+#endif
+#ifndef COGNITY_TS_CORE_TAG
+#define COGNITY_TS_CORE_TAG "unknown"
+#endif
+#ifndef COGNITY_TS_PYTHON_TAG
+#define COGNITY_TS_PYTHON_TAG "unknown"
+#endif
+#ifndef COGNITY_TS_JAVASCRIPT_TAG
+#define COGNITY_TS_JAVASCRIPT_TAG "unknown"
+#endif
+#ifndef COGNITY_TS_TYPESCRIPT_TAG
+#define COGNITY_TS_TYPESCRIPT_TAG "unknown"
+#endif
+#ifndef COGNITY_TS_TSX_TAG
+#define COGNITY_TS_TSX_TAG "unknown"
+#endif
+#ifndef COGNITY_TS_C_TAG
+#define COGNITY_TS_C_TAG "unknown"
+#endif
+#ifndef COGNITY_TS_CPP_TAG
+#define COGNITY_TS_CPP_TAG "unknown"
+#endif
+// Part of grammar_tag: bump when the same source scores differently, so
+// cached results from before are not served (2: nested C++ lambdas are
+// counted once).
+#define COGNITY_SCORER_VERSION "2"
+
+namespace cache {
+
+namespace {
+
+// Bump when the entry layout below changes.
+constexpr std::uint32_t kFormatVersion = 2;
+constexpr char kMagic[4] = {'C', 'G', 'N', 'C'};
+constexpr char kIndexMagic[4] = {'C', 'G', 'N', 'I'};
+constexpr const char *kIndexName = "stat-index";
+// Metadata younger than this (relative to when it is recorded) is not indexed.
+constexpr std::int64_t kRacyWindowNs = 2'000'000'000;
+
+constexpr std::uint64_t kP0 = 0xa0761d6478bd642full;
+constexpr std::uint64_t kP1 = 0xe7037ed1a0b428dbull;
+constexpr std::uint64_t kP2 = 0x8ebc6af09c88c6e3ull;
+
+// 64x64 -> 128 multiply folded back to 64 bits.
+inline std::uint64_t mix(std::uint64_t a, std::uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+  __uint128_t r = static_cast<__uint128_t>(a) * b;
+  return static_cast<std::uint64_t>(r) ^ static_cast<std::uint64_t>(r >> 64);
+#else
+  std::uint64_t ha = a >> 32, la = a & 0xffffffffu;
+  std::uint64_t hb = b >> 32, lb = b & 0xffffffffu;
+  std::uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+  std::uint64_t t = rl + (rm0 << 32), c = t < rl;
+  std::uint64_t lo = t + (rm1 << 32);
+  c += lo < t;
+  std::uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+  return lo ^ hi;
+#endif
+}
+
+inline std::uint64_t read64(const char *p) {
+  std::uint64_t v;
+  std::memcpy(&v, p, sizeof v);
+  return v;
+}
+
+// Minimal append-only encoder / bounds-checked decoder for entries.
+struct Writer {
+  std::string buf;
+  void u32(std::uint32_t v) { buf.append(reinterpret_cast<char *>(&v), 4); }
+  void u64(std::uint64_t v) { buf.append(reinterpret_cast<char *>(&v), 8); }
+  void str(const std::string &s) {
+    u32(static_cast<std::uint32_t>(s.size()));
+    buf += s;
+  }
+};
+
+struct Reader {
+  std::string_view in;
+  bool ok = true;
+  bool take(void *dst, size_t n) {
+    if (!ok || in.size() < n) return ok = false;
+    std::memcpy(dst, in.data(), n);
+    in.remove_prefix(n);
+    return true;
+  }
+  std::uint32_t u32() {
+    std::uint32_t v = 0;
+    take(&v, 4);
+    return v;
+  }
+  std::uint64_t u64() {
+    std::uint64_t v = 0;
+    take(&v, 8);
+    return v;
+  }
+  std::string str() {
+    std::uint32_t n = u32();
+    if (!ok || in.size() < n) {
+      ok = false;
+      return {};
+    }
+    std::string s(in.substr(0, n));
+    in.remove_prefix(n);
+    return s;
+  }
+};
+
+bool read_file(const std::string &path, std::string &out) {
+  std::ifstream f(path, std::ios::binary);
+  if (!f) return false;
+  std::ostringstream ss;
+  ss << f.rdbuf();
+  out = ss.str();
+  return true;
+}
+
+// Write to a temporary file and rename it over `path`, so concurrent readers
+// (other workers, other cognity runs) never observe a partial file.
+bool write_atomically(const std::string &path, const std::string &data) {
+  // Unique per thread and moment, so concurrent writers never share a file.
+  const std::string tmp =
+      path + ".tmp" +
+      std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) +
+      "." +
+      std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+  std::error_code ec;
+  {
+    std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+    if (!f) return false;
+    f.write(data.data(), static_cast<std::streamsize>(data.size()));
+    if (!f) {
+      f.close();
+      fs::remove(tmp, ec);
+      return false;
+    }
+  }
+  fs::rename(tmp, path, ec);
+  if (ec) {
+    fs::remove(tmp, ec);
+    return false;
+  }
+  return true;
+}
+
+}  // namespace
+
+std::uint64_t content_hash(std::string_view data, std::uint64_t seed) {
+  const char *p = data.data();
+  size_t n = data.size();
+  std::uint64_t h = seed ^ mix(seed ^ kP0, static_cast<std::uint64_t>(n) ^ kP1);
+  while (n > 16) {
+    h = mix(read64(p) ^ kP1, read64(p + 8) ^ h);
+    p += 16;
+    n -= 16;
+  }
+  // Tail: the last (up to) 16 bytes, zero padded.
+  char tail[16] = {};
+  std::memcpy(tail, p, n);
+  h = mix(read64(tail) ^ kP1, read64(tail + 8) ^ h ^ kP2);
+  return mix(h ^ kP0, static_cast<std::uint64_t>(data.size()) ^ kP2);
+}
+
+std::string grammar_tag(Language lang, const std::string &path) {
+  std::string tag = "cognity " COGNITY_VERSION " scorer " COGNITY_SCORER_VERSION
+                    " core " COGNITY_TS_CORE_TAG;
+  switch (lang) {
+    case Language::Python:
+      return tag + " python " COGNITY_TS_PYTHON_TAG;
+    case Language::JavaScript:
+      return tag + " javascript " COGNITY_TS_JAVASCRIPT_TAG;
+    case Language::TypeScript:
+      if (path.size() >= 4 && path.rfind(".tsx") == path.size() - 4)
+        return tag + " tsx " COGNITY_TS_TSX_TAG;
+      return tag + " typescript " COGNITY_TS_TYPESCRIPT_TAG;
+    case Language::C:
+      return tag + " c " COGNITY_TS_C_TAG;
+    case Language::Cpp:
+      return tag + " cpp " COGNITY_TS_CPP_TAG;
+    default:
+      return tag;
+  }
+}
+
+ResultCache::ResultCache(std::string dir, std::uintmax_t max_bytes)
+    : dir_(std::move(dir)), max_bytes_(max_bytes) {
+  std::error_code ec;
+  fs::create_directories(dir_, ec);
+  if (ec || !fs::is_directory(dir_))
+    throw std::runtime_error("Cannot create cache directory: " + dir_);
+  load_index();
+}
+
+std::string ResultCache::entry_path(std::uint64_t key) const {
+  char name[17];
+  static const char *hex = "0123456789abcdef";
+  for (int i = 15; i >= 0; --i) {
+    name[i] = hex[key & 0xf];
+    key >>= 4;
+  }
+  name[16] = '\0';
+  return dir_ + "/" + std::string(name, 2) + "/" + name + ".bin";
+}
+
+bool ResultCache::read_entry(std::uint64_t key, const std::string &tag,
+                             std::uintmax_t source_size,
+                             std::vector<FunctionComplexity> &out,
+                             size_t &nodes) {
+  const std::string path = entry_path(key);
+  std::string data;
+  if (!read_file(path, data)) return false;
+
+  Reader r{data};
+  char magic[4] = {};
+  r.take(magic, 4);
+  bool valid = r.ok && std::memcmp(magic, kMagic, 4) == 0 &&
+               r.u32() == kFormatVersion && r.u64() == source_size &&
+               r.str() == tag;
+  if (!valid) return false;
+  const std::uint64_t walked = r.u64();
+
+  std::vector<FunctionComplexity> functions;
+  std::uint32_t count = r.u32();
+  for (std::uint32_t i = 0; r.ok && i < count; ++i) {
+    FunctionComplexity fn{};
+    fn.name = r.str();
+    fn.complexity = r.u32();
+    fn.row = r.u32();
+    fn.start_col = r.u32();
+    fn.end_col = r.u32();
+    std::uint32_t nlines = r.u32();
+    for (std::uint32_t j = 0; r.ok && j < nlines; ++j) {
+      LineComplexity lc{};
+      lc.row = r.u32();
+      lc.start_col = r.u32();
+      lc.end_col = r.u32();
+      lc.complexity = r.u32();
+      fn.lines.push_back(lc);
+    }
+    functions.push_back(std::move(fn));
+  }
+  if (!r.ok || !r.in.empty()) return false;
+
+  // Refresh the entry's age for LRU eviction.
+  std::error_code ec;
+  fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+  out = std::move(functions);
+  nodes = static_cast<size_t>(walked);
+  return true;
+}
+
+bool ResultCache::lookup_unchanged(const SourceFile &file,
+                                   const std::string &tag,
+                                   std::vector<FunctionComplexity> &out,
+                                   size_t &nodes) {
+  if (file.mtime_ns == 0) return false;
+  auto it = index_.find(file.path);
+  if (it == index_.end()) return false;
+  const IndexEntry &e = it->second;
+  if (e.inode != file.inode || e.size != file.size ||
+      e.mtime_ns != file.mtime_ns || e.tag_hash != content_hash(tag))
+    return false;
+  // The entry may have been evicted since; the caller falls back to hashing.
+  if (!read_entry(e.key, tag, file.size, out, nodes)) return false;
+  hits_.fetch_add(1, std::memory_order_relaxed);
+  stat_hits_.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
+
+bool ResultCache::lookup(const SourceFile &file, const std::string &tag,
+                         std::string_view source,
+                         std::vector<FunctionComplexity> &out,
+                         size_t &nodes) {
+  const std::uint64_t tag_hash = content_hash(tag);
+  const std::uint64_t key = content_hash(source, tag_hash);
+  if (!read_entry(key, tag, source.size(), out, nodes)) {
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  hits_.fetch_add(1, std::memory_order_relaxed);
+  remember(file, tag_hash, key);
+  return true;
+}
+
+void ResultCache::store(const SourceFile &file, const std::string &tag,
+                        std::string_view source,
+                        const std::vector<FunctionComplexity> &functions,
+                        size_t nodes) {
+  const std::uint64_t tag_hash = content_hash(tag);
+  const std::uint64_t key = content_hash(source, tag_hash);
+
+  Writer w;
+  w.buf.append(kMagic, 4);
+  w.u32(kFormatVersion);
+  w.u64(source.size());
+  w.str(tag);
+  w.u64(nodes);
+  w.u32(static_cast<std::uint32_t>(functions.size()));
+  for (const auto &fn : functions) {
+    w.str(fn.name);
+    w.u32(fn.complexity);
+    w.u32(fn.row);
+    w.u32(fn.start_col);
+    w.u32(fn.end_col);
+    w.u32(static_cast<std::uint32_t>(fn.lines.size()));
+    for (const auto &lc : fn.lines) {
+      w.u32(lc.row);
+      w.u32(lc.start_col);
+      w.u32(lc.end_col);
+      w.u32(lc.complexity);
+    }
+  }
+
+  const std::string path = entry_path(key);
+  std::error_code ec;
+  fs::create_directories(fs::path(path).parent_path(), ec);
+  if (!write_atomically(path, w.buf)) return;
+  stores_.fetch_add(1, std::memory_order_relaxed);
+  remember(file, tag_hash, key);
+}
+
+void ResultCache::remember(const SourceFile &file, std::uint64_t tag_hash,
+                           std::uint64_t key) {
+  if (file.mtime_ns == 0) return;
+  // Like git's "racily clean" entries: a file modified within the timestamp
+  // granularity of the read could change again without its mtime moving, so
+  // only trust metadata that is old enough.
+  const std::int64_t now_ns =
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count();
+  if (file.mtime_ns > now_ns - kRacyWindowNs) return;
+
+  auto it = index_.find(file.path);
+  if (it != index_.end() && it->second.inode == file.inode &&
+      it->second.size == file.size && it->second.mtime_ns == file.mtime_ns &&
+      it->second.tag_hash == tag_hash && it->second.key == key)
+    return;
+  std::lock_guard<std::mutex> lock(index_mu_);
+  index_updates_.emplace_back(
+      file.path, IndexEntry{file.inode, file.size, file.mtime_ns, tag_hash, key});
+}
+
+void ResultCache::load_index() {
+  std::string data;
+  if (!read_file(dir_ + "/" + kIndexName, data)) return;
+  Reader r{data};
+  char magic[4] = {};
+  r.take(magic, 4);
+  if (!r.ok || std::memcmp(magic, kIndexMagic, 4) != 0 ||
+      r.u32() != kFormatVersion)
+    return;
+  std::uint64_t count = r.u64();
+  for (std::uint64_t i = 0; r.ok && i < count; ++i) {
+    std::string path = r.str();
+    IndexEntry e{};
+    e.inode = r.u64();
+    e.size = r.u64();
+    e.mtime_ns = static_cast<std::int64_t>(r.u64());
+    e.tag_hash = r.u64();
+    e.key = r.u64();
+    if (r.ok) index_[std::move(path)] = e;
+  }
+  // A truncated index is dropped as a whole rather than half trusted.
+  if (!r.ok) index_.clear();
+}
+
+void ResultCache::save_index() {
+  std::lock_guard<std::mutex> lock(index_mu_);
+  if (index_updates_.empty()) return;
+  for (auto &[path, e] : index_updates_) index_[std::move(path)] = e;
+  index_updates_.clear();
+
+  Writer w;
+  w.buf.append(kIndexMagic, 4);
+  w.u32(kFormatVersion);
+  w.u64(index_.size());
+  for (const auto &[path, e] : index_) {
+    w.str(path);
+    w.u64(e.inode);
+    w.u64(e.size);
+    w.u64(static_cast<std::uint64_t>(e.mtime_ns));
+    w.u64(e.tag_hash);
+    w.u64(e.key);
+  }
+  write_atomically(dir_ + "/" + kIndexName, w.buf);
+}
+
+void ResultCache::trim() {
+  if (stores_.exchange(0) == 0) return;
+
+  struct Entry {
+    fs::file_time_type mtime;
+    std::uintmax_t size;
+    fs::path path;
+  };
+  std::vector<Entry> entries;
+  std::uintmax_t total = 0;
+  std::error_code ec;
+  for (auto it = fs::recursive_directory_iterator(dir_, ec);
+       !ec && it != fs::recursive_directory_iterator(); it.increment(ec)) {
+    if (!it->is_regular_file(ec) || it->path().extension() != ".bin") continue;
+    Entry e{it->last_write_time(ec), it->file_size(ec), it->path()};
+    if (ec) continue;
+    total += e.size;
+    entries.push_back(std::move(e));
+  }
+  if (total <= max_bytes_) return;
+
+  std::sort(entries.begin(), entries.end(),
+            [](const Entry &a, const Entry &b) { return a.mtime < b.mtime; });
+  for (const auto &e : entries) {
+    if (total <= max_bytes_) break;
+    if (fs::remove(e.path, ec)) {
+      total -= e.size;
+      ++evicted_;
+    }
+  }
+}
+
+}  // namespace cache
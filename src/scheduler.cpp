@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <utility>
+
+#include "../include/scheduler.h"
+
+namespace sched {
+
+WorkStealingScheduler::WorkStealingScheduler(std::vector<Task> tasks,
+                                             unsigned int workers) {
+  init_queues(workers);
+
+  // Ties are broken by input position so the schedule is reproducible.
+  std::sort(tasks.begin(), tasks.end(), [](const Task &a, const Task &b) {
+    if (a.cost != b.cost) return a.cost > b.cost;
+    return a.index < b.index;
+  });
+
+  // Longest-processing-time-first: hand each task to the least loaded worker.
+  using Load = std::pair<std::uintmax_t, unsigned int>;
+  std::priority_queue<Load, std::vector<Load>, std::greater<Load>> loads;
+  for (unsigned int i = 0; i < queues_.size(); ++i) loads.push({0, i});
+  for (const auto &t : tasks) {
+    auto [load, w] = loads.top();
+    loads.pop();
+    queues_[w]->tasks.push_back(t);
+    queues_[w]->remaining += t.cost;
+    loads.push({load + std::max<std::uintmax_t>(t.cost, 1), w});
+  }
+
+  pending_ = tasks.size();
+  capacity_ = tasks.size();
+  closed_ = true;
+}
+
+WorkStealingScheduler::WorkStealingScheduler(unsigned int workers,
+                                             size_t capacity)
+    : capacity_(std::max<size_t>(capacity, 1)) {
+  init_queues(workers);
+}
+
+void WorkStealingScheduler::init_queues(unsigned int workers) {
+  if (workers == 0) workers = 1;
+  queues_.reserve(workers);
+  for (unsigned int i = 0; i < workers; ++i)
+    queues_.push_back(std::make_unique<Queue>());
+}
+
+void WorkStealingScheduler::push(Task task) {
+  {
+    std::unique_lock<std::mutex> lock(state_mu_);
+    space_cv_.wait(lock, [&] { return pending_ < capacity_; });
+    ++pending_;
+  }
+
+  // Queue on the least loaded worker, keeping its deque sorted largest first.
+  Queue *target = nullptr;
+  std::uintmax_t least = 0;
+  for (auto &q : queues_) {
+    std::lock_guard<std::mutex> lock(q->mu);
+    if (!target || q->remaining < least) {
+      target = q.get();
+      least = q->remaining;
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(target->mu);
+    auto pos = std::find_if(target->tasks.begin(), target->tasks.end(),
+                            [&](const Task &t) { return t.cost < task.cost; });
+    target->tasks.insert(pos, task);
+    target->remaining += task.cost;
+  }
+  work_cv_.notify_one();
+}
+
+void WorkStealingScheduler::close() {
+  {
+    std::lock_guard<std::mutex> lock(state_mu_);
+    closed_ = true;
+  }
+  work_cv_.notify_all();
+}
+
+bool WorkStealingScheduler::pop_front(Queue &q, Task &out) {
+  std::lock_guard<std::mutex> lock(q.mu);
+  if (q.tasks.empty()) return false;
+  out = q.tasks.front();
+  q.tasks.pop_front();
+  q.remaining -= out.cost;
+  return true;
+}
+
+bool WorkStealingScheduler::try_take(unsigned int worker, Task &out) {
+  if (pop_front(*queues_[worker % queues_.size()], out)) return true;
+
+  // Own deque is empty: steal from the victim with the most pending work.
+  // The victim may be drained between the scan and the pop, so retry until
+  // every deque is observed empty.
+  for (;;) {
+    Queue *victim = nullptr;
+    std::uintmax_t best = 0;
+    for (auto &q : queues_) {
+      std::lock_guard<std::mutex> lock(q->mu);
+      if (q->tasks.empty()) continue;
+      if (!victim || q->remaining > best) {
+        victim = q.get();
+        best = q->remaining;
+      }
+    }
+    if (!victim) return false;
+    if (pop_front(*victim, out)) {
+      steals_.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+}
+
+bool WorkStealingScheduler::next(unsigned int worker, Task &out) {
+  for (;;) {
+    if (try_take(worker, out)) {
+      {
+        std::lock_guard<std::mutex> lock(state_mu_);
+        --pending_;
+      }
+      space_cv_.notify_one();
+      return true;
+    }
+    // Nothing visible. `pending_` also counts tasks a producer has reserved
+    // but not inserted yet, so only sleep when it is really zero.
+    std::unique_lock<std::mutex> lock(state_mu_);
+    if (pending_ == 0) {
+      if (closed_) return false;
+      work_cv_.wait(lock, [&] { return pending_ > 0 || closed_; });
+    }
+  }
+}
+
+}  // namespace sched
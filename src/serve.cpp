@@ -0,0 +1,480 @@
+#include "../include/serve.h"
+
+#include "../include/cli_helpers.h"
+
+#ifdef __linux__
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "../include/analysis.h"
+#include "../include/project.h"
+#include "../include/result_cache.h"
+#include "../include/sourcing.h"
+
+namespace serve {
+
+namespace {
+
+namespace fs = std::filesystem;
+
+constexpr uint32_t kWatchMask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM |
+                                IN_CREATE | IN_DELETE | IN_DELETE_SELF;
+// Longest request line accepted from a client.
+constexpr size_t kMaxRequest = 1 << 20;
+// A client that stalls mid-request is dropped after this long.
+constexpr int kClientTimeoutSeconds = 2;
+
+volatile std::sig_atomic_t g_stop = 0;
+
+void on_signal(int) { g_stop = 1; }
+
+std::string errno_message(const std::string &what) {
+  return what + ": " + std::strerror(errno);
+}
+
+std::string absolute_path(const std::string &path) {
+  std::error_code ec;
+  fs::path abs = fs::absolute(path, ec);
+  if (ec) return path;
+  std::string s = abs.lexically_normal().string();
+  if (s.size() > 1 && s.back() == '/') s.pop_back();
+  return s;
+}
+
+// Names and paths go on one tab-separated line.
+std::string field(const std::string &s) {
+  std::string out = s;
+  for (char &c : out)
+    if (c == '\t' || c == '\n' || c == '\r') c = ' ';
+  return out;
+}
+
+std::vector<std::string> split_tabs(const std::string &line) {
+  std::vector<std::string> parts;
+  size_t begin = 0;
+  for (;;) {
+    size_t end = line.find('\t', begin);
+    parts.push_back(line.substr(begin, end - begin));
+    if (end == std::string::npos) break;
+    begin = end + 1;
+  }
+  return parts;
+}
+
+sockaddr_un socket_address(const std::string &path) {
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  if (path.empty() || path.size() >= sizeof(addr.sun_path))
+    throw std::runtime_error("Invalid socket path: " + path);
+  std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+  return addr;
+}
+
+// Owns a file descriptor.
+class Fd {
+ public:
+  explicit Fd(int fd = -1) : fd_(fd) {}
+  ~Fd() {
+    if (fd_ >= 0) ::close(fd_);
+  }
+  Fd(const Fd &) = delete;
+  Fd &operator=(const Fd &) = delete;
+  int get() const { return fd_; }
+
+ private:
+  int fd_;
+};
+
+bool send_all(int fd, const std::string &data) {
+  size_t off = 0;
+  while (off < data.size()) {
+    ssize_t n = ::send(fd, data.data() + off, data.size() - off, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    off += static_cast<size_t>(n);
+  }
+  return true;
+}
+
+class Server {
+ public:
+  explicit Server(const CLI_ARGUMENTS &cli_args)
+      : cli_args_(cli_args),
+        model_(cli_args.sort, project::limits_of(cli_args)) {}
+
+  ~Server() {
+    if (listening_) ::unlink(cli_args_.socket.c_str());
+  }
+
+  int run() {
+    inotify_ = std::make_unique<Fd>(inotify_init1(IN_NONBLOCK | IN_CLOEXEC));
+    if (inotify_->get() < 0) throw std::runtime_error(errno_message("inotify"));
+
+    analyze_initial();
+    listen_socket();
+    if (!cli_args_.quiet)
+      std::cerr << "serve: " << model_.size() << " files, "
+                << watched_dirs_.size() << " directories watched, listening on "
+                << cli_args_.socket << '\n';
+
+    struct sigaction sa{};
+    sa.sa_handler = on_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+
+    while (!g_stop) {
+      pollfd fds[2] = {{inotify_->get(), POLLIN, 0},
+                       {listener_->get(), POLLIN, 0}};
+      if (::poll(fds, 2, -1) < 0) {
+        if (errno == EINTR) continue;
+        throw std::runtime_error(errno_message("poll"));
+      }
+      if (fds[0].revents & POLLIN) drain_events();
+      if (fds[1].revents & POLLIN) accept_client();
+    }
+    return 0;
+  }
+
+ private:
+  void add_watch(const std::string &dir) {
+    int wd = inotify_add_watch(inotify_->get(), dir.c_str(), kWatchMask);
+    if (wd >= 0) watched_dirs_[wd] = dir;
+  }
+
+  DirSink dir_sink() {
+    return [this](const std::string &dir) { add_watch(dir); };
+  }
+
+  void analyze_initial() {
+    std::unique_ptr<cache::ResultCache> result_cache;
+    if (!cli_args_.cache_dir.empty())
+      result_cache = std::make_unique<cache::ResultCache>(
+          cli_args_.cache_dir,
+          static_cast<std::uintmax_t>(cli_args_.cache_max_mb) * 1024 * 1024);
+
+    analysis::Options opts;
+    opts.sort = cli_args_.sort;
+    opts.jobs = analysis::resolve_jobs(cli_args_.jobs);
+    opts.cache = result_cache.get();
+    opts.on_dir = dir_sink();
+    opts.max_file_bytes =
+        static_cast<std::uintmax_t>(cli_args_.max_file_bytes);
+    opts.parse_timeout_ms =
+        static_cast<std::uint64_t>(cli_args_.parse_timeout_ms);
+    opts.max_gsg_nodes = static_cast<size_t>(cli_args_.max_gsg_nodes);
+    opts.map_files = false;  // files change under a running server
+    std::vector<report::Skipped> skipped;
+    opts.on_skip = [&](const std::string &path, const std::string &reason) {
+      skipped.push_back(report::Skipped{path, reason});
+      std::cerr << "serve: " << path << " not analysed: " << reason << '\n';
+    };
+    std::vector<SourceFile> files;
+    std::vector<report::Row> rows =
+        analysis::analyze_sources(cli_args_.paths, cli_args_.languages,
+                                  cli_args_.excludes, opts, files);
+    if (files.empty())
+      throw std::runtime_error("No matching source files found");
+
+    model_.set_files(std::move(files));
+    std::map<std::string, std::vector<FunctionComplexity>> by_file;
+    for (auto &row : rows) by_file[row.file].push_back(std::move(row.fn));
+    for (auto &[path, functions] : by_file)
+      model_.set_results(path, std::move(functions));
+    for (const auto &s : skipped) model_.set_skipped(s.file, s.reason);
+    index_paths();
+  }
+
+  // Walk the inputs again (watching any new directories) and analyze the
+  // files that appeared.
+  void rescan(std::set<std::string> &to_refresh) {
+    std::vector<SourceFile> found;
+    collect_source_files(
+        cli_args_.paths, cli_args_.languages, cli_args_.excludes,
+        [&](SourceFile f) { found.push_back(std::move(f)); }, dir_sink());
+    for (auto &path : model_.set_files(std::move(found)))
+      to_refresh.insert(std::move(path));
+    index_paths();
+  }
+
+  void index_paths() {
+    by_absolute_.clear();
+    for (auto &path : model_.paths())
+      by_absolute_.emplace(absolute_path(path), std::move(path));
+  }
+
+  void listen_socket() {
+    const std::string &path = cli_args_.socket;
+    sockaddr_un addr = socket_address(path);
+
+    // A socket file left behind by a server that died is replaced; one that
+    // still accepts connections belongs to a live server.
+    {
+      Fd probe(::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0));
+      if (probe.get() >= 0 &&
+          ::connect(probe.get(), reinterpret_cast<sockaddr *>(&addr),
+                    sizeof(addr)) == 0)
+        throw std::runtime_error("A server is already listening on " + path);
+    }
+    ::unlink(path.c_str());
+
+    listener_ = std::make_unique<Fd>(
+        ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0));
+    if (listener_->get() < 0) throw std::runtime_error(errno_message("socket"));
+    if (::bind(listener_->get(), reinterpret_cast<sockaddr *>(&addr),
+               sizeof(addr)) < 0)
+      throw std::runtime_error(errno_message("Failed to bind " + path));
+    listening_ = true;
+    if (::listen(listener_->get(), 16) < 0)
+      throw std::runtime_error(errno_message("listen"));
+  }
+
+  void drain_events() {
+    std::set<std::string> to_refresh;
+    bool walk = false;
+    alignas(inotify_event) char buf[64 * 1024];
+    for (;;) {
+      ssize_t n = ::read(inotify_->get(), buf, sizeof(buf));
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) break;
+      for (char *p = buf; p < buf + n;) {
+        const auto *ev = reinterpret_cast<const inotify_event *>(p);
+        p += sizeof(inotify_event) + ev->len;
+        if (ev->mask & IN_Q_OVERFLOW) {
+          // Events were lost: walk again and compare every stat stamp.
+          walk = true;
+          for (auto &path : model_.stale_files())
+            to_refresh.insert(std::move(path));
+          continue;
+        }
+        if (ev->mask & IN_IGNORED) {
+          watched_dirs_.erase(ev->wd);
+          continue;
+        }
+        auto dir = watched_dirs_.find(ev->wd);
+        if (dir == watched_dirs_.end() || ev->len == 0) continue;
+        const std::string name(ev->name);
+        const std::string path = (fs::path(dir->second) / name).string();
+        const bool tracked = model_.tracks(path);
+        if ((ev->mask & IN_ISDIR) || name == ".gitignore") {
+          walk = true;
+        } else if (tracked) {
+          if (ev->mask & (IN_DELETE | IN_MOVED_FROM))
+            walk = true;
+          else if (ev->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+            to_refresh.insert(path);
+        } else if ((ev->mask & (IN_CREATE | IN_MOVED_TO)) &&
+                   detect_language_from_path(path) != Language::Unknown) {
+          walk = true;  // a new source file (editor temp files are skipped)
+        }
+      }
+    }
+    if (walk) rescan(to_refresh);
+    for (const auto &path : to_refresh) refresh(path);
+  }
+
+  void refresh(const std::string &path) {
+    if (!model_.refresh(path)) return;
+    for (const auto &s : model_.skipped({path}))
+      std::cerr << "serve: " << path << " not analysed: " << s.reason << '\n';
+    if (cli_args_.quiet) return;
+    const project::RefreshInfo &info = model_.last_refresh();
+    std::ios_base::fmtflags flags = std::cerr.flags();
+    std::cerr << "serve: " << path << " (" << std::fixed
+              << std::setprecision(2) << info.ms << " ms, " << info.rebuilt
+              << " rebuilt, " << info.reused << " reused)\n";
+    std::cerr.flags(flags);
+  }
+
+  void accept_client() {
+    Fd client(::accept4(listener_->get(), nullptr, nullptr, SOCK_CLOEXEC));
+    if (client.get() < 0) return;
+    timeval tv{kClientTimeoutSeconds, 0};
+    setsockopt(client.get(), SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    std::string line;
+    char buf[4096];
+    while (line.find('\n') == std::string::npos && line.size() < kMaxRequest) {
+      ssize_t n = ::recv(client.get(), buf, sizeof(buf), 0);
+      if (n < 0 && errno == EINTR) continue;
+      if (n <= 0) break;
+      line.append(buf, static_cast<size_t>(n));
+    }
+    size_t eol = line.find('\n');
+    if (eol == std::string::npos) {
+      send_all(client.get(), "error\tincomplete request\n");
+      return;
+    }
+    line.resize(eol);
+    send_all(client.get(), answer(split_tabs(line)));
+  }
+
+  std::string answer(const std::vector<std::string> &request) {
+    const std::string &verb = request.front();
+    if (verb == "ping") return "pong\n";
+    if (verb == "stats")
+      return "files\t" + std::to_string(model_.size()) + '\n';
+    if (verb != "query") return "error\tunknown request: " + field(verb) + '\n';
+
+    std::vector<std::string> selected;
+    if (request.size() > 1) {
+      std::set<std::string> seen;
+      for (size_t i = 1; i < request.size(); ++i)
+        select(absolute_path(request[i]), seen, selected);
+      if (selected.empty()) return "";
+    }
+    std::ostringstream out;
+    for (const auto &row : model_.rows(selected)) {
+      out << "F\t" << field(row.file) << '\t' << field(row.fn.name) << '\t'
+          << row.fn.complexity << '\t' << row.fn.row << '\t'
+          << row.fn.start_col << '\t' << row.fn.end_col << '\n';
+      for (const auto &l : row.fn.lines)
+        out << "L\t" << l.row << '\t' << l.start_col << '\t' << l.end_col
+            << '\t' << l.complexity << '\n';
+    }
+    for (const auto &s : model_.skipped(selected))
+      out << "S\t" << field(s.file) << '\t' << field(s.reason) << '\n';
+    return out.str();
+  }
+
+  // Tracked files equal to `abs` or below it.
+  void select(const std::string &abs, std::set<std::string> &seen,
+              std::vector<std::string> &selected) const {
+    const std::string dir = abs == "/" ? abs : abs + '/';
+    auto add = [&](const std::string &path) {
+      if (seen.insert(path).second) selected.push_back(path);
+    };
+    auto it = by_absolute_.find(abs);
+    if (it != by_absolute_.end()) add(it->second);
+    for (it = by_absolute_.lower_bound(dir);
+         it != by_absolute_.end() && it->first.starts_with(dir); ++it)
+      add(it->second);
+  }
+
+  const CLI_ARGUMENTS &cli_args_;
+  project::Model model_;
+  std::unique_ptr<Fd> inotify_;
+  std::unique_ptr<Fd> listener_;
+  bool listening_ = false;
+  std::unordered_map<int, std::string> watched_dirs_;
+  // Absolute, normalized path -> tracked path, for query matching.
+  std::map<std::string, std::string> by_absolute_;
+};
+
+unsigned int to_uint(const std::string &s) {
+  return static_cast<unsigned int>(std::stoul(s));
+}
+
+}  // namespace
+
+int run(const CLI_ARGUMENTS &cli_args) {
+  try {
+    Server server(cli_args);
+    return server.run();
+  } catch (const std::runtime_error &e) {
+    cli_helpers::print_error(e.what());
+    return 1;
+  }
+}
+
+int query(const CLI_ARGUMENTS &cli_args) {
+  std::string reply;
+  try {
+    sockaddr_un addr = socket_address(cli_args.socket);
+    Fd fd(::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0));
+    if (fd.get() < 0 ||
+        ::connect(fd.get(), reinterpret_cast<sockaddr *>(&addr),
+                  sizeof(addr)) < 0)
+      throw std::runtime_error(
+          errno_message("No cognity server on " + cli_args.socket));
+
+    std::string request = "query";
+    for (const auto &path : cli_args.paths)
+      request += '\t' + field(absolute_path(path));
+    request += '\n';
+    if (!send_all(fd.get(), request))
+      throw std::runtime_error(errno_message("Failed to send query"));
+
+    char buf[64 * 1024];
+    for (;;) {
+      ssize_t n = ::recv(fd.get(), buf, sizeof(buf), 0);
+      if (n < 0 && errno == EINTR) continue;
+      if (n < 0)
+        throw std::runtime_error(errno_message("Failed to read reply"));
+      if (n == 0) break;
+      reply.append(buf, static_cast<size_t>(n));
+    }
+  } catch (const std::runtime_error &e) {
+    cli_helpers::print_error(e.what());
+    return 1;
+  }
+
+  std::vector<report::Row> rows;
+  std::vector<report::Skipped> skipped;
+  std::istringstream in(reply);
+  std::string line;
+  try {
+    while (std::getline(in, line)) {
+      std::vector<std::string> f = split_tabs(line);
+      if (f[0] == "error") {
+        cli_helpers::print_error(f.size() > 1 ? f[1] : "server error");
+        return 1;
+      }
+      if (f[0] == "F" && f.size() == 7) {
+        rows.push_back(report::Row{
+            f[1], FunctionComplexity{f[2], to_uint(f[3]), to_uint(f[4]),
+                                     to_uint(f[5]), to_uint(f[6]), {}}});
+      } else if (f[0] == "L" && f.size() == 5 && !rows.empty()) {
+        rows.back().fn.lines.push_back(LineComplexity{
+            to_uint(f[1]), to_uint(f[2]), to_uint(f[3]), to_uint(f[4])});
+      } else if (f[0] == "S" && f.size() == 3) {
+        skipped.push_back(report::Skipped{f[1], f[2]});
+      }
+    }
+  } catch (const std::logic_error &) {  // stoul on a garbled reply
+    cli_helpers::print_error("Malformed reply from " + cli_args.socket);
+    return 1;
+  }
+  return cli_helpers::print_report(rows, cli_args, skipped);
+}
+
+}  // namespace serve
+
+#else  // !__linux__
+
+namespace serve {
+
+int run(const CLI_ARGUMENTS &) {
+  cli_helpers::print_error("cognity serve is only supported on Linux");
+  return 1;
+}
+
+int query(const CLI_ARGUMENTS &) {
+  cli_helpers::print_error("cognity query is only supported on Linux");
+  return 1;
+}
+
+}  // namespace serve
+
+#endif
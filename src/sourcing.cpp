@@ -1,20 +1,31 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
 #include <filesystem>
+#include <mutex>
 #include <string>
 #include <system_error>
+#include <thread>
 #include <vector>
 
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/stat.h>
+#endif
+#ifdef __linux__
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <string_view>
+#endif
+
 #include "../include/gitignore.h"
+#include "../include/profile.h"
 #include "../include/sourcing.h"
 
-extern "C" {
-const TSLanguage *tree_sitter_python();
-const TSLanguage *tree_sitter_javascript();
-const TSLanguage *tree_sitter_typescript();
-const TSLanguage *tree_sitter_tsx();
-const TSLanguage *tree_sitter_c();
-const TSLanguage *tree_sitter_cpp();
-}
-
 Language detect_language_from_path(const std::string &path) {
   auto ends_with = [&](const char *suf) {
     size_t n = strlen(suf);
@@ -39,15 +50,236 @@ static bool language_is_selected(Language lang,
   return false;
 }
 
-static void collect_dir_with_gitignore(
-    const std::filesystem::path &dir, const std::vector<Language> &filter,
-    const std::vector<std::filesystem::path> &exclude_dirs,
-    const std::vector<std::filesystem::path> &exclude_files,
-    std::vector<std::string> &out, std::vector<ignore::RulesFile> &stack) {
-  namespace fs = std::filesystem;
-  auto rf = ignore::load_rules_for_dir(dir);
-  bool pushed = !rf.rules.empty();
-  if (pushed) stack.push_back(std::move(rf));
+#if defined(__unix__) || defined(__APPLE__)
+static void set_stat(SourceFile &f, const struct stat &st) {
+  f.size = static_cast<std::uintmax_t>(st.st_size);
+  f.inode = static_cast<std::uint64_t>(st.st_ino);
+#if defined(__APPLE__)
+  f.mtime_ns = static_cast<std::int64_t>(st.st_mtimespec.tv_sec) * 1000000000 +
+               st.st_mtimespec.tv_nsec;
+#else
+  f.mtime_ns = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 +
+               st.st_mtim.tv_nsec;
+#endif
+}
+#endif
+
+// One stat() call, which is also what std::filesystem::file_size would cost.
+SourceFile stat_source_file(std::string path) {
+  SourceFile f{std::move(path)};
+#if defined(__unix__) || defined(__APPLE__)
+  struct stat st;
+  if (::stat(f.path.c_str(), &st) == 0) set_stat(f, st);
+#else
+  std::error_code ec;
+  f.size = std::filesystem::file_size(f.path, ec);
+  if (ec) f.size = 0;
+  auto mtime = std::filesystem::last_write_time(f.path, ec);
+  if (!ec)
+    f.mtime_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                     mtime.time_since_epoch())
+                     .count();
+#endif
+  return f;
+}
+
+namespace {
+
+namespace fs = std::filesystem;
+
+// A directory for a walk thread to read: its path as announced and joined
+// with its entries' names, its path below the walk root for .gitignore
+// matching (with a trailing '/', empty at the root), and the rules of the
+// directories above it.
+struct DirTask {
+  std::string path;
+  std::string rel;
+  std::string canon;  // canonical `path`; native walker with excludes only
+  ignore::RulesStack rules;
+};
+
+// Set `s` to its first `size` characters, a '/' and `name`, as
+// std::filesystem::path's operator/ joins them.
+void append_name(std::string &s, size_t size, std::string_view name) {
+  s.resize(size);
+  if (!s.empty() && s.back() != '/') s += '/';
+  s += name;
+}
+
+// One directory's results, handed over when it is done: its files, and
+// its subdirectories to walk, in the order it lists them.
+struct DirResult {
+  std::vector<SourceFile> files;
+  std::vector<DirTask> subdirs;
+};
+
+#ifdef __linux__
+// Per-thread buffers of the native walker.
+struct Scratch {
+  struct Entry {
+    size_t name;  // offset in names, NUL-terminated
+    size_t size;
+    unsigned char type;
+  };
+  static constexpr size_t kBufSize = 32 * 1024;
+  std::vector<Entry> entries;
+  std::string names;
+  std::vector<char> buf = std::vector<char>(kBufSize);
+  std::string path, rel, canon;  // of the entry being looked at
+};
+#else
+struct Scratch {};
+#endif
+
+// A walk over the input directories on one or more threads. Each thread
+// takes a directory, reads it whole and queues its subdirectories for
+// whichever thread is free, so metadata reads overlap; a subdirectory's
+// task carries the shared .gitignore stack of its ancestors. Emit and
+// on_dir are called under one lock, so callers need none, but in no
+// particular order across directories.
+class Walk {
+ public:
+  Walk(const std::vector<Language> &filter,
+       const std::vector<fs::path> &exclude_dirs,
+       const std::vector<fs::path> &exclude_files, const SourceSink &emit,
+       const DirSink &on_dir, DirWalker walker)
+      : filter_(filter),
+        exclude_dirs_(exclude_dirs),
+        exclude_files_(exclude_files),
+        emit_(emit),
+        on_dir_(on_dir),
+        walker_(walker) {
+#ifdef __linux__
+    if (walker_ == DirWalker::Native) {
+      std::error_code ec;
+      for (const auto &d : exclude_dirs)
+        canon_dirs_.push_back(fs::weakly_canonical(d, ec).string());
+      for (const auto &f : exclude_files)
+        canon_files_.push_back(fs::weakly_canonical(f, ec).string());
+    }
+#else
+    walker_ = DirWalker::Filesystem;
+#endif
+  }
+
+  void add_root(const std::string &root) {
+    DirTask t{root, {}, {}, nullptr};
+    if (walker_ == DirWalker::Native &&
+        !(exclude_dirs_.empty() && exclude_files_.empty())) {
+      std::error_code ec;
+      t.canon = fs::weakly_canonical(root, ec).string();
+    }
+    pending_.push_back(std::move(t));
+  }
+
+  // Walk the roots and everything below them on `threads` threads,
+  // counting the calling one. Rethrows the first exception a thread hit.
+  void run(unsigned int threads) {
+    std::vector<std::thread> helpers;
+    for (unsigned int i = 1; i < threads; ++i)
+      helpers.emplace_back([this, i] {
+        profile::set_thread_name("walk " + std::to_string(i));
+        profile::Timer timer(profile::Phase::Walk);
+        work();
+      });
+    work();
+    for (auto &th : helpers) th.join();
+    if (error_) std::rethrow_exception(error_);
+  }
+
+ private:
+  void work() {
+    Scratch scratch;
+    DirResult result;
+    DirTask task;
+    while (next(task)) {
+      result.files.clear();
+      result.subdirs.clear();
+      try {
+#ifdef __linux__
+        if (walker_ == DirWalker::Native)
+          read_dir_native(task, scratch, result);
+        else
+#endif
+          collect_dir_with_gitignore(task, result);
+        if (!result.files.empty()) {
+          std::lock_guard<std::mutex> lock(sink_mu_);
+          for (auto &f : result.files) emit_(std::move(f));
+        }
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (!error_) error_ = std::current_exception();
+      }
+      done(result.subdirs);
+    }
+  }
+
+  // Take the next directory, waiting while other threads may still queue
+  // some; false once the walk is over (or failed).
+  bool next(DirTask &task) {
+    std::unique_lock<std::mutex> lock(mu_);
+    cv_.wait(lock, [&] { return !pending_.empty() || busy_ == 0 || error_; });
+    if (error_ || pending_.empty()) return false;
+    task = std::move(pending_.back());
+    pending_.pop_back();
+    ++busy_;
+    return true;
+  }
+
+  // Queue a finished directory's subdirectories, first listed on top.
+  void done(std::vector<DirTask> &subdirs) {
+    std::lock_guard<std::mutex> lock(mu_);
+    for (auto it = subdirs.rbegin(); it != subdirs.rend(); ++it)
+      pending_.push_back(std::move(*it));
+    --busy_;
+    if (!subdirs.empty() || busy_ == 0 || error_) cv_.notify_all();
+  }
+
+  void announce(const std::string &dir) {
+    if (!on_dir_) return;
+    std::lock_guard<std::mutex> lock(sink_mu_);
+    on_dir_(dir);
+  }
+
+  void collect_dir_with_gitignore(const DirTask &task, DirResult &out);
+#ifdef __linux__
+  void read_dir_native(const DirTask &task, Scratch &s, DirResult &out);
+  bool excluded_dir(const std::string &canon) const;
+  bool excluded_file(const std::string &canon) const;
+#endif
+
+  const std::vector<Language> &filter_;
+  const std::vector<fs::path> &exclude_dirs_;
+  const std::vector<fs::path> &exclude_files_;
+  std::vector<std::string> canon_dirs_;   // native walker
+  std::vector<std::string> canon_files_;  // native walker
+  const SourceSink &emit_;
+  const DirSink &on_dir_;
+  DirWalker walker_;
+
+  std::mutex sink_mu_;  // held while calling emit_ and on_dir_
+  std::mutex mu_;       // guards the rest
+  std::condition_variable cv_;
+  std::vector<DirTask> pending_;  // next on top
+  size_t busy_ = 0;               // threads reading a directory
+  std::exception_ptr error_;
+};
+
+// Through std::filesystem: a stat per entry (unless the directory entry
+// caches its type), and fs::relative / fs::weakly_canonical per exclude
+// for every subdirectory.
+void Walk::collect_dir_with_gitignore(const DirTask &task, DirResult &out) {
+  const fs::path dir(task.path);
+  announce(task.path);
+  ignore::RulesStack stack = task.rules;
+  {
+    profile::Timer t(profile::Phase::Gitignore);
+    ignore::RulesFile rf = ignore::load_rules_for_dir(dir);
+    rf.prefix = task.rel.size();
+    if (!rf.rules.empty()) stack = ignore::push(stack, std::move(rf));
+  }
+  std::string rel = task.rel;
+  const size_t rel_size = rel.size();
 
   std::error_code ec;
   for (fs::directory_iterator it(dir, ec), end; it != end; it.increment(ec)) {
@@ -64,7 +296,7 @@ static void collect_dir_with_gitignore(
     // Exclude directories early (skip recursion)
     if (is_dir) {
       bool skip_dir = false;
-      for (const auto &ed : exclude_dirs) {
+      for (const auto &ed : exclude_dirs_) {
         std::error_code ec2;
         auto rel = fs::relative(p, ed, ec2);
         if (!ec2 && !rel.empty() && rel.is_relative() &&
@@ -83,14 +315,21 @@ static void collect_dir_with_gitignore(
       if (skip_dir) continue;
     }
 
-    if (ignore::is_ignored(stack, p, is_dir)) {
+    // `rel` is this entry's path below the walk root while it is handled.
+    rel.resize(rel_size);
+    rel += p.filename().generic_string();
+    bool ignored = false;
+    if (stack) {
+      profile::Timer t(profile::Phase::Gitignore, false);  // per entry
+      ignored = ignore::is_ignored(stack, rel, is_dir);
+    }
+    if (ignored) {
       if (is_dir) continue;
       if (is_reg) continue;
     }
 
     if (is_dir) {
-      collect_dir_with_gitignore(p, filter, exclude_dirs, exclude_files, out,
-                                 stack);
+      out.subdirs.push_back(DirTask{p.string(), rel + '/', {}, stack});
       continue;
     }
 
@@ -98,7 +337,7 @@ static void collect_dir_with_gitignore(
       std::string fpath = p.string();
       // Exclude files
       bool skip_file = false;
-      for (const auto &ef : exclude_files) {
+      for (const auto &ef : exclude_files_) {
         std::error_code ec3;
         auto pnorm = fs::weakly_canonical(p, ec3);
         auto fnorm = fs::weakly_canonical(ef, ec3);
@@ -110,19 +349,161 @@ static void collect_dir_with_gitignore(
       if (skip_file) continue;
       Language lang = detect_language_from_path(fpath);
       if (lang == Language::Unknown) continue;
-      if (!language_is_selected(lang, filter)) continue;
-      out.push_back(fpath);
+      if (!language_is_selected(lang, filter_)) continue;
+      out.files.push_back(stat_source_file(std::move(fpath)));
+    }
+  }
+}
+
+#ifdef __linux__
+constexpr int kOpenDir = O_RDONLY | O_DIRECTORY | O_CLOEXEC;
+// A directory descriptor, closed when it goes out of scope (also when a
+// callback or an allocation throws mid-read).
+struct DirFd {
+  int fd;
+  explicit DirFd(const char *path) : fd(::open(path, kOpenDir)) {}
+  DirFd(const DirFd &) = delete;
+  DirFd &operator=(const DirFd &) = delete;
+  ~DirFd() {
+    if (fd >= 0) ::close(fd);
+  }
+};
+// Offsets into a getdents64 record (struct linux_dirent64, which glibc
+// only declares from 2.30 on): d_reclen, d_type and the NUL-terminated
+// d_name.
+constexpr size_t kReclenAt = 16, kTypeAt = 18, kNameAt = 19;
+
+// Append the entries of `fd` (but . and ..) to s.entries, in the order the
+// directory lists them; stops early on a read error.
+void read_entries(int fd, Scratch &s) {
+  for (;;) {
+    const long n =
+        ::syscall(SYS_getdents64, fd, s.buf.data(), Scratch::kBufSize);
+    if (n <= 0) return;
+    for (long off = 0; off < n;) {
+      const char *d = s.buf.data() + off;
+      unsigned short reclen;
+      std::memcpy(&reclen, d + kReclenAt, sizeof(reclen));
+      off += reclen;
+      const char *nm = d + kNameAt;
+      if (nm[0] == '.' && (nm[1] == '\0' || (nm[1] == '.' && nm[2] == '\0')))
+        continue;
+      const size_t len = std::strlen(nm);
+      s.entries.push_back(Scratch::Entry{
+          s.names.size(), len, static_cast<unsigned char>(d[kTypeAt])});
+      s.names.append(nm, len + 1);
+    }
+  }
+}
+
+// Through a directory descriptor: the directory is read with getdents64
+// into the thread's name buffer, and d_type tells directories from files,
+// so an entry costs no syscall unless its type is DT_UNKNOWN or it is a
+// symlink (fstatat follows it, as the Filesystem walker does) or it is a
+// source file (one fstatat for its size and mtime). Excludes are matched
+// against the canonical path of each entry, which is its directory's plus
+// its name except through a symlink, instead of canonicalizing every path.
+void Walk::read_dir_native(const DirTask &task, Scratch &s, DirResult &out) {
+  announce(task.path);
+  const DirFd dir(task.path.c_str());
+  const int fd = dir.fd;
+  if (fd < 0) return;
+  s.entries.clear();
+  s.names.clear();
+  read_entries(fd, s);
+  auto name = [&](const Scratch::Entry &e) {
+    return std::string_view(s.names).substr(e.name, e.size);
+  };
+
+  ignore::RulesStack stack = task.rules;
+  for (const auto &e : s.entries) {
+    if (name(e) != ".gitignore") continue;
+    profile::Timer t(profile::Phase::Gitignore);
+    ignore::RulesFile rf = ignore::load_rules_for_dir(task.path);
+    rf.prefix = task.rel.size();
+    if (!rf.rules.empty()) stack = ignore::push(stack, std::move(rf));
+    break;
+  }
+
+  const bool has_excludes = !task.canon.empty();
+  for (const auto &e : s.entries) {
+    const char *n = s.names.c_str() + e.name;
+    struct stat st;
+    bool have_st = false;
+    bool is_dir = e.type == DT_DIR;
+    bool is_reg = e.type == DT_REG;
+    if (e.type == DT_UNKNOWN || e.type == DT_LNK) {
+      have_st = ::fstatat(fd, n, &st, 0) == 0;
+      is_dir = have_st && S_ISDIR(st.st_mode);
+      is_reg = have_st && S_ISREG(st.st_mode);
+    }
+    if (!is_dir && !is_reg) continue;
+    if (is_dir && name(e) == ".git") continue;
+
+    append_name(s.path, 0, task.path);
+    append_name(s.path, task.path.size(), name(e));
+    if (has_excludes) {
+      if (e.type == DT_DIR || e.type == DT_REG) {
+        s.canon = task.canon;
+        append_name(s.canon, s.canon.size(), name(e));
+      } else {
+        std::error_code ec;
+        s.canon = fs::weakly_canonical(s.path, ec).string();
+      }
+      if (is_dir ? excluded_dir(s.canon) : excluded_file(s.canon)) continue;
+    }
+
+    // `s.rel` is this entry's path below the walk root.
+    s.rel = task.rel;
+    s.rel += name(e);
+    bool ignored = false;
+    if (stack) {
+      profile::Timer t(profile::Phase::Gitignore, false);  // per entry
+      ignored = ignore::is_ignored(stack, s.rel, is_dir);
     }
+    if (ignored) continue;
+
+    if (is_dir) {
+      out.subdirs.push_back(DirTask{s.path, s.rel + '/',
+                                    has_excludes ? s.canon : std::string(),
+                                    stack});
+      continue;
+    }
+    const Language lang = detect_language_from_path(s.path);
+    if (lang == Language::Unknown || !language_is_selected(lang, filter_))
+      continue;
+    if (!have_st) have_st = ::fstatat(fd, n, &st, 0) == 0;
+    SourceFile f{s.path};
+    if (have_st) set_stat(f, st);
+    out.files.push_back(std::move(f));
   }
+}
 
-  if (pushed) stack.pop_back();
+// `canon` is an exclude directory or inside one.
+bool Walk::excluded_dir(const std::string &canon) const {
+  for (const auto &d : canon_dirs_)
+    if (canon.starts_with(d) &&
+        (canon.size() == d.size() || d.back() == '/' ||
+         canon[d.size()] == '/'))
+      return true;
+  return false;
 }
 
+bool Walk::excluded_file(const std::string &canon) const {
+  for (const auto &f : canon_files_)
+    if (canon == f) return true;
+  return false;
+}
+#endif
+
+}  // namespace
+
 void collect_source_files(const std::vector<std::string> &inputs,
                           const std::vector<Language> &filter,
                           const std::vector<std::string> &excludes,
-                          std::vector<std::string> &out) {
-  namespace fs = std::filesystem;
+                          const SourceSink &emit, const DirSink &on_dir,
+                          DirWalker walker, unsigned int threads) {
+  profile::Timer timer(profile::Phase::Walk);
   // Prepare exclude lists
   std::vector<fs::path> exclude_dirs;
   std::vector<fs::path> exclude_files;
@@ -135,11 +516,11 @@ void collect_source_files(const std::vector<std::string> &inputs,
     else
       exclude_files.push_back(ep);
   }
+  Walk walk(filter, exclude_dirs, exclude_files, emit, on_dir, walker);
   for (const auto &p : inputs) {
     fs::path path(p);
     std::error_code ec;
     if (fs::is_directory(path, ec)) {
-      std::vector<ignore::RulesFile> stack;
       // Skip top-level directory if excluded
       bool skip_dir = false;
       for (const auto &ed : exclude_dirs) {
@@ -152,8 +533,7 @@ void collect_source_files(const std::vector<std::string> &inputs,
         }
       }
       if (skip_dir) continue;
-      collect_dir_with_gitignore(path, filter, exclude_dirs, exclude_files, out,
-                                 stack);
+      walk.add_root(p);
     } else if (fs::is_regular_file(path, ec)) {
       // Skip if explicitly excluded
       bool skip = false;
@@ -168,38 +548,31 @@ void collect_source_files(const std::vector<std::string> &inputs,
       }
       if (skip) continue;
       Language lang = detect_language_from_path(p);
-      if (lang != Language::Unknown && language_is_selected(lang, filter))
-        out.push_back(p);
+      if (lang != Language::Unknown && language_is_selected(lang, filter)) {
+        emit(stat_source_file(p));
+      }
     } else {
       // Ignore non-existing inputs silently
     }
   }
+  walk.run(std::max(1u, threads));
 }
 
-void set_ts_language_for_file(TSParser *parser, Language lang,
-                              const std::string &path) {
-  switch (lang) {
-    case Language::Python:
-      ts_parser_set_language(parser, tree_sitter_python());
-      break;
-    case Language::JavaScript:
-      ts_parser_set_language(parser, tree_sitter_javascript());
-      break;
-    case Language::C:
-      ts_parser_set_language(parser, tree_sitter_c());
-      break;
-    case Language::Cpp:
-      ts_parser_set_language(parser, tree_sitter_cpp());
-      break;
-    case Language::TypeScript: {
-      if (path.size() >= 4 && path.rfind(".tsx") == path.size() - 4) {
-        ts_parser_set_language(parser, tree_sitter_tsx());
-      } else {
-        ts_parser_set_language(parser, tree_sitter_typescript());
-      }
-      break;
-    }
-    default:
-      break;
-  }
+void collect_source_files(const std::vector<std::string> &inputs,
+                          const std::vector<Language> &filter,
+                          const std::vector<std::string> &excludes,
+                          std::vector<SourceFile> &out,
+                          unsigned int threads) {
+  collect_source_files(
+      inputs, filter, excludes,
+      [&](SourceFile f) { out.push_back(std::move(f)); }, nullptr,
+      DirWalker::Native, threads);
+  sort_by_path(out);
+}
+
+void sort_by_path(std::vector<SourceFile> &files) {
+  std::sort(files.begin(), files.end(),
+            [](const SourceFile &a, const SourceFile &b) {
+              return a.path < b.path;
+            });
 }
@@ -0,0 +1,61 @@
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <thread>
+
+#include "../include/cli_helpers.h"
+#include "../include/project.h"
+#include "../include/watch.h"
+
+namespace watch {
+
+namespace {
+
+constexpr auto kPollInterval = std::chrono::milliseconds(100);
+// Walk the inputs again every this many polls (~2 s).
+constexpr unsigned int kRescanPolls = 20;
+
+void report_file(const project::Model &model, const std::string &path,
+                 const CLI_ARGUMENTS &cli_args) {
+  cli_helpers::print_report(model.rows({path}), cli_args,
+                            model.skipped({path}));
+  std::cout.flush();
+  if (cli_args.quiet) return;
+  const project::RefreshInfo &info = model.last_refresh();
+  std::ios_base::fmtflags flags = std::cerr.flags();
+  std::cerr << "watch: " << path << " (" << std::fixed << std::setprecision(2)
+            << info.ms << " ms, " << info.rebuilt << " rebuilt, "
+            << info.reused << " reused)\n";
+  std::cerr.flags(flags);
+}
+
+}  // namespace
+
+void run(const CLI_ARGUMENTS &cli_args, std::vector<SourceFile> files,
+         std::vector<report::Row> rows,
+         const std::vector<report::Skipped> &skipped) {
+  project::Model model(cli_args.sort, project::limits_of(cli_args));
+  model.set_files(std::move(files));
+  std::map<std::string, std::vector<FunctionComplexity>> by_file;
+  for (auto &row : rows) by_file[row.file].push_back(std::move(row.fn));
+  for (auto &[path, functions] : by_file)
+    model.set_results(path, std::move(functions));
+  for (const auto &s : skipped) model.set_skipped(s.file, s.reason);
+
+  for (unsigned int polls = 1;; ++polls) {
+    std::this_thread::sleep_for(kPollInterval);
+    std::vector<std::string> changed;
+    if (polls % kRescanPolls == 0) {
+      std::vector<SourceFile> found;
+      collect_source_files(cli_args.paths, cli_args.languages,
+                           cli_args.excludes, found);
+      changed = model.set_files(std::move(found));
+    }
+    for (auto &path : model.stale_files()) changed.push_back(std::move(path));
+    for (const auto &path : changed)
+      if (model.refresh(path)) report_file(model, path, cli_args);
+  }
+}
+
+}  // namespace watch
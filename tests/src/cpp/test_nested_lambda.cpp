@@ -0,0 +1,12 @@
+int h(int x) {
+  if (x) {
+    auto l = [](int y) { if (y) return 1; return 0; };
+    return l(x);
+  }
+  return 0;
+}
+
+int k(int x) {
+  if ([&]() { if (x) return true; return false; }()) return 1;
+  return 0;
+}
@@ -1,18 +1,34 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <limits>
 #include <map>
+#include <new>
 #include <string>
 
+#include "../include/analysis.h"
 #include "../include/cognitive_complexity.h"
+#include "../include/gitignore.h"
+#include "../include/incremental.h"
+#include "../include/parser_pool.h"
+#include "../include/profile.h"
+#include "../include/result_cache.h"
+#include "../include/sourcing.h"
 
-extern "C" {
-const TSLanguage* tree_sitter_python();
-const TSLanguage* tree_sitter_javascript();
-const TSLanguage* tree_sitter_typescript();
-const TSLanguage* tree_sitter_c();
-const TSLanguage* tree_sitter_cpp();
+// Count heap allocations so tests can check that hot paths do not allocate.
+static std::atomic<size_t> g_allocations{0};
+
+void* operator new(std::size_t n) {
+  ++g_allocations;
+  if (void* p = std::malloc(n ? n : 1)) return p;
+  throw std::bad_alloc();
 }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
 
 static std::string read_file(const std::filesystem::path& p) {
   std::ifstream ifs(p, std::ios::binary);
@@ -22,44 +38,371 @@ static std::string read_file(const std::filesystem::path& p) {
   return data;
 }
 
-static unsigned int compute_file_complexity_lang(
-    const std::filesystem::path& rel, Language lang) {
-  // Resolve path relative to project root (source dir). Use this source file
-  // location to find the repository root regardless of current working dir.
+// Contents of the fixture at `rel`, relative to the repository root (found
+// from this file's location regardless of the current working directory).
+static std::string load_fixture(const std::string& rel) {
   static const std::filesystem::path project_root =
       std::filesystem::path(__FILE__).parent_path().parent_path();
-  std::filesystem::path p = project_root / rel;
-  TSParser* parser = ts_parser_new();
-  switch (lang) {
-    case Language::Python:
-      ts_parser_set_language(parser, tree_sitter_python());
-      break;
-    case Language::JavaScript:
-    case Language::TypeScript:
-      // TS code uses the TypeScript grammar; JS uses JS grammar
-      if (lang == Language::JavaScript)
-        ts_parser_set_language(parser, tree_sitter_javascript());
-      else
-        ts_parser_set_language(parser, tree_sitter_typescript());
-      break;
-    case Language::C:
-      ts_parser_set_language(parser, tree_sitter_c());
-      break;
-    case Language::Cpp:
-      ts_parser_set_language(parser, tree_sitter_cpp());
-      break;
-    default:
-      ts_parser_delete(parser);
-      return 0;
+  return read_file(project_root / rel);
+}
+
+// One parser per grammar for the whole run, as a worker keeps them.
+static ParserPool& test_parsers() {
+  static ParserPool parsers;
+  return parsers;
+}
+
+static bool same_functions(const std::vector<FunctionComplexity>& a,
+                           const std::vector<FunctionComplexity>& b) {
+  if (a.size() != b.size()) return false;
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (a[i].name != b[i].name || a[i].complexity != b[i].complexity ||
+        a[i].row != b[i].row || a[i].start_col != b[i].start_col ||
+        a[i].lines.size() != b[i].lines.size())
+      return false;
+    for (size_t j = 0; j < a[i].lines.size(); ++j)
+      if (a[i].lines[j].row != b[i].lines[j].row ||
+          a[i].lines[j].complexity != b[i].lines[j].complexity)
+        return false;
   }
-  std::string src = read_file(p);
+  return true;
+}
+
+// Score every function of `src` through the materialized GSG (the path
+// incremental analysis takes) rather than the streaming one.
+static std::vector<FunctionComplexity> materialized_functions(
+    const std::string& src, TSParser* parser, Language lang) {
+  TSTree* tree = ts_parser_parse_string(parser, nullptr, src.data(),
+                                        static_cast<uint32_t>(src.size()));
+  auto builder = make_builder(lang);
+  const GSG& gsg = builder->build(ts_tree_root_node(tree), src);
+  std::vector<FunctionComplexity> fns;
+  for (const auto& fn : gsg.functions())
+    fns.push_back(function_complexity(gsg, fn));
+  ts_tree_delete(tree);
+  return fns;
+}
+
+static unsigned int compute_file_complexity_lang(const std::string& rel,
+                                                 Language lang) {
+  TSParser* parser = test_parsers().get(lang, rel);
+  if (!parser) return 0;
+  std::string src = load_fixture(rel);
   auto fns = functions_complexity_file(src, parser, lang);
-  ts_parser_delete(parser);
+  const bool streamed_ok =
+      same_functions(fns, materialized_functions(src, parser, lang));
+  if (!streamed_ok) {
+    std::cerr << "Streamed scores differ from the GSG for " << rel << "\n";
+    return std::numeric_limits<unsigned int>::max();
+  }
   unsigned int sum = 0;
   for (const auto& fn : fns) sum += fn.complexity;
   return sum;
 }
 
+// Apply `edits` (find, replace) one after another and check that the
+// incremental result matches a full analysis after every step.
+static bool check_incremental(
+    const std::string& rel, Language lang,
+    const std::vector<std::pair<std::string, std::string>>& edits) {
+  std::string src = load_fixture(rel);
+  TSParser* parser = test_parsers().get(lang, rel);
+  auto builder = make_builder(lang);
+  incremental::IncrementalFile file;
+  bool ok = same_functions(file.update(src, parser, *builder),
+                           functions_complexity_file(src, parser, lang));
+  for (const auto& [from, to] : edits) {
+    size_t at = src.find(from);
+    if (at == std::string::npos) {
+      std::cerr << "Incremental edit not applicable in " << rel << ": " << from
+                << "\n";
+      ok = false;
+      break;
+    }
+    src.replace(at, from.size(), to);
+    const auto& inc = file.update(src, parser, *builder);
+    if (!same_functions(inc, functions_complexity_file(src, parser, lang))) {
+      std::cerr << "Incremental mismatch for " << rel << " after editing '"
+                << from << "'\n";
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+// A builder reuses its GSG across files, so building a graph no bigger than
+// one it already built must not touch the heap.
+static bool check_gsg_reuse(const std::string& rel, Language lang) {
+  std::string src = load_fixture(rel);
+  TSParser* parser = test_parsers().get(lang, rel);
+  TSTree* tree = ts_parser_parse_string(parser, nullptr, src.data(),
+                                        static_cast<uint32_t>(src.size()));
+  TSNode root = ts_tree_root_node(tree);
+  auto builder = make_builder(lang);
+  const size_t nodes = builder->build(root, src).node_count();
+  const size_t before = g_allocations.load();
+  const GSG& again = builder->build(root, src);
+  const size_t allocations = g_allocations.load() - before;
+  const bool ok = allocations == 0 && again.node_count() == nodes && nodes > 0;
+  if (!ok)
+    std::cerr << "GSG rebuild of " << rel << ": " << allocations
+              << " allocations, " << again.node_count() << "/" << nodes
+              << " nodes\n";
+  ts_tree_delete(tree);
+  return ok;
+}
+
+// A parse that exceeds the pool's timeout throws ParseTimeout and leaves the
+// parser usable: the next parse starts over instead of resuming it.
+static bool check_parse_timeout() {
+  std::string big;
+  for (int i = 0; i < 20000; ++i)
+    big += "def f" + std::to_string(i) + "(x):\n    if x and y:\n        "
+           "return [a for a in x if a or not y]\n";
+  const std::string small = "def g(x):\n    if x:\n        return 1\n";
+  ParserPool& parsers = test_parsers();
+  parsers.set_timeout_micros(1);
+  TSParser* parser = parsers.get(Language::Python, "big.py");
+  bool timed_out = false;
+  try {
+    functions_complexity_file(big, parser, Language::Python);
+  } catch (const ParseTimeout&) {
+    timed_out = true;
+  }
+  parsers.set_timeout_micros(0);
+  const auto fns = functions_complexity_file(small, parser, Language::Python);
+  bool ok = timed_out && fns.size() == 1 && fns[0].name == "g" &&
+            fns[0].complexity == 1;
+  if (!ok)
+    std::cerr << "Parse timeout: timed out " << timed_out << ", then "
+              << fns.size() << " functions\n";
+
+  // The same through an IncrementalFile (--watch, serve), which starts over.
+  auto builder = make_builder(Language::Python);
+  incremental::IncrementalFile file;
+  file.update(small, parser, *builder);
+  parsers.set_timeout_micros(1);
+  bool inc_timed_out = false;
+  try {
+    file.update(big, parser, *builder);
+  } catch (const ParseTimeout&) {
+    inc_timed_out = true;
+  }
+  parsers.set_timeout_micros(0);
+  const auto& inc = file.update(small, parser, *builder);
+  const bool inc_ok = inc_timed_out && same_functions(inc, fns);
+  if (!inc_ok)
+    std::cerr << "Incremental parse timeout: timed out " << inc_timed_out
+              << ", then " << inc.size() << " functions\n";
+  return ok && inc_ok;
+}
+
+// A builder over its node limit throws GSGTooLarge, and the same builder
+// scores files under the limit (or without one) as before.
+static bool check_node_limit(const std::string& rel, Language lang) {
+  const std::string src = load_fixture(rel);
+  TSParser* parser = test_parsers().get(lang, rel);
+  auto builder = make_builder(lang);
+  const auto full = functions_complexity_file(src, parser, *builder);
+  builder->set_node_limit(3);
+  bool too_large = false;
+  try {
+    functions_complexity_file(src, parser, *builder);
+  } catch (const GSGTooLarge&) {
+    too_large = true;
+  }
+  builder->set_node_limit(1000000);
+  const bool under = same_functions(
+      functions_complexity_file(src, parser, *builder), full);
+  builder->set_node_limit(0);
+  const bool unlimited = same_functions(
+      functions_complexity_file(src, parser, *builder), full);
+  const bool ok = too_large && under && unlimited;
+  if (!ok)
+    std::cerr << "Node limit on " << rel << ": too large " << too_large
+              << ", under the limit " << under << ", unlimited " << unlimited
+              << "\n";
+  return ok;
+}
+
+// Results served from the cache are held to the node limit too: a file
+// cached by a run without one is skipped by a later run with one (on the
+// stat path, as the file is unchanged), and served again without it.
+static bool check_cached_node_limit(const std::string& rel) {
+  namespace fs = std::filesystem;
+  const fs::path dir = fs::temp_directory_path() / "cognity_cache_test";
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  const fs::path file = dir / fs::path(rel).filename();
+  std::ofstream(file) << load_fixture(rel);
+  // Old enough for the stat index to trust (see ResultCache::remember).
+  fs::last_write_time(file,
+                      fs::last_write_time(file) - std::chrono::hours(1));
+  const std::vector<SourceFile> files{stat_source_file(file.string())};
+  const std::string cache_dir = (dir / "cache").string();
+
+  analysis::Options opts;
+  std::vector<std::string> skipped;
+  opts.on_skip = [&](const std::string&, const std::string& reason) {
+    skipped.push_back(reason);
+  };
+  cache::ResultCache first(cache_dir, 1 << 20);
+  opts.cache = &first;
+  const size_t rows = analysis::analyze_files(files, opts).size();
+
+  cache::ResultCache second(cache_dir, 1 << 20);
+  opts.cache = &second;
+  opts.max_gsg_nodes = 3;
+  analysis::RunStats stats;
+  const bool limited =
+      analysis::analyze_files(files, opts, &stats).empty() &&
+      stats.cache_stat_hits == 1 && skipped.size() == 1 &&
+      skipped[0] == too_many_nodes(3);
+  opts.max_gsg_nodes = 0;
+  const bool unlimited = rows > 0 &&
+                         analysis::analyze_files(files, opts).size() == rows &&
+                         skipped.size() == 1;
+  const bool ok = limited && unlimited;
+  if (!ok)
+    std::cerr << "Cached " << rel << " under a node limit: skipped "
+              << skipped.size() << ", stat hits " << stats.cache_stat_hits
+              << ", served without the limit " << unlimited << "\n";
+  fs::remove_all(dir);
+  return ok;
+}
+
+// Compiled .gitignore rules: literal, prefix/suffix and glob rules, dir-only
+// and negated ones, and a nested .gitignore overriding its parent.
+static bool check_gitignore() {
+  namespace fs = std::filesystem;
+  const fs::path dir = fs::temp_directory_path() / "cognity_gitignore_test";
+  fs::create_directories(dir / "sub");
+  std::ofstream(dir / ".gitignore")
+      << "# comment\n*.log\n!keep.log\nbuild/\ntmp?\ncache*\n"
+         "docs/*.md\n**/gen\nsrc/**/*.tmp\n\\#hash\n";
+  std::ofstream(dir / "sub" / ".gitignore") << "!*.log\n";
+  std::vector<ignore::RulesFile> stack{ignore::load_rules_for_dir(dir)};
+  ignore::RulesFile sub = ignore::load_rules_for_dir(dir / "sub");
+  sub.prefix = 4;  // "sub/"
+  const struct {
+    const char* rel;
+    bool is_dir;
+    bool nested;  // with sub/.gitignore on the stack
+    bool ignored;
+  } cases[] = {
+      {"a.log", false, false, true},
+      {"x/y/a.log", false, false, true},
+      {"keep.log", false, false, false},
+      {"build", true, false, true},
+      {"build", false, false, false},
+      {"tmp1", false, false, true},
+      {"tmp12", false, false, false},
+      {"cachedir", true, false, true},
+      {"docs/a.md", false, false, true},
+      {"docs/x/a.md", false, false, false},
+      {"a/b/gen", true, false, true},
+      {"gen", true, false, false},
+      {"src/a/b/c.tmp", false, false, true},  // '**' then '*' (as git does)
+      {"#hash", false, false, true},
+      {"main.py", false, false, false},
+      {"sub/a.log", false, true, false},
+      {"sub/tmp1", false, true, true},
+  };
+  bool ok = true;
+  for (const auto& c : cases) {
+    if (c.nested) stack.push_back(sub);
+    const bool got = ignore::is_ignored(stack, c.rel, c.is_dir);
+    if (c.nested) stack.pop_back();
+    if (got != c.ignored) {
+      std::cerr << "gitignore: " << c.rel << (c.is_dir ? "/" : "")
+                << " ignored " << got << ", expected " << c.ignored << "\n";
+      ok = false;
+    }
+  }
+  fs::remove_all(dir);
+  return ok;
+}
+
+// Both directory walkers find the same files and directories, in the same
+// order: .git skipped, ignored and excluded entries left out, symlinks
+// followed (but not into an excluded directory). On several threads the
+// native walker finds them too, in some order.
+static bool check_walkers() {
+  namespace fs = std::filesystem;
+  const fs::path dir = fs::temp_directory_path() / "cognity_walk_test";
+  fs::remove_all(dir);
+  for (const char* d : {".git", "build", "sub/deep", "excluded"})
+    fs::create_directories(dir / d);
+  for (const char* f : {"a.py", "b.c", "notes.txt", "ignored.py", "skip.py",
+                        "x.log.py", ".git/x.py", "build/y.py", "sub/c.js",
+                        "sub/deep/d.ts", "excluded/e.py"})
+    std::ofstream(dir / f) << "x = 1\n";
+  std::ofstream(dir / ".gitignore") << "build/\nignored.py\n*.log.py\n";
+  std::ofstream(dir / "sub" / ".gitignore") << "deep/\n!deep/\n";
+  std::error_code ec;
+  fs::create_directory_symlink(dir / "sub", dir / "link", ec);
+  fs::create_directory_symlink(dir / "excluded", dir / "link_excluded", ec);
+  fs::create_symlink(dir / "a.py", dir / "flink.py", ec);
+  fs::create_symlink(dir / "missing.py", dir / "dangling.py", ec);
+
+  const std::vector<std::string> excludes{(dir / "excluded").string(),
+                                          (dir / "skip.py").string()};
+  // The last walk runs on four threads, so only its sorted results compare.
+  std::vector<std::string> found[3], dirs[3];
+  const DirWalker walkers[3] = {DirWalker::Filesystem, DirWalker::Native,
+                                DirWalker::Native};
+  for (int i = 0; i < 3; ++i)
+    collect_source_files(
+        {dir.string()}, {}, excludes,
+        [&](SourceFile f) {
+          found[i].push_back(f.path.substr(dir.string().size()) + " " +
+                             std::to_string(f.size));
+        },
+        [&](const std::string& d) { dirs[i].push_back(d); }, walkers[i],
+        i == 2 ? 4 : 1);
+
+  bool ok = found[0] == found[1] && dirs[0] == dirs[1];
+  for (int i = 1; i < 3; ++i) {
+    std::sort(found[i].begin(), found[i].end());
+    std::sort(dirs[i].begin(), dirs[i].end());
+  }
+  const std::vector<std::string> expected{
+      "/a.py 6",          "/b.c 6",         "/flink.py 6",
+      "/link/c.js 6",     "/link/deep/d.ts 6", "/sub/c.js 6",
+      "/sub/deep/d.ts 6",
+  };
+  ok &= found[1] == expected && found[2] == expected && dirs[2] == dirs[1];
+  std::vector<SourceFile> files;
+  collect_source_files({dir.string()}, {}, excludes, files, 4);
+  ok &= files.size() == expected.size();
+  for (size_t i = 0; ok && i < files.size(); ++i)
+    ok &= files[i].path == dir.string() + expected[i].substr(
+                                              0, expected[i].find(' '));
+  if (!ok) {
+    const char* names[3] = {"filesystem", "native", "native, 4 threads"};
+    for (int i = 0; i < 3; ++i) {
+      std::cerr << "walk (" << names[i] << "):";
+      for (const auto& f : found[i]) std::cerr << " " << f;
+      std::cerr << "\n";
+    }
+  }
+  fs::remove_all(dir);
+  return ok;
+}
+
+// With --profile the graph is built and scored in two timed steps instead
+// of streamed; the results must not change.
+static bool check_profiled(const std::string& rel, Language lang) {
+  const std::string src = load_fixture(rel);
+  TSParser* parser = test_parsers().get(lang, rel);
+  const auto streamed = functions_complexity_file(src, parser, lang);
+  profile::enable();
+  const auto profiled = functions_complexity_file(src, parser, lang);
+  const bool ok = same_functions(profiled, streamed);
+  if (!ok) std::cerr << "Profiled run of " << rel << " differs\n";
+  return ok;
+}
+
 int main() {
   // Expected totals per file (mirrors complexipy tests). Paths are relative to
   // repository root.
@@ -165,6 +508,7 @@ int main() {
       {"tests/src/cpp/test_if.cpp", 4},
       {"tests/src/cpp/test_operator.cpp", 3},
       {"tests/src/cpp/test_lambda.cpp", 8},
+      {"tests/src/cpp/test_nested_lambda.cpp", 6},
       {"tests/src/cpp/test_ctor_dtor.cpp", 2},
       {"tests/src/cpp/test_method_out_of_class.cpp", 2},
       {"tests/src/cpp/test_template_method.cpp", 2},
@@ -187,6 +531,38 @@ int main() {
     }
   }
 
+  // Incremental reparse (watch mode) agrees with full analysis.
+  ok &= check_incremental(
+      "tests/src/python/test.py", Language::Python,
+      {{"def ", "\n\ndef "},
+       {"if integrity:", "if integrity and ready or forced:"},
+       {"\n\n", "\n"}});
+  ok &= check_incremental(
+      "tests/src/python/test_multiple_func.py", Language::Python,
+      {{"def ", "def extra(a):\n    if a:\n        return 1\n\ndef "}});
+  ok &= check_incremental(
+      "tests/src/cpp/test_lambda.cpp", Language::Cpp,
+      {{"{", "{\n  if (a && b || c) {}\n"}, {"if", "while"}});
+  ok &= check_incremental(
+      "tests/src/javascript/test_if.js", Language::JavaScript,
+      {{"x > 0", "x > 0 && x < 10"}, {"function", "\nfunction"}});
+
+  ok &= check_gsg_reuse("tests/src/python/test_try_nested.py",
+                        Language::Python);
+  ok &= check_gsg_reuse("tests/src/javascript/test_if.js",
+                        Language::JavaScript);
+
+  ok &= check_parse_timeout();
+  ok &= check_node_limit("tests/src/python/test_try_nested.py",
+                         Language::Python);
+  ok &= check_cached_node_limit("tests/src/python/test_try_nested.py");
+
+  ok &= check_gitignore();
+  ok &= check_walkers();
+
+  // Last: profiling stays on once enabled.
+  ok &= check_profiled("tests/src/cpp/test_lambda.cpp", Language::Cpp);
+
   if (ok) {
     std::cout << "All complexity tests passed." << std::endl;
     return 0;